@@ -48,7 +48,7 @@ void StopWatch::StartTimer( )
 #ifdef __MACH__
  timestart = mach_absolute_time();
 #else
-  gettimeofday(&start,NULL);
+  clock_gettime(CLOCK_MONOTONIC, &start);
 #endif
 
 }
@@ -59,7 +59,7 @@ void StopWatch::StopTimer()
 #ifdef __MACH__
   timestop = mach_absolute_time();
 #else
-  gettimeofday(&end, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
 #endif
 
 
@@ -81,7 +81,7 @@ double StopWatch::GetElapsedTime()
 
 #else
 	double elapsed = (end.tv_sec -start.tv_sec)*1000.0;
-	elapsed += (end.tv_usec - start.tv_usec)/1000.0;
+	elapsed += (end.tv_nsec - start.tv_nsec)/1000000.0;
 	return elapsed;
 #endif
 }
@@ -40,8 +40,9 @@ private:
 
 #if defined(__linux__) || defined(__APPLE__)
 
-   timeval start;
-   timeval end;
+   // Monotonic clock : not affected by the adjustments of the system time
+   timespec start;
+   timespec end;
 
 #ifdef __APPLE__
    uint64_t  timestart;
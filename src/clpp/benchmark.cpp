@@ -1,376 +1,2115 @@
 // In order to test that no value has been loosed ! Can take time to check !
 #define PARAM_CHECK_HASLOOSEDVALUES 0
-#define PARAM_BENCHMARK_LOOPS 20
 
-// The number of bits to sort
-#define PARAM_SORT_BITS 32
-
-#include <conio.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "clpp/benchmark.h"
+#include "clpp/StopWatch.h"
+#include "clpp/clpp.h"
+#include "clpp/clppScan.h"
+#include "clpp/clppScan_Default.h"
+#include "clpp/clppScan_GPU.h"
+#include "clpp/clppScan_LookBack.h"
+#include "clpp/clppReduce.h"
+#include "clpp/clppSegmentedScan.h"
+#include "clpp/clppBatchedScan.h"
+#include "clpp/clppScan2D.h"
+#include "clpp/clppRandom.h"
+
+#include "clpp/clppSort_CPU.h"
+#include "clpp/clppSort_RadixSort.h"
+#include "clpp/clppSort_RadixSortGPU.h"
+#include "clpp/clppSort_BitonicSort.h"
+#include "clpp/clppSort_BitonicSortGPU.h"
+#include "clpp/clppSort_Stream.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+void makeOneVector(unsigned int* a, unsigned int numElements);
+void makeRandomInt32Vector(unsigned int *a, unsigned int numElements, unsigned int keybits, bool keysOnly);
+void makeDistributionVector(unsigned int* a, unsigned int numElements, unsigned int keybits, bool keysOnly, BenchmarkDistribution distribution, unsigned int seed);
+const char* getDistributionName(BenchmarkDistribution distribution);
+
+BenchmarkResult benchmark_scan(clppContext* context, clppScan* scan, const BenchmarkOptions& options, unsigned int datasetSize);
+BenchmarkResult benchmark_sort(clppContext* context, clppSort* sort, const BenchmarkOptions& options, unsigned int datasetSize, BenchmarkDistribution distribution);
+BenchmarkResult benchmark_sort_KV(clppContext* context, clppSort* sort, const BenchmarkOptions& options, unsigned int datasetSize, BenchmarkDistribution distribution);
+void benchmark_stages(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkStageResult>& results);
+void benchmark_typed(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_operators(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_reduce(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_inclusive(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_total(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_segmented(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_batched(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_scan2d(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+void benchmark_transform(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results);
+double measureCopyBandwidth(clppContext* context, const BenchmarkOptions& options, size_t bytes);
+
+bool checkIsSorted(unsigned int* tocheck, size_t datasetSize, string algorithmName, bool keysOnly, int sortId);
+bool checkHasLooseDatasKV(unsigned int* unsorted, unsigned int* sorted, size_t datasetSize, string algorithmName);
+
+clppScan* createScan(clppContext* context, const string& algorithm, unsigned int maxElements);
+clppSort* createSort(clppContext* context, const BenchmarkOptions& options, unsigned int maxElements);
+clppRandom* createRandom(clppContext* context, const BenchmarkOptions& options, BenchmarkDistribution distribution, unsigned int datasetSize, cl_mem& clBuffer_dataSet);
+
+bool parseOptions(int argc, const char** argv, BenchmarkOptions& options);
+void printUsage();
+void writeResults(const BenchmarkOptions& options, const string& deviceName, const vector<BenchmarkResult>& results);
+void writeStageResults(const BenchmarkOptions& options, const string& deviceName, const vector<BenchmarkStageResult>& results);
+
+bool loadBaseline(const string& fileName, map<string, double>& baseline);
+void compareBaseline(const BenchmarkOptions& options, const map<string, double>& baseline, vector<BenchmarkResult>& results);
+
+int main(int argc, const char** argv)
+{
+	BenchmarkOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return 1;
+	}
+
+	clppProgram::setBasePath("src/clpp/");
+
+	//---- Prepare a clpp Context
+	clppContext context;
+	context.setup(options.platformId, options.deviceId);
+	if (options.format == Format_Text)
+		context.printInformation();
+
+	char deviceName[500];
+	clGetDeviceInfo(context.clDevice, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+
+	//---- The device times are read from the profiler
+	if (!context.getProfiler()->setEnabled(true))
+	{
+		cerr << "The queue doesn't support the profiling : only the host times are measured" << endl;
+		if (options.primitive == "stages")
+			return 1;
+	}
+
+	//---- Run the benchmark for each size
+	vector<BenchmarkResult> results;
+	vector<BenchmarkStageResult> stageResults;
+	for(size_t i = 0; i < options.sizes.size(); i++)
+	{
+		unsigned int datasetSize = options.sizes[i];
+
+		if (options.primitive == "stages")
+			benchmark_stages(&context, options, datasetSize, stageResults);
+		else if (options.primitive == "scan")
+		{
+			clppScan* scan = createScan(&context, options.algorithm, datasetSize);
+			results.push_back( benchmark_scan(&context, scan, options, datasetSize) );
+			delete scan;
+		}
+		else if (options.primitive == "typed")
+			benchmark_typed(&context, options, datasetSize, results);
+		else if (options.primitive == "operators")
+			benchmark_operators(&context, options, datasetSize, results);
+		else if (options.primitive == "reduce")
+			benchmark_reduce(&context, options, datasetSize, results);
+		else if (options.primitive == "inclusive")
+			benchmark_inclusive(&context, options, datasetSize, results);
+		else if (options.primitive == "total")
+			benchmark_total(&context, options, datasetSize, results);
+		else if (options.primitive == "segmented")
+			benchmark_segmented(&context, options, datasetSize, results);
+		else if (options.primitive == "batched")
+			benchmark_batched(&context, options, datasetSize, results);
+		else if (options.primitive == "scan2d")
+			benchmark_scan2d(&context, options, datasetSize, results);
+		else if (options.primitive == "transform")
+			benchmark_transform(&context, options, datasetSize, results);
+		else
+		{
+			// One result per distribution
+			clppSort* sort = createSort(&context, options, datasetSize);
+			for(size_t d = 0; d < options.distributions.size(); d++)
+			{
+				if (options.keysOnly)
+					results.push_back( benchmark_sort(&context, sort, options, datasetSize, options.distributions[d]) );
+				else
+					results.push_back( benchmark_sort_KV(&context, sort, options, datasetSize, options.distributions[d]) );
+			}
+			delete sort;
+		}
+	}
+
+	//---- Compare with the baseline
+	if (options.baseline.length() > 0)
+	{
+		map<string, double> baseline;
+		if (!loadBaseline(options.baseline, baseline))
+		{
+			cerr << "Unable to read the baseline : " << options.baseline << endl;
+			return 1;
+		}
+		compareBaseline(options, baseline, results);
+	}
+
+	if (options.primitive == "stages")
+		writeStageResults(options, deviceName, stageResults);
+	else
+		writeResults(options, deviceName, results);
+
+	if (options.format == Format_Text)
+		context.getBufferPool()->printStatistics();
+
+	if (options.profile)
+	{
+		context.getProfiler()->printStatistics();
+		context.writeTrace("clpp_trace.json");
+	}
+
+	//---- Non-zero exit code if a run has failed (2) or is slower than the baseline (3)
+	int exitCode = 0;
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		if (!results[i].passed)
+			return 2;
+		if (results[i].regressed)
+			exitCode = 3;
+	}
+
+	return exitCode;
+}
+
+#pragma region Options
+
+void printUsage()
+{
+	cerr << "Usage : go [options]" << endl;
+	cerr << "  --primitive <name>          The primitive to benchmark : scan, sort or stages (Default : sort)" << endl;
+	cerr << "                              stages : the time and bandwidth of each kernel of the sort and of the scans," << endl;
+	cerr << "                              against the copy bandwidth of the device" << endl;
+	cerr << "                              The scans checked against a CPU reference at each run :" << endl;
+	cerr << "                              typed : the sums of uint, float, double, long and ulong" << endl;
+	cerr << "                              operators : min, max, product, or and a non-commutative custom operator" << endl;
+	cerr << "                              reduce : clppReduce with the sum, min, max and the custom operator" << endl;
+	cerr << "                              inclusive : the inclusive scan, and the scans to an output buffer" << endl;
+	cerr << "                              total : the grand total, to the internal buffer and to a caller's buffer" << endl;
+	cerr << "                              segmented : the segmented scan, with head flags, segment offsets, keys" << endl;
+	cerr << "                              and the key-value pairs of the sorts" << endl;
+	cerr << "                              batched : the batched scan of short and long rows, with their totals" << endl;
+	cerr << "                              scan2d : the summed-area table of a pitched image, with and without border" << endl;
+	cerr << "                              transform : the transform-scans of a predicate and of a map (default, gpu)" << endl;
+	cerr << "  --algorithm <name>          scan and its checks : best, default, gpu, lookback" << endl;
+	cerr << "                              sort, stages : best, radix, radixgpu, bitonic, bitonicgpu, stream, cpu (Default : best)" << endl;
+	cerr << "  --kv                        Sort key-value pairs (Default : keys only)" << endl;
+	cerr << "  --bits <n>                  The number of bits to sort (Default : 32)" << endl;
+	cerr << "  --sizes <n1,n2,...>         The data set sizes" << endl;
+	cerr << "  --sweep <min>:<max>         The data set sizes from 2^min to 2^max (Default : 10:20)" << endl;
+	cerr << "  --distribution <d1,d2,...>  The key distributions (sort) : uniform, sorted, reverse, fewunique," << endl;
+	cerr << "                              equal, zipf, sawtooth, lowentropy, or all (Default : uniform)" << endl;
+	cerr << "  --device-data               Generate the keys on the device (clppRandom) instead of pushing them" << endl;
+	cerr << "  --loops <n>                 The number of measured runs of each size (Default : 20)" << endl;
+	cerr << "  --warmup <n>                The number of runs before the measured ones (Default : 2)" << endl;
+	cerr << "  --platform <id>             The OpenCL platform (Default : 0)" << endl;
+	cerr << "  --device <id>               The OpenCL device (Default : 0)" << endl;
+	cerr << "  --format text|csv|json      The output format (Default : text)" << endl;
+	cerr << "  --output <file>             Write the results to a file (Default : standard output)" << endl;
+	cerr << "  --profile                   Print the per stage device times, write clpp_trace.json" << endl;
+	cerr << "  --baseline <file>           Compare with a previous CSV output, exit code 3 on a regression" << endl;
+	cerr << "  --threshold <percent>       The slowdown of the median considered as a regression (Default : 10)" << endl;
+	cerr << "The times are the median of the measured runs : device time when the queue supports the profiling," << endl;
+	cerr << "else host time. The throughput is reported in keys per second, and in GB/s of data set bytes." << endl;
+}
+
+static bool parseUInt(const char* text, unsigned int& value)
+{
+	char* end;
+	unsigned long parsed = strtoul(text, &end, 0);
+	if (end == text || *end != 0)
+		return false;
+
+	value = (unsigned int)parsed;
+	return true;
+}
+
+bool parseOptions(int argc, const char** argv, BenchmarkOptions& options)
+{
+	options.primitive = "sort";
+	options.algorithm = "best";
+	options.keysOnly = true;
+	options.bits = 32;
+	options.loops = 20;
+	options.warmups = 2;
+	options.threshold = 10;
+	options.platformId = 0;
+	options.deviceId = 0;
+	options.format = Format_Text;
+	options.profile = false;
+	options.deviceData = false;
+
+	unsigned int sweepMin = 10, sweepMax = 20;
+
+	for(int i = 1; i < argc; i++)
+	{
+		string option = argv[i];
+		bool hasValue = i + 1 < argc;
+		const char* value = hasValue ? argv[i + 1] : "";
+
+		if (option == "--help" || option == "-h")
+			return false;
+		else if (option == "--kv")
+			options.keysOnly = false;
+		else if (option == "--profile")
+			options.profile = true;
+		else if (option == "--device-data")
+			options.deviceData = true;
+		else if (!hasValue)
+		{
+			cerr << "Missing value for " << option << endl;
+			return false;
+		}
+		else
+		{
+			i++;
+			bool valid = true;
+			if (option == "--primitive")
+				options.primitive = value;
+			else if (option == "--algorithm")
+				options.algorithm = value;
+			else if (option == "--bits")
+				valid = parseUInt(value, options.bits) && options.bits > 0 && options.bits <= 32;
+			else if (option == "--loops")
+				valid = parseUInt(value, options.loops) && options.loops > 0;
+			else if (option == "--warmup")
+				valid = parseUInt(value, options.warmups);
+			else if (option == "--baseline")
+				options.baseline = value;
+			else if (option == "--threshold")
+			{
+				char* end;
+				options.threshold = strtod(value, &end);
+				valid = end != value && *end == 0 && options.threshold >= 0;
+			}
+			else if (option == "--platform")
+				valid = parseUInt(value, options.platformId);
+			else if (option == "--device")
+				valid = parseUInt(value, options.deviceId);
+			else if (option == "--output")
+				options.output = value;
+			else if (option == "--format")
+			{
+				string format = value;
+				if (format == "text") options.format = Format_Text;
+				else if (format == "csv") options.format = Format_CSV;
+				else if (format == "json") options.format = Format_JSON;
+				else valid = false;
+			}
+			else if (option == "--sizes")
+			{
+				stringstream list(value);
+				string item;
+				while(valid && getline(list, item, ','))
+				{
+					unsigned int size;
+					valid = parseUInt(item.c_str(), size) && size > 0;
+					options.sizes.push_back(size);
+				}
+			}
+			else if (option == "--distribution")
+			{
+				stringstream list(value);
+				string item;
+				while(valid && getline(list, item, ','))
+				{
+					valid = false;
+					for(int d = 0; d < Distribution_Count; d++)
+						if (item == "all" || item == getDistributionName((BenchmarkDistribution)d))
+						{
+							options.distributions.push_back((BenchmarkDistribution)d);
+							valid = true;
+						}
+				}
+			}
+			else if (option == "--sweep")
+			{
+				string range = value;
+				size_t colon = range.find(':');
+				valid = colon != string::npos &&
+					parseUInt(range.substr(0, colon).c_str(), sweepMin) &&
+					parseUInt(range.substr(colon + 1).c_str(), sweepMax) &&
+					sweepMin <= sweepMax && sweepMax < 32;
+			}
+			else
+			{
+				cerr << "Unknown option " << option << endl;
+				return false;
+			}
+
+			if (!valid)
+			{
+				cerr << "Invalid value for " << option << " : " << value << endl;
+				return false;
+			}
+		}
+	}
+
+	const char* primitives[] = { "scan", "sort", "stages", "typed", "operators", "reduce", "inclusive", "total", "segmented", "batched", "scan2d", "transform" };
+	bool isPrimitive = false;
+	for(size_t p = 0; p < sizeof(primitives) / sizeof(primitives[0]); p++)
+		isPrimitive |= options.primitive == primitives[p];
+
+	if (!isPrimitive)
+	{
+		cerr << "Unknown primitive : " << options.primitive << endl;
+		return false;
+	}
+
+	if (options.primitive == "stages" && options.baseline.length() > 0)
+	{
+		cerr << "--baseline is not supported by the stages" << endl;
+		return false;
+	}
+
+	if ((options.deviceData || options.primitive == "stages") && (options.algorithm == "stream" || options.algorithm == "cpu"))
+	{
+		cerr << (options.deviceData ? "--device-data" : "The stages") << " need a device sort, not : " << options.algorithm << endl;
+		return false;
+	}
+
+	if (options.distributions.size() == 0)
+		options.distributions.push_back(Distribution_Uniform);
+
+	if (options.sizes.size() == 0)
+		for(unsigned int p = sweepMin; p <= sweepMax; p++)
+			options.sizes.push_back(1 << p);
+
+	return true;
+}
+
+#pragma endregion
+
+#pragma region create...
+
+clppScan* createScan(clppContext* context, const string& algorithm, unsigned int maxElements)
+{
+	if (algorithm == "default")
+		return new clppScan_Default(context, sizeof(int), maxElements);
+	if (algorithm == "gpu")
+		return new clppScan_GPU(context, sizeof(int), maxElements);
+	if (algorithm == "lookback")
+		return new clppScan_LookBack(context, sizeof(int), maxElements);
+
+	return clpp::createBestScan(context, sizeof(int), maxElements);
+}
+
+clppSort* createSort(clppContext* context, const BenchmarkOptions& options, unsigned int maxElements)
+{
+	const string& algorithm = options.algorithm;
+
+	if (algorithm == "radix")
+		return new clppSort_RadixSort(context, maxElements, options.bits, options.keysOnly);
+	if (algorithm == "radixgpu")
+		return new clppSort_RadixSortGPU(context, maxElements, options.bits, options.keysOnly);
+	if (algorithm == "bitonic")
+		return new clppSort_BitonicSort(context, maxElements, options.keysOnly);
+	if (algorithm == "bitonicgpu")
+		return new clppSort_BitonicSortGPU(context, maxElements, options.keysOnly);
+	if (algorithm == "stream")
+		return new clppSort_Stream(context, maxElements, options.bits, options.keysOnly);
+	if (algorithm == "cpu" && options.keysOnly)
+		return new clppSort_CPU(context);
+
+	if (options.keysOnly)
+		return clpp::createBestSort(context, maxElements, options.bits);
+	return clpp::createBestSortKV(context, maxElements, options.bits);
+}
+
+// The device generator of the data sets, and its buffer (Only with --device-data)
+clppRandom* createRandom(clppContext* context, const BenchmarkOptions& options, BenchmarkDistribution distribution, unsigned int datasetSize, cl_mem& clBuffer_dataSet)
+{
+	clBuffer_dataSet = 0;
+	if (!options.deviceData)
+		return 0;
+
+	cl_int clStatus;
+	size_t elementSize = options.keysOnly ? sizeof(int) : 2 * sizeof(int);
+	clBuffer_dataSet = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, elementSize * datasetSize, NULL, &clStatus);
+	clppProgram::checkCLStatus(clStatus);
+
+	clppRandom* random = new clppRandom(context, options.keysOnly);
+	random->setDistribution((clppRandomDistribution)distribution, options.bits);
+	return random;
+}
+
+#pragma endregion
+
+#pragma region writeResults
+
+static void fillThroughput(BenchmarkResult& result)
+{
+	double runsPerSecond = result.time > 0 ? 1000 / result.time : 0;
+	result.keysPerSecond = runsPerSecond * result.datasetSize;
+	result.gigabytesPerSecond = runsPerSecond * result.datasetSize * result.elementSize * 1e-9;
+}
+
+// The change of the time against the baseline, in percent
+static double getBaselineChange(const BenchmarkResult& result)
+{
+	return result.baselineTime > 0 ? (result.time / result.baselineTime - 1) * 100 : 0;
+}
+
+// The bandwidth of a stage against the copy bandwidth, in percent
+static double getCopyPercent(const BenchmarkStageResult& result)
+{
+	return result.copyGigabytesPerSecond > 0 ? 100 * result.gigabytesPerSecond / result.copyGigabytesPerSecond : 0;
+}
+
+void writeStageResults(const BenchmarkOptions& options, const string& deviceName, const vector<BenchmarkStageResult>& results)
+{
+	ofstream file;
+	if (options.output.length() > 0)
+		file.open(options.output.c_str());
+	ostream& out = options.output.length() > 0 ? file : cout;
+
+	if (options.format == Format_CSV)
+	{
+		out << "device,primitive,owner,stage,size,launches,time_ms,gb_per_second,copy_gb_per_second,copy_percent" << endl;
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkStageResult& r = results[i];
+			out << "\"" << deviceName << "\",\"" << r.primitive << "\",\"" << r.owner << "\",\"" << r.stage << "\",";
+			out << r.datasetSize << "," << r.launches << "," << r.time << "," << r.gigabytesPerSecond << ",";
+			out << r.copyGigabytesPerSecond << "," << getCopyPercent(r) << endl;
+		}
+	}
+	else if (options.format == Format_JSON)
+	{
+		out << "{" << endl;
+		out << "  \"device\": \"" << deviceName << "\"," << endl;
+		out << "  \"stages\": [" << endl;
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkStageResult& r = results[i];
+			out << "    {\"primitive\": \"" << r.primitive << "\", \"owner\": \"" << r.owner << "\", \"stage\": \"" << r.stage << "\"";
+			out << ", \"size\": " << r.datasetSize << ", \"launches\": " << r.launches << ", \"time_ms\": " << r.time;
+			out << ", \"gb_per_second\": " << r.gigabytesPerSecond << ", \"copy_gb_per_second\": " << r.copyGigabytesPerSecond;
+			out << ", \"copy_percent\": " << getCopyPercent(r) << "}" << (i + 1 < results.size() ? "," : "") << endl;
+		}
+		out << "  ]" << endl;
+		out << "}" << endl;
+	}
+	else
+	{
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkStageResult& r = results[i];
+			if (i == 0 || r.primitive != results[i - 1].primitive || r.datasetSize != results[i - 1].datasetSize)
+				out << "--------------- " << r.primitive << " : data-set size[" << r.datasetSize << "] copy GB/s[" << r.copyGigabytesPerSecond << "]" << endl;
+			out << r.owner << " / " << r.stage << " : " << r.launches << " x " << r.time * 1000 << " us";
+			out << " GB/s[" << r.gigabytesPerSecond << "] copy[" << getCopyPercent(r) << "%]" << endl;
+		}
+	}
+}
+
+static void writeStatistics(ostream& out, const char* clock, const BenchmarkStatistics& statistics)
+{
+	out << ", \"" << clock << "\": {\"mean_ms\": " << statistics.mean << ", \"median_ms\": " << statistics.median;
+	out << ", \"p90_ms\": " << statistics.p90 << ", \"p99_ms\": " << statistics.p99;
+	out << ", \"mad_ms\": " << statistics.mad << ", \"min_ms\": " << statistics.min << "}";
+}
+
+void writeResults(const BenchmarkOptions& options, const string& deviceName, const vector<BenchmarkResult>& results)
+{
+	ofstream file;
+	if (options.output.length() > 0)
+		file.open(options.output.c_str());
+	ostream& out = options.output.length() > 0 ? file : cout;
+
+	if (options.format == Format_CSV)
+	{
+		out << "device,primitive,algorithm,name,layout,bits,size,distribution,loops,warmups,clock,time_ms,";
+		out << "host_median_ms,host_p90_ms,host_p99_ms,host_mad_ms,device_median_ms,device_p90_ms,device_p99_ms,device_mad_ms,";
+		out << "keys_per_second,gb_per_second,baseline_ms,change_percent,passed,regressed" << endl;
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkResult& r = results[i];
+			out << "\"" << deviceName << "\"," << r.primitive << "," << options.algorithm << ",\"" << r.algorithm << "\",";
+			out << (r.keysOnly ? "keys" : "kv") << "," << r.bits << "," << r.datasetSize << "," << getDistributionName(r.distribution) << ",";
+			out << r.loops << "," << r.warmups << "," << (r.hasDeviceTime ? "device" : "host") << "," << r.time << ",";
+			out << r.hostTime.median << "," << r.hostTime.p90 << "," << r.hostTime.p99 << "," << r.hostTime.mad << ",";
+			out << r.deviceTime.median << "," << r.deviceTime.p90 << "," << r.deviceTime.p99 << "," << r.deviceTime.mad << ",";
+			out << r.keysPerSecond << "," << r.gigabytesPerSecond << "," << r.baselineTime << "," << getBaselineChange(r) << ",";
+			out << (r.passed ? 1 : 0) << "," << (r.regressed ? 1 : 0) << endl;
+		}
+	}
+	else if (options.format == Format_JSON)
+	{
+		out << "{" << endl;
+		out << "  \"device\": \"" << deviceName << "\"," << endl;
+		out << "  \"results\": [" << endl;
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkResult& r = results[i];
+			out << "    {\"primitive\": \"" << r.primitive << "\", \"algorithm\": \"" << options.algorithm << "\", \"name\": \"" << r.algorithm << "\"";
+			out << ", \"layout\": \"" << (r.keysOnly ? "keys" : "kv") << "\", \"bits\": " << r.bits;
+			out << ", \"size\": " << r.datasetSize << ", \"distribution\": \"" << getDistributionName(r.distribution) << "\"";
+			out << ", \"loops\": " << r.loops << ", \"warmups\": " << r.warmups;
+			out << ", \"clock\": \"" << (r.hasDeviceTime ? "device" : "host") << "\", \"time_ms\": " << r.time;
+			writeStatistics(out, "host", r.hostTime);
+			if (r.hasDeviceTime)
+				writeStatistics(out, "device", r.deviceTime);
+			out << ", \"keys_per_second\": " << r.keysPerSecond << ", \"gb_per_second\": " << r.gigabytesPerSecond;
+			if (r.baselineTime > 0)
+				out << ", \"baseline_ms\": " << r.baselineTime << ", \"change_percent\": " << getBaselineChange(r);
+			out << ", \"passed\": " << (r.passed ? "true" : "false") << ", \"regressed\": " << (r.regressed ? "true" : "false");
+			out << "}" << (i + 1 < results.size() ? "," : "") << endl;
+		}
+		out << "  ]" << endl;
+		out << "}" << endl;
+	}
+	else
+	{
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkResult& r = results[i];
+			if (i == 0 || r.algorithm != results[i - 1].algorithm)
+				out << "--------------- " << r.algorithm << (r.primitive == "sort" ? (r.keysOnly ? " : Key" : " : Key-Value") : "") << endl;
+			out << "Performance for data-set size[" << r.datasetSize << "]";
+			if (r.primitive == "sort")
+				out << " distribution[" << getDistributionName(r.distribution) << "]";
+			const BenchmarkStatistics& t = r.hasDeviceTime ? r.deviceTime : r.hostTime;
+			out << " time (ms, " << (r.hasDeviceTime ? "device" : "host") << "): " << r.time;
+			out << " p90[" << t.p90 << "] p99[" << t.p99 << "] MAD[" << t.mad << "]";
+			out << " KPS[" << (int)r.keysPerSecond << "] GB/s[" << r.gigabytesPerSecond << "]";
+			if (r.baselineTime > 0)
+				out << " baseline[" << r.baselineTime << "] " << (r.time >= r.baselineTime ? "+" : "") << getBaselineChange(r) << "%";
+			out << (r.passed ? "" : " FAILED") << (r.regressed ? " REGRESSION" : "") << endl;
+		}
+	}
+}
+
+#pragma endregion
+
+#pragma region Statistics
+
+// The value of rank 'percent' (Nearest rank) of sorted samples
+static double getPercentile(const vector<double>& sorted, double percent)
+{
+	size_t rank = (size_t)ceil(percent / 100.0 * sorted.size());
+	return sorted[rank > 0 ? min(rank, sorted.size()) - 1 : 0];
+}
+
+BenchmarkStatistics computeStatistics(vector<double> samples)
+{
+	BenchmarkStatistics statistics = {0, 0, 0, 0, 0, 0};
+	if (samples.size() == 0)
+		return statistics;
+
+	sort(samples.begin(), samples.end());
+
+	double sum = 0;
+	for(size_t i = 0; i < samples.size(); i++)
+		sum += samples[i];
+
+	statistics.mean = sum / samples.size();
+	statistics.median = getPercentile(samples, 50);
+	statistics.p90 = getPercentile(samples, 90);
+	statistics.p99 = getPercentile(samples, 99);
+	statistics.min = samples[0];
+
+	vector<double> deviations(samples.size());
+	for(size_t i = 0; i < samples.size(); i++)
+		deviations[i] = fabs(samples[i] - statistics.median);
+	sort(deviations.begin(), deviations.end());
+	statistics.mad = getPercentile(deviations, 50);
+
+	return statistics;
+}
+
+// Collect the times of the runs of one result, the warm-up runs (JIT, first touch...) are not kept.
+// The device time is read from the profiler, when the queue supports it.
+class BenchmarkSampler
+{
+public:
+	BenchmarkSampler(clppContext* context, const BenchmarkOptions& options)
+	{
+		_profiler = context->getProfiler();
+		_keepRecords = options.profile;
+		_warmups = options.warmups;
+		_runs = 0;
+		_firstRecord = 0;
+	}
+
+	// Call just before and just after the operation (Including its waitCompletion)
+	void start()
+	{
+		if (_profiler->isEnabled())
+		{
+			// Only the records of this run are needed, unless the trace is written
+			if (!_keepRecords)
+				_profiler->clear();
+			_firstRecord = _profiler->getRecords().size();
+		}
+
+		_stopWatch.StartTimer();
+	}
+
+	void stop()
+	{
+		_stopWatch.StopTimer();
+		if (_runs++ < _warmups)
+			return;
+
+		_hostTimes.push_back(_stopWatch.GetElapsedTime());
+		if (_profiler->isEnabled())
+			_deviceTimes.push_back(_profiler->getDeviceSpan(_firstRecord) * 1e-6);
+	}
+
+	// Set the times and the throughput of the result
+	void fill(BenchmarkResult& result)
+	{
+		result.loops = (unsigned int)_hostTimes.size();
+		result.warmups = _warmups;
+		result.hostTime = computeStatistics(_hostTimes);
+		result.deviceTime = computeStatistics(_deviceTimes);
+		result.hasDeviceTime = _deviceTimes.size() > 0;
+		result.time = result.hasDeviceTime ? result.deviceTime.median : result.hostTime.median;
+		result.baselineTime = 0;
+		result.regressed = false;
+		fillThroughput(result);
+	}
+
+private:
+	clppProfiler* _profiler;
+	bool _keepRecords;
+	size_t _firstRecord;
+
+	StopWatch _stopWatch;
+	unsigned int _warmups;
+	unsigned int _runs;
+
+	vector<double> _hostTimes;
+	vector<double> _deviceTimes;
+};
+
+#pragma endregion
+
+#pragma region Baseline
+
+// The name tells apart the results of a same run (Ex: the value types of the typed scans)
+static string getResultKey(const string& primitive, const string& algorithm, const string& name, const string& layout, unsigned int bits, unsigned int datasetSize, const string& distribution)
+{
+	ostringstream key;
+	key << primitive << "/" << algorithm << "/" << name << "/" << layout << "/" << bits << "/" << datasetSize << "/" << distribution;
+	return key.str();
+}
+
+// Split a CSV line, the fields can be quoted
+static vector<string> splitCSV(const string& line)
+{
+	vector<string> fields(1);
+	bool quoted = false;
+	for(size_t i = 0; i < line.length(); i++)
+	{
+		char c = line[i];
+		if (c == '"')
+			quoted = !quoted;
+		else if (c == ',' && !quoted)
+			fields.push_back("");
+		else if (c != '\r')
+			fields.back() += c;
+	}
+	return fields;
+}
+
+// Read the median times of a previous CSV output (--format csv)
+bool loadBaseline(const string& fileName, map<string, double>& baseline)
+{
+	ifstream file(fileName.c_str());
+	string line;
+	if (!file.is_open() || !getline(file, line))
+		return false;
+
+	//---- The columns, by name
+	vector<string> header = splitCSV(line);
+	map<string, size_t> columns;
+	for(size_t i = 0; i < header.size(); i++)
+		columns[header[i]] = i;
+
+	const char* needed[] = { "primitive", "algorithm", "name", "layout", "bits", "size", "distribution", "time_ms" };
+	for(size_t i = 0; i < sizeof(needed) / sizeof(needed[0]); i++)
+		if (columns.find(needed[i]) == columns.end())
+			return false;
+
+	while(getline(file, line))
+	{
+		vector<string> fields = splitCSV(line);
+		if (fields.size() != header.size())
+			continue;
+
+		string key = getResultKey(fields[columns["primitive"]], fields[columns["algorithm"]], fields[columns["name"]], fields[columns["layout"]],
+			atoi(fields[columns["bits"]].c_str()), atoi(fields[columns["size"]].c_str()), fields[columns["distribution"]]);
+		baseline[key] = atof(fields[columns["time_ms"]].c_str());
+	}
+
+	return true;
+}
+
+// A result is a regression when its median is slower than the baseline by more than the threshold
+void compareBaseline(const BenchmarkOptions& options, const map<string, double>& baseline, vector<BenchmarkResult>& results)
+{
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		BenchmarkResult& r = results[i];
+		string key = getResultKey(r.primitive, options.algorithm, r.algorithm, r.keysOnly ? "keys" : "kv", r.bits, r.datasetSize, getDistributionName(r.distribution));
+
+		map<string, double>::const_iterator it = baseline.find(key);
+		if (it == baseline.end() || it->second <= 0)
+			continue;
+
+		r.baselineTime = it->second;
+		r.regressed = r.time > r.baselineTime * (1 + options.threshold / 100);
+	}
+}
+
+#pragma endregion
+
+#pragma region benchmark_scan
+
+BenchmarkResult benchmark_scan(clppContext* context, clppScan* scan, const BenchmarkOptions& options, unsigned int datasetSize)
+{
+	BenchmarkResult result;
+	result.primitive = "scan";
+	result.algorithm = scan->getName();
+	result.keysOnly = true;
+	result.bits = 32;
+	result.datasetSize = datasetSize;
+	result.distribution = Distribution_Uniform;
+	result.elementSize = sizeof(int);
+	result.passed = true;
+
+	//---- Create a set of data
+	unsigned int* values = (unsigned int*)malloc(datasetSize * sizeof(int));
+	unsigned int* cpuScanValues = (unsigned int*)malloc(datasetSize * sizeof(int));
+
+	BenchmarkSampler sampler(context, options);
+	for(unsigned int i = 0; i < options.warmups + options.loops; i++)
+	{
+		//makeOneVector(values, datasetSize);
+		makeRandomInt32Vector(values, datasetSize, 8, true);
+
+		//---- Scan : default
+		memcpy(cpuScanValues, values, datasetSize * sizeof(int));
+		cpuScanValues[0] = 0;
+		for(unsigned int j = 1; j < datasetSize; j++)
+			cpuScanValues[j] = cpuScanValues[j-1] + values[j - 1];
+
+		//--- Scan
+		scan->pushDatas(values, datasetSize);
+
+		sampler.start();
+		scan->scan();
+		scan->waitCompletion();
+		sampler.stop();
+
+		scan->popDatas();
+
+		//---- Check the scan
+		for(unsigned int j = 0; j < datasetSize; j++)
+			if (values[j] != cpuScanValues[j])
+			{
+				cerr << "Algorithm FAILED : Scan" << endl;
+				result.passed = false;
+				break;
+			}
+	}
+
+	sampler.fill(result);
+
+	//---- Free
+	free(values);
+	free(cpuScanValues);
+
+	return result;
+}
+
+#pragma endregion
+
+#pragma region Scan checks
+
+static clppScanAlgorithm getScanAlgorithm(const string& algorithm)
+{
+	if (algorithm == "default")
+		return ScanAlgorithm_Default;
+	if (algorithm == "gpu")
+		return ScanAlgorithm_GPU;
+	if (algorithm == "lookback")
+		return ScanAlgorithm_LookBack;
+
+	return ScanAlgorithm_Best;
+}
+
+static BenchmarkResult createCheckResult(const string& primitive, const string& algorithm, unsigned int datasetSize, size_t elementSize)
+{
+	BenchmarkResult result;
+	result.primitive = primitive;
+	result.algorithm = algorithm;
+	result.keysOnly = true;
+	result.bits = 32;
+	result.datasetSize = datasetSize;
+	result.distribution = Distribution_Uniform;
+	result.elementSize = elementSize;
+	result.passed = true;
+	return result;
+}
+
+// Small values : the float sums stay exact up to 2^24
+template <typename T>
+static void makeScanValues(T* values, size_t datasetSize, unsigned int range)
+{
+	for(size_t i = 0; i < datasetSize; i++)
+		values[i] = (T)(rand() % range);
+}
+
+struct CpuSum
+{
+	template <typename T> T operator()(T a, T b) const { return a + b; }
+};
+
+// The CPU reference : the exclusive (or inclusive) scan of 'values' with 'op' ('results' can be 'values')
+template <typename T, typename Operator>
+static void cpuScan(const T* values, T* results, size_t datasetSize, bool inclusive, T identity, Operator op)
+{
+	T sum = identity;
+	for(size_t i = 0; i < datasetSize; i++)
+	{
+		T value = values[i];
+		if (inclusive)
+			sum = op(sum, value);
+		results[i] = sum;
+		if (!inclusive)
+			sum = op(sum, value);
+	}
+}
+
+template <typename T>
+static bool isSameValue(T a, T b) { return a == b; }
+static bool isSameValue(float a, float b) { return fabs(a - b) <= 1e-5f * max(1.0f, fabs(b)); }
+static bool isSameValue(double a, double b) { return fabs(a - b) <= 1e-12 * max(1.0, fabs(b)); }
+
+template <typename T>
+static bool checkValues(const T* values, const T* expected, size_t datasetSize, const string& checkName)
+{
+	for(size_t i = 0; i < datasetSize; i++)
+		if (!isSameValue(values[i], expected[i]))
+		{
+			cerr << "Algorithm FAILED : " << checkName << " (index " << i << ")" << endl;
+			return false;
+		}
+
+	return true;
+}
+
+// Runs a check of a primitive against its CPU reference : the warm-up and the timed runs, the comparison of the results.
+// The 'Check' owns the primitive and its inputs :
+//   Result, resultsSize : the type and the number of the results compared to the CPU reference
+//   name, datasetSize, elementSize : the name, the number of values and the size of a value of the BenchmarkResult
+//   prepare(expected) : makes the inputs, computes the CPU reference and pushes the inputs
+//   run() : the timed part, up to the completion of the primitive
+//   pop(results, checkName) : retreives the results, and checks the other outputs (Ex: the kept inputs)
+template <typename Check>
+BenchmarkResult runCheck(clppContext* context, const BenchmarkOptions& options, const string& primitive, Check& check)
+{
+	typedef typename Check::Result Result;
+
+	BenchmarkResult result = createCheckResult(primitive, check.name, check.datasetSize, check.elementSize);
+
+	vector<Result> expected(check.resultsSize);
+	vector<Result> results(check.resultsSize);
+
+	BenchmarkSampler sampler(context, options);
+	for(unsigned int i = 0; i < options.warmups + options.loops; i++)
+	{
+		check.prepare(&expected[0]);
+
+		sampler.start();
+		check.run();
+		sampler.stop();
+
+		result.passed &= check.pop(&results[0], result.algorithm);
+		result.passed &= checkValues(&results[0], &expected[0], check.resultsSize, result.algorithm);
+	}
+
+	sampler.fill(result);
+
+	return result;
+}
+
+// The exclusive scan of the values made by 'makeValues', against cpuScan with 'cpuOp' and 'identity'
+template <typename T, typename Operator>
+struct ScanCheck
+{
+	typedef T Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppScan* scan;
+	T identity;
+	Operator cpuOp;
+	void (*makeValues)(T* values, size_t datasetSize);
+	vector<T> values;
+
+	ScanCheck(clppScan* scan, const string& checkName, T identity, Operator cpuOp, void (*makeValues)(T*, size_t), unsigned int datasetSize) :
+		name(scan->getName() + " : " + checkName), datasetSize(datasetSize), elementSize(sizeof(T)), resultsSize(datasetSize),
+		scan(scan), identity(identity), cpuOp(cpuOp), makeValues(makeValues), values(datasetSize)
+	{
+	}
+
+	~ScanCheck() { delete scan; }
+
+	void prepare(T* expected)
+	{
+		makeValues(&values[0], datasetSize);
+		cpuScan(&values[0], expected, datasetSize, false, identity, cpuOp);
+		scan->pushDatas(&values[0], datasetSize);
+	}
+
+	void run()
+	{
+		scan->scan();
+		scan->waitCompletion();
+	}
+
+	bool pop(T* results, const string& /*checkName*/)
+	{
+		scan->popDatas(results);
+		return true;
+	}
+};
+
+// Small values : the float sums stay exact
+template <typename T>
+static void makeTypedValues(T* values, size_t datasetSize)
+{
+	makeScanValues(values, datasetSize, 4);
+}
+
+// The exclusive sum of the values of type 'valueType' (T on the host side)
+template <typename T>
+BenchmarkResult benchmark_scan_typed(clppContext* context, const BenchmarkOptions& options, clppValueType valueType, unsigned int datasetSize)
+{
+	clppScan* scan = clpp::createBestScan(context, valueType, datasetSize, getScanAlgorithm(options.algorithm));
+	ScanCheck<T, CpuSum> check(scan, clppProgram::getValueTypeName(valueType), (T)0, CpuSum(), makeTypedValues<T>, datasetSize);
+
+	return runCheck(context, options, "typed", check);
+}
+
+void benchmark_typed(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_scan_typed<cl_uint>(context, options, Value_UInt, datasetSize) );
+	results.push_back( benchmark_scan_typed<cl_float>(context, options, Value_Float, datasetSize) );
+	if (context->supportsDouble)
+		results.push_back( benchmark_scan_typed<cl_double>(context, options, Value_Double, datasetSize) );
+	else
+		cerr << "The device doesn't support the double precision : the double scan is not checked" << endl;
+	results.push_back( benchmark_scan_typed<cl_long>(context, options, Value_Long, datasetSize) );
+	results.push_back( benchmark_scan_typed<cl_ulong>(context, options, Value_ULong, datasetSize) );
+}
+
+struct CpuMin
+{
+	template <typename T> T operator()(T a, T b) const { return b < a ? b : a; }
+};
+
+struct CpuMax
+{
+	template <typename T> T operator()(T a, T b) const { return a < b ? b : a; }
+};
+
+struct CpuProduct
+{
+	template <typename T> T operator()(T a, T b) const { return a * b; }
+};
+
+struct CpuOr
+{
+	template <typename T> T operator()(T a, T b) const { return a | b; }
+};
+
+// The affine maps x -> a * x + b, composed in the data set order : an associative but non-commutative operator
+struct CpuAffine
+{
+	cl_uint a;
+	cl_uint b;
+
+	bool operator==(const CpuAffine& other) const { return a == other.a && b == other.b; }
+};
+
+struct CpuCompose
+{
+	CpuAffine operator()(CpuAffine first, CpuAffine second) const
+	{
+		CpuAffine composed = { second.a * first.a, second.a * first.b + second.b };
+		return composed;
+	}
+};
+
+static const CpuAffine cpuAffineIdentity = { 1, 0 };
+
+static clppOperator createAffineOperator()
+{
+	return clppOperator(sizeof(CpuAffine),
+		"typedef struct { uint a; uint b; } Affine;\n"
+		"#define T Affine\n"
+		"#define OPERATOR_APPLY(A,B) ((Affine){(B).a * (A).a, (B).a * (A).b + (B).b})\n"
+		"#define OPERATOR_IDENTITY ((Affine){1, 0})\n");
+}
+
+// Odd values : the products never become 0
+static void makeOperatorValues(cl_uint* values, size_t datasetSize)
+{
+	for(size_t i = 0; i < datasetSize; i++)
+		values[i] = 1 + 2 * (rand() % 128);
+}
+
+static void makeOperatorValues(CpuAffine* values, size_t datasetSize)
+{
+	for(size_t i = 0; i < datasetSize; i++)
+	{
+		values[i].a = 1 + 2 * (rand() % 2);
+		values[i].b = rand() % 10;
+	}
+}
+
+// The exclusive scan with 'op', 'cpuOp' and 'identity' are its CPU version
+template <typename T, typename Operator>
+BenchmarkResult benchmark_scan_operator(clppContext* context, const BenchmarkOptions& options, const clppOperator& op, const string& opName, T identity, Operator cpuOp, unsigned int datasetSize)
+{
+	clppScan* scan = clpp::createBestScan(context, op, datasetSize, getScanAlgorithm(options.algorithm));
+	ScanCheck<T, Operator> check(scan, opName, identity, cpuOp, static_cast<void (*)(T*, size_t)>(makeOperatorValues), datasetSize);
+
+	return runCheck(context, options, "operators", check);
+}
+
+void benchmark_operators(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_scan_operator<cl_uint>(context, options, clppOperator::minimum(Value_UInt), "min", 0xFFFFFFFF, CpuMin(), datasetSize) );
+	results.push_back( benchmark_scan_operator<cl_uint>(context, options, clppOperator::maximum(Value_UInt), "max", 0, CpuMax(), datasetSize) );
+	results.push_back( benchmark_scan_operator<cl_uint>(context, options, clppOperator::product(Value_UInt), "product", 1, CpuProduct(), datasetSize) );
+	results.push_back( benchmark_scan_operator<cl_uint>(context, options, clppOperator::bitwiseOr(Value_UInt), "or", 0, CpuOr(), datasetSize) );
+	results.push_back( benchmark_scan_operator<CpuAffine>(context, options, createAffineOperator(), "affine", cpuAffineIdentity, CpuCompose(), datasetSize) );
+}
+
+// clppReduce with 'op', against the CPU reduction
+template <typename T, typename Operator>
+struct ReduceCheck
+{
+	typedef T Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppReduce* reduce;
+	T identity;
+	Operator cpuOp;
+	vector<T> values;
+
+	ReduceCheck(clppReduce* reduce, const string& opName, T identity, Operator cpuOp, unsigned int datasetSize) :
+		name(reduce->getName() + " : " + opName), datasetSize(datasetSize), elementSize(sizeof(T)), resultsSize(1),
+		reduce(reduce), identity(identity), cpuOp(cpuOp), values(datasetSize)
+	{
+	}
+
+	~ReduceCheck() { delete reduce; }
+
+	void prepare(T* expected)
+	{
+		makeOperatorValues(&values[0], datasetSize);
+
+		*expected = identity;
+		for(unsigned int j = 0; j < datasetSize; j++)
+			*expected = cpuOp(*expected, values[j]);
+
+		reduce->pushDatas(&values[0], datasetSize);
+	}
+
+	void run()
+	{
+		reduce->reduce();
+		reduce->waitCompletion();
+	}
+
+	bool pop(T* results, const string& /*checkName*/)
+	{
+		reduce->popResult(results);
+		return true;
+	}
+};
+
+template <typename T, typename Operator>
+BenchmarkResult benchmark_reduce_operator(clppContext* context, const BenchmarkOptions& options, const clppOperator& op, const string& opName, T identity, Operator cpuOp, unsigned int datasetSize)
+{
+	ReduceCheck<T, Operator> check(new clppReduce(context, op, datasetSize), opName, identity, cpuOp, datasetSize);
+
+	return runCheck(context, options, "reduce", check);
+}
+
+void benchmark_reduce(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_reduce_operator<cl_uint>(context, options, clppOperator::sum(Value_UInt), "sum", 0, CpuSum(), datasetSize) );
+	results.push_back( benchmark_reduce_operator<cl_uint>(context, options, clppOperator::minimum(Value_UInt), "min", 0xFFFFFFFF, CpuMin(), datasetSize) );
+	results.push_back( benchmark_reduce_operator<cl_uint>(context, options, clppOperator::maximum(Value_UInt), "max", 0, CpuMax(), datasetSize) );
+	results.push_back( benchmark_reduce_operator<CpuAffine>(context, options, createAffineOperator(), "affine", cpuAffineIdentity, CpuCompose(), datasetSize) );
+}
+
+// The exclusive or inclusive scan, in place or to an output buffer (Then the values must be kept)
+struct ScanModeCheck
+{
+	typedef unsigned int Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppContext* context;
+	clppScan* scan;
+	bool inclusive;
+	bool outOfPlace;
+	cl_mem clBuffer_values;
+	cl_mem clBuffer_output;
+	vector<unsigned int> values;
+	vector<unsigned int> keptValues;
+
+	ScanModeCheck(clppContext* context, clppScan* scan, bool inclusive, bool outOfPlace, unsigned int datasetSize) :
+		datasetSize(datasetSize), elementSize(sizeof(int)), resultsSize(datasetSize),
+		context(context), scan(scan), inclusive(inclusive), outOfPlace(outOfPlace), clBuffer_values(0), clBuffer_output(0),
+		values(datasetSize), keptValues(datasetSize)
+	{
+		name = scan->getName() + " : " + (inclusive ? "inclusive" : "exclusive") + (outOfPlace ? ", out-of-place" : ", in place");
+
+		scan->setInclusive(inclusive);
+
+		//---- Out-of-place : our own input and output buffers
+		if (outOfPlace)
+		{
+			cl_int clStatus;
+			clBuffer_values = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, datasetSize * sizeof(int), NULL, &clStatus);
+			clppProgram::checkCLStatus(clStatus);
+			clBuffer_output = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, datasetSize * sizeof(int), NULL, &clStatus);
+			clppProgram::checkCLStatus(clStatus);
+			scan->setOutput(clBuffer_output);
+		}
+	}
+
+	~ScanModeCheck()
+	{
+		delete scan;
+
+		if (clBuffer_values) clReleaseMemObject(clBuffer_values);
+		if (clBuffer_output) clReleaseMemObject(clBuffer_output);
+	}
+
+	void prepare(unsigned int* expected)
+	{
+		makeScanValues(&values[0], datasetSize, 256);
+		cpuScan(&values[0], expected, datasetSize, inclusive, 0u, CpuSum());
+
+		if (outOfPlace)
+		{
+			cl_int clStatus = clEnqueueWriteBuffer(context->clQueue, clBuffer_values, CL_TRUE, 0, datasetSize * sizeof(int), &values[0], 0, NULL, NULL);
+			clppProgram::checkCLStatus(clStatus);
+			scan->pushCLDatas(clBuffer_values, datasetSize);
+		}
+		else
+			scan->pushDatas(&values[0], datasetSize);
+	}
+
+	void run()
+	{
+		scan->scan();
+		scan->waitCompletion();
+	}
+
+	bool pop(unsigned int* results, const string& checkName)
+	{
+		scan->popDatas(results);
+		if (!outOfPlace)
+			return true;
+
+		//---- The values are kept
+		cl_int clStatus = clEnqueueReadBuffer(context->clQueue, clBuffer_values, CL_TRUE, 0, datasetSize * sizeof(int), &keptValues[0], 0, NULL, NULL);
+		clppProgram::checkCLStatus(clStatus);
+		return checkValues(&keptValues[0], &values[0], datasetSize, checkName + " (values)");
+	}
+};
+
+BenchmarkResult benchmark_scan_mode(clppContext* context, const BenchmarkOptions& options, bool inclusive, bool outOfPlace, unsigned int datasetSize)
+{
+	clppScan* scan = clpp::createBestScan(context, Value_UInt, datasetSize, getScanAlgorithm(options.algorithm));
+	ScanModeCheck check(context, scan, inclusive, outOfPlace, datasetSize);
+
+	return runCheck(context, options, "inclusive", check);
+}
+
+void benchmark_inclusive(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_scan_mode(context, options, true, false, datasetSize) );
+	results.push_back( benchmark_scan_mode(context, options, false, true, datasetSize) );
+	results.push_back( benchmark_scan_mode(context, options, true, true, datasetSize) );
+}
+
+// The scan with its grand total : to the internal buffer, or to the value 'totalIndex' of a caller's buffer
+// (The other values must be kept)
+struct TotalCheck
+{
+	enum { totalIndex = 2, totalsCount = 4 };
+
+	typedef unsigned int Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppContext* context;
+	clppScan* scan;
+	bool callerBuffer;
+	cl_mem clBuffer_totals;
+	vector<unsigned int> values;
+	unsigned int cpuTotal;
+	unsigned int untouched;
+
+	TotalCheck(clppContext* context, clppScan* scan, bool callerBuffer, unsigned int datasetSize) :
+		name(scan->getName() + (callerBuffer ? " : total to a buffer" : " : total")), datasetSize(datasetSize), elementSize(sizeof(int)), resultsSize(datasetSize),
+		context(context), scan(scan), callerBuffer(callerBuffer), clBuffer_totals(0), values(datasetSize), cpuTotal(0), untouched(0xDEADBEEF)
+	{
+		if (callerBuffer)
+		{
+			cl_int clStatus;
+			clBuffer_totals = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, totalsCount * sizeof(int), NULL, &clStatus);
+			clppProgram::checkCLStatus(clStatus);
+			scan->setTotal(true, clBuffer_totals, totalIndex);
+		}
+		else
+			scan->setTotal(true);
+	}
+
+	~TotalCheck()
+	{
+		delete scan;
 
-#include "clpp/StopWatch.h"
-#include "clpp/clppScan.h"
-#include "clpp/clppScan_Default.h"
-#include "clpp/clppScan_GPU.h"
+		if (clBuffer_totals)
+			clReleaseMemObject(clBuffer_totals);
+	}
 
-#include "clpp/clppSort_CPU.h"
-#include "clpp/clppSort_RadixSort.h"
-#include "clpp/clppSort_RadixSortGPU.h"
-#include "clpp/clppSort_BitonicSort.h"
-#include "clpp/clppSort_BitonicSortGPU.h"
+	void prepare(unsigned int* expected)
+	{
+		makeScanValues(&values[0], datasetSize, 256);
+		cpuScan(&values[0], expected, datasetSize, false, 0u, CpuSum());
+		cpuTotal = expected[datasetSize - 1] + values[datasetSize - 1];
 
-#include "clpp/clppCount.h"
-#include "clpp/clppScan.h"
+		if (callerBuffer)
+		{
+			unsigned int totals[totalsCount];
+			for(unsigned int t = 0; t < totalsCount; t++)
+				totals[t] = untouched;
+			cl_int clStatus = clEnqueueWriteBuffer(context->clQueue, clBuffer_totals, CL_TRUE, 0, sizeof(totals), totals, 0, NULL, NULL);
+			clppProgram::checkCLStatus(clStatus);
+		}
 
-#include <string.h>
-#include <vector>
+		scan->pushDatas(&values[0], datasetSize);
+	}
 
-using namespace std;
+	void run()
+	{
+		scan->scan();
+		scan->waitCompletion();
+	}
 
-void makeOneVector(unsigned int* a, unsigned int numElements);
-void makeRandomInt32Vector(unsigned int *a, unsigned int numElements, unsigned int keybits, bool keysOnly);
+	bool pop(unsigned int* results, const string& checkName)
+	{
+		unsigned int totals[totalsCount];
+		if (callerBuffer)
+		{
+			cl_int clStatus = clEnqueueReadBuffer(context->clQueue, clBuffer_totals, CL_TRUE, 0, sizeof(totals), totals, 0, NULL, NULL);
+			clppProgram::checkCLStatus(clStatus);
+		}
+		else
+			scan->popTotal(&totals[totalIndex]);
 
-void benchmark_scan(clppContext* context, clppScan* scan, int datasetSize);
-void benchmark_sort(clppContext context, clppSort* sort, unsigned int datasetSize, unsigned int bits);
-void benchmark_sort_KV(clppContext context, clppSort* sort, unsigned int datasetSize, unsigned int bits);
+		scan->popDatas(results);
 
-bool checkIsSorted(unsigned int* tocheck, size_t datasetSize, string algorithmName, bool keysOnly, int sortId);
-bool checkHasLooseDatasKV(unsigned int* unsorted, unsigned int* sorted, size_t datasetSize, string algorithmName);
+		//---- The total, and the other values of the caller's buffer
+		bool passed = checkValues(&totals[totalIndex], &cpuTotal, 1, checkName + " (total)");
+		if (callerBuffer)
+			for(unsigned int t = 0; t < totalsCount; t++)
+				if (t != totalIndex)
+					passed &= checkValues(&totals[t], &untouched, 1, checkName + " (other totals)");
 
-void test_Scan(clppContext* context);
-void test_Sort(clppContext* context);
-void test_Sort_KV(clppContext* context);
-void test_Count(clppContext* context);
+		return passed;
+	}
+};
 
-//unsigned int datasetSizes[8] = {262144, 128000, 256000, 512000, 1024000, 2048000, 4096000, 8196000};
-//unsigned int datasetSizes[8] = {16000, 128000, 256000, 512000, 1024000, 2048000, 4096000, 8196000};
+BenchmarkResult benchmark_scan_total(clppContext* context, const BenchmarkOptions& options, bool callerBuffer, unsigned int datasetSize)
+{
+	clppScan* scan = clpp::createBestScan(context, Value_UInt, datasetSize, getScanAlgorithm(options.algorithm));
+	TotalCheck check(context, scan, callerBuffer, datasetSize);
 
-// Small problems
-//unsigned int datasetSizes[10] = {100000, 200000, 300000, 400000, 500000, 600000, 700000, 800000, 900000, 1000000};
+	return runCheck(context, options, "total", check);
+}
 
-unsigned int datasetSizes[10] = {1<<10, 1<<12, 1<<13, 1<<14, 1<<15, 1<<16, 1<<17, 1<<18, 1<<19, 1<<20};
-//unsigned int datasetSizes[10] = {40960, 1<<12, 1<<13, 1<<14, 1<<15, 1<<16, 1<<17, 1<<18, 1<<19, 1<<20};
-//unsigned int datasetSizes[10] = {256*256, 1<<12, 1<<13, 1<<14, 1<<15, 1<<16, 1<<17, 1<<18, 1<<19, 1<<20};
+void benchmark_total(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_scan_total(context, options, false, datasetSize) );
+	results.push_back( benchmark_scan_total(context, options, true, datasetSize) );
+}
 
-// Big problems
-//unsigned int datasetSizes[10] = {16000000, 32000000, 48000000, 64000000, 80000000, 96000000, 112000000, 128000000, 144000000, 160000000};
+// Short random segments (16 values on average), the first value starts a segment
+static void makeHeadFlags(unsigned int* flags, size_t datasetSize)
+{
+	for(size_t i = 0; i < datasetSize; i++)
+		flags[i] = (i == 0 || (rand() % 16) == 0) ? 1 : 0;
+}
 
-unsigned int datasetSizesCount = 10;
+// The CPU reference of the segmented scans : the exclusive sum restarts at each head flag
+static void cpuSegmentedScan(const unsigned int* values, const unsigned int* flags, unsigned int* results, size_t datasetSize)
+{
+	unsigned int sum = 0;
+	for(size_t i = 0; i < datasetSize; i++)
+	{
+		if (flags[i])
+			sum = 0;
 
-StopWatch* stopWatcher = new StopWatch();
+		unsigned int value = values[i];
+		results[i] = sum;
+		sum += value;
+	}
+}
 
-int main(int argc, const char** argv)
+// How the segments are given to the segmented scan
+enum SegmentsCheck
 {
-	clppProgram::setBasePath("src/clpp/");
+	Segments_Flags,		// Head flags, from the host
+	Segments_Offsets,	// The offsets of the first values, in a device buffer
+	Segments_Keys,		// Scan-by-key : a key per value, in a device buffer
+	Segments_Pairs		// Scan-by-key of the interleaved key-value pairs, in place
+};
 
-	//---- Prepare a clpp Context
-	clppContext context;
-	context.setup(0, 0);
-	context.printInformation();
+// The segmented scan : the head flags are also the starts of the runs of equal keys
+struct SegmentedScanCheck
+{
+	typedef unsigned int Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppContext* context;
+	clppSegmentedScan* scan;
+	SegmentsCheck segments;
+	cl_mem clBuffer_segments;
+	vector<unsigned int> values;
+	vector<unsigned int> flags;
+	vector<unsigned int> segmentsDatas;
+	vector<unsigned int> pairs;
+
+	SegmentedScanCheck(clppContext* context, clppSegmentedScan* scan, SegmentsCheck segments, unsigned int datasetSize) :
+		datasetSize(datasetSize), elementSize(sizeof(int)), resultsSize(datasetSize),
+		context(context), scan(scan), segments(segments), clBuffer_segments(0),
+		values(datasetSize), flags(datasetSize), segmentsDatas((segments == Segments_Pairs ? 2 : 1) * datasetSize)
+	{
+		const char* segmentsNames[] = { "flags", "offsets", "keys", "key-value pairs" };
+		name = scan->getName() + " : " + segmentsNames[segments];
 
-	// Scan
-	test_Scan(&context);
+		//---- The device buffer of the offsets, the keys or the pairs
+		if (segments != Segments_Flags)
+		{
+			cl_int clStatus;
+			clBuffer_segments = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, segmentsDatas.size() * sizeof(int), NULL, &clStatus);
+			clppProgram::checkCLStatus(clStatus);
+		}
+	}
 
-	getchar();
+	~SegmentedScanCheck()
+	{
+		delete scan;
 
-	// Sorting : key
-	//test_Sort(&context);
+		if (clBuffer_segments)
+			clReleaseMemObject(clBuffer_segments);
+	}
 
-	// Sorting : key + value
-	//test_Sort_KV(&context);
+	void prepare(unsigned int* expected)
+	{
+		makeScanValues(&values[0], datasetSize, 256);
+		makeHeadFlags(&flags[0], datasetSize);
+		cpuSegmentedScan(&values[0], &flags[0], expected, datasetSize);
 
-	// Count
-	//test_Count(&context);
-}
+		if (segments == Segments_Flags)
+		{
+			scan->pushDatas(&values[0], datasetSize);
+			scan->pushFlags(&flags[0]);
+		}
+		else if (segments == Segments_Offsets)
+		{
+			unsigned int count = 0;
+			for(unsigned int j = 0; j < datasetSize; j++)
+				if (flags[j])
+					segmentsDatas[count++] = j;
 
-#pragma region test_Scan
+			cl_int clStatus = clEnqueueWriteBuffer(context->clQueue, clBuffer_segments, CL_TRUE, 0, count * sizeof(int), &segmentsDatas[0], 0, NULL, NULL);
+			clppProgram::checkCLStatus(clStatus);
 
-void test_Scan(clppContext* context)
-{
-	std::vector<clppScan*> scans;
-	if (context->isCPU)
-		cout << "--------------- Scan : CPU scan" << endl;
-	else
-		cout << "--------------- Scan : GPU scan" << endl;
-	for (unsigned int i = 0; i < datasetSizesCount; i++)
-	{
-		if (context->isGPU) {
-			scans.push_back( new clppScan_GPU(context, sizeof(int), datasetSizes[i]));
+			scan->pushDatas(&values[0], datasetSize);
+			scan->pushCLSegmentOffsets(clBuffer_segments, count);
 		}
-		else {
-			scans.push_back( new clppScan_Default(context, sizeof(int), datasetSizes[i]));
+		else
+		{
+			//---- Sorted keys : a new key at each head flag
+			unsigned int stride = segments == Segments_Pairs ? 2 : 1;
+			unsigned int key = 0;
+			for(unsigned int j = 0; j < datasetSize; j++)
+			{
+				key += (j > 0 && flags[j]) ? 1 : 0;
+				segmentsDatas[stride * j] = key;
+				if (segments == Segments_Pairs)
+					segmentsDatas[stride * j + 1] = values[j];
+			}
+
+			cl_int clStatus = clEnqueueWriteBuffer(context->clQueue, clBuffer_segments, CL_TRUE, 0, segmentsDatas.size() * sizeof(int), &segmentsDatas[0], 0, NULL, NULL);
+			clppProgram::checkCLStatus(clStatus);
+
+			if (segments == Segments_Pairs)
+				scan->pushCLPairs(clBuffer_segments, datasetSize);
+			else
+			{
+				scan->pushDatas(&values[0], datasetSize);
+				scan->pushCLKeys(clBuffer_segments);
+			}
 		}
 	}
 
-	auto i = 0;
-	for (auto& scan : scans) {
-		benchmark_scan(context, scan, datasetSizes[i++]);
+	void run()
+	{
+		scan->scan();
+		scan->waitCompletion();
 	}
 
+	bool pop(unsigned int* results, const string& checkName)
+	{
+		if (segments != Segments_Pairs)
+		{
+			scan->popDatas(results);
+			return true;
+		}
+
+		//---- The values are scanned in place, the keys are kept
+		pairs.resize(segmentsDatas.size());
+		scan->popDatas(&pairs[0]);
 
-	for (auto& scan : scans) {
-		delete scan;
+		bool keysKept = true;
+		for(unsigned int j = 0; j < datasetSize; j++)
+		{
+			results[j] = pairs[2 * j + 1];
+			keysKept &= pairs[2 * j] == segmentsDatas[2 * j];
+		}
+
+		if (!keysKept)
+			cerr << "Algorithm FAILED : " << checkName << " (keys)" << endl;
+
+		return keysKept;
 	}
-}
+};
 
-#pragma endregion
+BenchmarkResult benchmark_segmented_scan(clppContext* context, const BenchmarkOptions& options, SegmentsCheck segments, unsigned int datasetSize)
+{
+	SegmentedScanCheck check(context, new clppSegmentedScan(context, Value_UInt, datasetSize), segments, datasetSize);
+
+	return runCheck(context, options, "segmented", check);
+}
 
-#pragma region test_Sort
+void benchmark_segmented(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_segmented_scan(context, options, Segments_Flags, datasetSize) );
+	results.push_back( benchmark_segmented_scan(context, options, Segments_Offsets, datasetSize) );
+	results.push_back( benchmark_segmented_scan(context, options, Segments_Keys, datasetSize) );
+	results.push_back( benchmark_segmented_scan(context, options, Segments_Pairs, datasetSize) );
+}
 
-void test_Sort(clppContext* context)
+// The batched scan of the rows of 'length' values, 'rowPitch' values apart, with the totals of the rows.
+// The padding after the rows must be kept.
+struct BatchedScanCheck
 {
-	//---- Brute force
-	/*cout << "--------------- Brute force sort" << endl;
-	for(unsigned int i = 0; i < datasetSizesCount; i++)
+	typedef unsigned int Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppBatchedScan* scan;
+	unsigned int rows;
+	unsigned int length;
+	unsigned int rowPitch;
+	vector<unsigned int> values;
+	vector<unsigned int> rowTotals;
+	vector<unsigned int> cpuRowTotals;
+
+	BatchedScanCheck(clppBatchedScan* scan, unsigned int rows, unsigned int length, unsigned int rowPitch, unsigned int datasetSize) :
+		datasetSize(datasetSize), elementSize(sizeof(int)), resultsSize(datasetSize),
+		scan(scan), rows(rows), length(length), rowPitch(rowPitch), values(datasetSize), rowTotals(rows), cpuRowTotals(rows)
 	{
-		clppSort* clppsort = new clppSort_CPU(context);
-		benchmark_sort(*context, clppsort, datasetSizes[i], PARAM_SORT_BITS);
-		delete clppsort;
-	}*/
+		scan->setLayout(rows, length, rowPitch);
+		scan->setTotal(true);
+
+		ostringstream checkName;
+		checkName << scan->getName() << " : " << rows << " rows of " << length;
+		name = checkName.str();
+	}
 
-	//---- Radix-sort : CPU : generic version
-	//if (context->isCPU)
-	//{
-	//	cout << "--------------- CPU : Key : Radix sort" << endl;
-	//	for(unsigned int i = 0; i < datasetSizesCount; i++)
-	//	{
-	//		clppSort* clppsort = new clppSort_RadixSort(context, datasetSizes[i], PARAM_SORT_BITS, true);
-	//		benchmark_sort(*context, clppsort, datasetSizes[i], PARAM_SORT_BITS);
-	//		delete clppsort;
-	//	}
-	//}
+	~BatchedScanCheck() { delete scan; }
 
-	//---- Radix-sort : GPU : Satish version
-	if (context->isGPU)
+	void prepare(unsigned int* expected)
 	{
-		cout << "--------------- GPU : Key : Satish radix sort" << endl;
-		for(unsigned int i = 0; i < datasetSizesCount; i++)
+		makeScanValues(&values[0], datasetSize, 256);
+
+		memcpy(expected, &values[0], datasetSize * sizeof(int));
+		for(unsigned int r = 0; r < rows; r++)
 		{
-			clppSort* clppsort = new clppSort_RadixSortGPU(context, datasetSizes[i], PARAM_SORT_BITS, true);
-			benchmark_sort(*context, clppsort, datasetSizes[i], PARAM_SORT_BITS);
-			delete clppsort;
+			unsigned int* row = expected + (size_t)r * rowPitch;
+			cpuRowTotals[r] = row[length - 1];
+			cpuScan(row, row, length, false, 0u, CpuSum());
+			cpuRowTotals[r] += row[length - 1];
 		}
+
+		scan->pushDatas(&values[0], datasetSize);
 	}
 
-	//---- Bitonic-sort : GPU
-	if (context->isGPU)
+	void run()
 	{
-		cout << "--------------- GPU : Key : Bitonic sort" << endl;
-		for(unsigned int i = 0; i < datasetSizesCount; i++)
-		{
-			clppSort* clppsort = new clppSort_BitonicSortGPU(context, datasetSizes[i], true);
-			benchmark_sort(*context, clppsort, datasetSizes[i], PARAM_SORT_BITS);
-			delete clppsort;
-		}
+		scan->scan();
+		scan->waitCompletion();
 	}
 
-	// Merill
-	//memcpy(keys, keysCopy, datasetSize * sizeof(int));
-	//clppsort = new clppSort_Merill(context, datasetSize); // 128 = work group size
-	//benchmark_sort(*context, clppsort, keys, keysSorted, datasetSize);
-}
-
-#pragma endregion
+	bool pop(unsigned int* results, const string& checkName)
+	{
+		scan->popDatas(results);
+		scan->popRowTotals(&rowTotals[0]);
 
-#pragma region test_Sort_KV
+		return checkValues(&rowTotals[0], &cpuRowTotals[0], rows, checkName + " (row totals)");
+	}
+};
 
-void test_Sort_KV(clppContext* context)
+// A single row for a small data set
+BenchmarkResult benchmark_batched_scan(clppContext* context, const BenchmarkOptions& options, unsigned int length, unsigned int rowPitch, unsigned int datasetSize)
 {
-	////---- Satish Radix-sort : CPU
-	if (context->isCPU)
+	unsigned int rows = datasetSize / rowPitch;
+	if (rows == 0)
 	{
-		cout << "--------------- CPU : Key-Value : Satish sort" << endl;
-		for(unsigned int i = 0; i < datasetSizesCount; i++)
-		{
-			clppSort* clppsort = new clppSort_RadixSort(context, datasetSizes[i], PARAM_SORT_BITS, false);
-			benchmark_sort_KV(*context, clppsort, datasetSizes[i], PARAM_SORT_BITS);
-			delete clppsort;
-		}
+		rows = 1;
+		rowPitch = datasetSize;
+		length = rowPitch - rowPitch / 4;
 	}
 
-	////---- Bitonic-sort : CPU
-	//cout << "--------------- CPU : Key-Value : Bitonic sort" << endl;
-	//for(unsigned int i = 0; i < datasetSizesCount; i++)
-	//{
-	//	clppSort* clppsort = new clppSort_BitonicSortGPU(context, datasetSizes[i], false);
-	//	benchmark_sort_KV(*context, clppsort, datasetSizes[i], 32);
-	//	delete clppsort;
-	//}
+	BatchedScanCheck check(new clppBatchedScan(context, Value_UInt, datasetSize), rows, length, rowPitch, datasetSize);
+
+	return runCheck(context, options, "batched", check);
+}
 
-	//---- Satish Radix-sort : GPU
-	//if (context->isGPU)
-	//{
-	//	cout << "--------------- GPU : Key-Value : Satish sort" << endl;
-	//	for(unsigned int i = 0; i < datasetSizesCount; i++)
-	//	{
-	//		clppSort* clppsort = new clppSort_RadixSortGPU(context, datasetSizes[i], PARAM_SORT_BITS, false);
-	//		benchmark_sort_KV(*context, clppsort, datasetSizes[i], PARAM_SORT_BITS);
-	//		delete clppsort;
-	//	}
-	//}
+void benchmark_batched(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_batched_scan(context, options, 100, 128, datasetSize) );
+	results.push_back( benchmark_batched_scan(context, options, 3000, 3072, datasetSize) );
+}
 
-	//---- Bitonic-sort : GPU
-	if (context->isGPU)
+// The summed-area table of an image with a pitch (Its padding is ignored), with or without a border,
+// to the internal table or to a caller's table with a pitch
+struct Scan2DCheck
+{
+	typedef unsigned int Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppScan2D* scan;
+	unsigned int width, height, pitch;
+	unsigned int b;
+	unsigned int tableWidth, tableHeight, tablePitch;
+	cl_mem clBuffer_table;
+	vector<unsigned int> image;
+	vector<unsigned int> table;
+
+	Scan2DCheck(clppContext* context, clppScan2D* scan, bool border, bool callerTable, unsigned int maxElements) :
+		elementSize(sizeof(int)), scan(scan), clBuffer_table(0)
 	{
-		cout << "--------------- GPU : Key-Value : Bitonic sort" << endl;
-		for(unsigned int i = 0; i < datasetSizesCount; i++)
+		//---- A square-ish image, a few padding values per row
+		pitch = max(1u, (unsigned int)sqrt((double)maxElements));
+		width = pitch - pitch / 8;
+		height = maxElements / pitch;
+
+		b = border ? 1 : 0;
+		tableWidth = width + b;
+		tableHeight = height + b;
+		tablePitch = callerTable ? tableWidth + 5 : tableWidth;
+
+		datasetSize = width * height;
+		resultsSize = (size_t)tableHeight * tableWidth;
+		image.resize((size_t)height * pitch);
+		table.resize((size_t)tableHeight * tablePitch);
+
+		scan->setBorder(border);
+		if (callerTable)
 		{
-			clppSort* clppsort = new clppSort_BitonicSortGPU(context, datasetSizes[i], false);
-			benchmark_sort_KV(*context, clppsort, datasetSizes[i], PARAM_SORT_BITS);
-			delete clppsort;
+			cl_int clStatus;
+			clBuffer_table = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, table.size() * sizeof(int), NULL, &clStatus);
+			clppProgram::checkCLStatus(clStatus);
+			scan->setOutput(clBuffer_table, tablePitch);
 		}
+
+		ostringstream checkName;
+		checkName << scan->getName() << " : " << width << "x" << height << " pitch " << pitch << (border ? ", border" : "") << (callerTable ? ", pitched table" : "");
+		name = checkName.str();
 	}
-}
 
-#pragma endregion
+	~Scan2DCheck()
+	{
+		delete scan;
 
-#pragma region test_Count
+		if (clBuffer_table)
+			clReleaseMemObject(clBuffer_table);
+	}
 
-void test_Count(clppContext* context)
-{
-	int datasetSize = 100000;
+	void prepare(unsigned int* cpuTable)
+	{
+		makeScanValues(&image[0], image.size(), 256);
+
+		//---- The CPU table : the border is 0, table(x, y) = image(x, y) + table(x - 1, y) + table(x, y - 1) - table(x - 1, y - 1)
+		for(unsigned int y = 0; y < tableHeight; y++)
+			for(unsigned int x = 0; x < tableWidth; x++)
+			{
+				unsigned int* t = cpuTable + (size_t)y * tableWidth + x;
+				if (x < b || y < b)
+				{
+					*t = 0;
+					continue;
+				}
+
+				*t = image[(size_t)(y - b) * pitch + (x - b)];
+				if (x > 0) *t += t[-1];
+				if (y > 0) *t += t[-(int)tableWidth];
+				if (x > 0 && y > 0) *t -= t[-(int)tableWidth - 1];
+			}
+
+		scan->pushDatas(&image[0], width, height, pitch);
+	}
 
-	clppCount* counter = new clppCount(context, sizeof(int), 4, datasetSize);
+	void run()
+	{
+		scan->scan();
+		scan->waitCompletion();
+	}
 
-	//---- Prepare the datas-set
-	int* values = (int*)malloc(datasetSize * sizeof(int));
-	int possiblesValues[] = {1, 2, 4, 8, 16};
-	for(int i = 0; i < datasetSize; i++)
+	bool pop(unsigned int* gpuTable, const string& /*checkName*/)
 	{
-		values[i] = possiblesValues[(rand() % 5)];
+		scan->popDatas(&table[0]);
+
+		//---- Without the padding of the table
+		for(unsigned int y = 0; y < tableHeight; y++)
+			memcpy(gpuTable + (size_t)y * tableWidth, &table[(size_t)y * tablePitch], tableWidth * sizeof(int));
+
+		return true;
 	}
+};
 
-	counter->pushDatas(values, datasetSize);
-	counter->count();
+BenchmarkResult benchmark_scan2d_table(clppContext* context, const BenchmarkOptions& options, bool border, bool callerTable, unsigned int datasetSize)
+{
+	Scan2DCheck check(context, new clppScan2D(context, Value_UInt, datasetSize), border, callerTable, datasetSize);
 
-	//---- Check the results
+	return runCheck(context, options, "scan2d", check);
 }
 
-#pragma endregion
+void benchmark_scan2d(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_scan2d_table(context, options, false, false, datasetSize) );
+	results.push_back( benchmark_scan2d_table(context, options, true, false, datasetSize) );
+	results.push_back( benchmark_scan2d_table(context, options, true, true, datasetSize) );
+}
 
-#pragma region benchmark_scan
+// The CPU versions of the transforms
+struct CpuIsOverHalf
+{
+	cl_uint operator()(cl_float x) const { return x > 0.5f ? 1 : 0; }
+};
 
-void benchmark_scan(clppContext* context, clppScan* scan, int datasetSize)
+struct CpuSquare
 {
-	//---- Create a set of data
-	unsigned int* values = (unsigned int*)malloc(datasetSize * sizeof(int));
-	//makeOneVector(values, datasetSize);
-	makeRandomInt32Vector(values, datasetSize, 8, true);
+	cl_uint operator()(cl_uint x) const { return x * x; }
+};
 
-	//---- Scan : default
-	unsigned int* cpuScanValues = (unsigned int*)malloc(datasetSize * sizeof(int));
-	memcpy(cpuScanValues, values, datasetSize * sizeof(int));
-	cpuScanValues[0] = 0;
-	for(int i = 1; i < datasetSize; i++)
-		cpuScanValues[i] = cpuScanValues[i-1] + values[i - 1];
+static void makeTransformInputs(cl_float* inputs, size_t datasetSize)
+{
+	for(size_t i = 0; i < datasetSize; i++)
+		inputs[i] = (float)rand() / (float)RAND_MAX;
+}
 
-	//--- Scan
-	scan->pushDatas(values, datasetSize);
+static void makeTransformInputs(cl_uint* inputs, size_t datasetSize)
+{
+	makeScanValues(inputs, datasetSize, 16);
+}
 
-	stopWatcher->StartTimer();
-	scan->scan();
-	scan->waitCompletion();
-	stopWatcher->StopTimer();
+// The exclusive sum (uint) of transform(x) for the inputs of type InputT, to an output buffer : the inputs must be kept
+template <typename InputT, typename Transform>
+struct TransformCheck
+{
+	typedef unsigned int Result;
+	string name;
+	unsigned int datasetSize;
+	size_t elementSize;
+	size_t resultsSize;
+
+	clppContext* context;
+	clppScan* scan;
+	Transform cpuTransform;
+	cl_mem clBuffer_inputs;
+	cl_mem clBuffer_output;
+	vector<InputT> inputs;
+	vector<InputT> keptInputs;
+
+	TransformCheck(clppContext* context, clppScan* scan, const string& transformName, Transform cpuTransform, unsigned int datasetSize) :
+		name(scan->getName() + " : " + transformName), datasetSize(datasetSize), elementSize(sizeof(InputT)), resultsSize(datasetSize),
+		context(context), scan(scan), cpuTransform(cpuTransform), inputs(datasetSize), keptInputs(datasetSize)
+	{
+		cl_int clStatus;
+		clBuffer_inputs = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, datasetSize * sizeof(InputT), NULL, &clStatus);
+		clppProgram::checkCLStatus(clStatus);
+		clBuffer_output = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, datasetSize * sizeof(int), NULL, &clStatus);
+		clppProgram::checkCLStatus(clStatus);
+		scan->setOutput(clBuffer_output);
+	}
 
-	scan->popDatas();
+	~TransformCheck()
+	{
+		delete scan;
 
-	//---- Check the scan
-	for(int i = 0; i < datasetSize; i++)
-		if (values[i] != cpuScanValues[i])
-		{
-			cout << "Algorithm FAILED : Scan" << endl;
-			break;
-		}
+		clReleaseMemObject(clBuffer_inputs);
+		clReleaseMemObject(clBuffer_output);
+	}
 
-	cout << "Performance for data-set size[" << datasetSize << "] time (ms): " << stopWatcher->GetElapsedTime() << endl;
+	void prepare(unsigned int* expected)
+	{
+		makeTransformInputs(&inputs[0], datasetSize);
 
-	//---- Free
-	free(values);
-	free(cpuScanValues);
+		for(unsigned int j = 0; j < datasetSize; j++)
+			expected[j] = cpuTransform(inputs[j]);
+		cpuScan(expected, expected, datasetSize, false, 0u, CpuSum());
+
+		cl_int clStatus = clEnqueueWriteBuffer(context->clQueue, clBuffer_inputs, CL_TRUE, 0, datasetSize * sizeof(InputT), &inputs[0], 0, NULL, NULL);
+		clppProgram::checkCLStatus(clStatus);
+		scan->pushCLDatas(clBuffer_inputs, datasetSize);
+	}
+
+	void run()
+	{
+		scan->scan();
+		scan->waitCompletion();
+	}
+
+	bool pop(unsigned int* results, const string& checkName)
+	{
+		scan->popDatas(results);
+
+		//---- The inputs are kept
+		cl_int clStatus = clEnqueueReadBuffer(context->clQueue, clBuffer_inputs, CL_TRUE, 0, datasetSize * sizeof(InputT), &keptInputs[0], 0, NULL, NULL);
+		clppProgram::checkCLStatus(clStatus);
+		return checkValues(&keptInputs[0], &inputs[0], datasetSize, checkName + " (inputs)");
+	}
+};
+
+template <typename InputT, typename Transform>
+BenchmarkResult benchmark_scan_transform(clppContext* context, const BenchmarkOptions& options, const clppTransform& transform, const string& transformName, Transform cpuTransform, unsigned int datasetSize)
+{
+	clppScan* scan = clpp::createBestScan(context, clppOperator::sum(Value_UInt), transform, datasetSize, getScanAlgorithm(options.algorithm));
+	TransformCheck<InputT, Transform> check(context, scan, transformName, cpuTransform, datasetSize);
+
+	return runCheck(context, options, "transform", check);
+}
+
+void benchmark_transform(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkResult>& results)
+{
+	results.push_back( benchmark_scan_transform<cl_float>(context, options, clppTransform::predicate(Value_Float, "X > 0.5f"), "float > 0.5", CpuIsOverHalf(), datasetSize) );
+	results.push_back( benchmark_scan_transform<cl_uint>(context, options, clppTransform(Value_UInt, "#define TRANSFORM(X) ((T)(X) * (T)(X))\n"), "uint squared", CpuSquare(), datasetSize) );
 }
 
 #pragma endregion
 
 #pragma region benchmark_sort
 
-void benchmark_sort(clppContext context, clppSort* sort, unsigned int datasetSize, unsigned int bits)
+BenchmarkResult benchmark_sort(clppContext* context, clppSort* sort, const BenchmarkOptions& options, unsigned int datasetSize, BenchmarkDistribution distribution)
 {
+	BenchmarkResult result;
+	result.primitive = "sort";
+	result.algorithm = sort->getName();
+	result.keysOnly = true;
+	result.bits = options.bits;
+	result.datasetSize = datasetSize;
+	result.distribution = distribution;
+	result.elementSize = sizeof(int);
+	result.passed = true;
+
 	//---- Create a new set of random datas
 	unsigned int* keys = (unsigned int*)malloc(datasetSize * sizeof(int));
 
-	double time = 0;
-	for(unsigned int i = 0; i < PARAM_BENCHMARK_LOOPS; i++)
-	{
-		makeRandomInt32Vector(keys, datasetSize, bits, true);  
+	cl_mem clBuffer_keys;
+	clppRandom* random = createRandom(context, options, distribution, datasetSize, clBuffer_keys);
 
+	BenchmarkSampler sampler(context, options);
+	for(unsigned int i = 0; i < options.warmups + options.loops; i++)
+	{
 		//---- Push the datas
- 		sort->pushDatas(keys, datasetSize);
+		if (random)
+		{
+			random->generate(clBuffer_keys, datasetSize, i + 1);
+			random->waitCompletion();
+			sort->pushCLDatas(clBuffer_keys, datasetSize);
+		}
+		else
+		{
+			makeDistributionVector(keys, datasetSize, options.bits, true, distribution, i + 1);
+			sort->pushDatas(keys, datasetSize);
+		}
 
 		//---- Sort
-		stopWatcher->StartTimer();
+		sampler.start();
 		
 		sort->sort();
 		sort->waitCompletion();	
 		
-		stopWatcher->StopTimer();
-		time += stopWatcher->GetElapsedTime();
+		sampler.stop();
 
 		//---- Check if it is sorted
-		sort->popDatas();
-		checkIsSorted(keys, datasetSize, sort->getName(), true, i);
+		sort->popDatas(keys);
+		result.passed &= checkIsSorted(keys, datasetSize, sort->getName(), true, i);
 	}
 
-	time /= PARAM_BENCHMARK_LOOPS;
-	float kps = (1000 / time) * datasetSize;
-	cout << "Performance for data-set size[" << datasetSize << "] time (ms): " << time << " KPS[" << (int)kps << "]" << endl;
+	sampler.fill(result);
 
 	//---- Free
 	free(keys);
+	if (random)
+	{
+		delete random;
+		clReleaseMemObject(clBuffer_keys);
+	}
+
+	return result;
 }
 
 #pragma endregion
 
 #pragma region benchmark_sort_KV
 
-void benchmark_sort_KV(clppContext context, clppSort* sort, unsigned int datasetSize, unsigned int bits)
+BenchmarkResult benchmark_sort_KV(clppContext* context, clppSort* sort, const BenchmarkOptions& options, unsigned int datasetSize, BenchmarkDistribution distribution)
 {
+	BenchmarkResult result;
+	result.primitive = "sort";
+	result.algorithm = sort->getName();
+	result.keysOnly = false;
+	result.bits = options.bits;
+	result.datasetSize = datasetSize;
+	result.distribution = distribution;
+	result.elementSize = 2 * sizeof(int);
+	result.passed = true;
+
 	unsigned int* unsortedDatas = (unsigned int*)malloc(2 * datasetSize * sizeof(int));
 	unsigned int* unsortedDatasCopy = (unsigned int*)malloc(2 * datasetSize * sizeof(int));
 
-	float time = 0;
-	for(unsigned int i = 0; i < PARAM_BENCHMARK_LOOPS; i++)
-	{
-		makeRandomInt32Vector(unsortedDatas, datasetSize, bits, false);
-		memcpy(unsortedDatasCopy, unsortedDatas, 2 * datasetSize * sizeof(int));
+	cl_mem clBuffer_datas;
+	clppRandom* random = createRandom(context, options, distribution, datasetSize, clBuffer_datas);
 
+	BenchmarkSampler sampler(context, options);
+	for(unsigned int i = 0; i < options.warmups + options.loops; i++)
+	{
 		//---- Push the datas
- 		sort->pushDatas(unsortedDatas, datasetSize);
+		if (random)
+		{
+			random->generate(clBuffer_datas, datasetSize, i + 1);
+			random->waitCompletion();
+			sort->pushCLDatas(clBuffer_datas, datasetSize);
+		}
+		else
+		{
+			makeDistributionVector(unsortedDatas, datasetSize, options.bits, false, distribution, i + 1);
+			memcpy(unsortedDatasCopy, unsortedDatas, 2 * datasetSize * sizeof(int));
+			sort->pushDatas(unsortedDatas, datasetSize);
+		}
 
 		//---- Sort
-		stopWatcher->StartTimer();
+		sampler.start();
 
 		sort->sort();
 
 		sort->waitCompletion();
 
-		stopWatcher->StopTimer();
-		time += stopWatcher->GetElapsedTime();
+		sampler.stop();
 
 		//---- Check if it is sorted
-		sort->popDatas();
-		checkIsSorted(unsortedDatas, datasetSize, sort->getName(), false, i);
+		sort->popDatas(unsortedDatas);
+		result.passed &= checkIsSorted(unsortedDatas, datasetSize, sort->getName(), false, i);
 #if PARAM_CHECK_HASLOOSEDVALUES
-		checkHasLooseDatasKV(unsortedDatasCopy, unsortedDatas, datasetSize, sort->getName());
+		if (!random) // The generated data set is not on the host side
+			result.passed &= checkHasLooseDatasKV(unsortedDatasCopy, unsortedDatas, datasetSize, sort->getName());
 #endif
 	}
 
-	time /= PARAM_BENCHMARK_LOOPS;
-	float kps = (1000 / time) * datasetSize;
-	cout << "Performance for data-set size[" << datasetSize << "] time (ms): " << time << " KPS[" << (int)kps << "]" << endl;
+	sampler.fill(result);
 
 	//---- Free
 	free(unsortedDatas);
+	free(unsortedDatasCopy);
+	if (random)
+	{
+		delete random;
+		clReleaseMemObject(clBuffer_datas);
+	}
+
+	return result;
+}
+
+#pragma endregion
+
+#pragma region benchmark_stages
+
+// The copy bandwidth of the device (Read + write, in GB/s) : the roofline of the memory bound kernels.
+double measureCopyBandwidth(clppContext* context, const BenchmarkOptions& options, size_t bytes)
+{
+	cl_int clStatus;
+	cl_mem source = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, bytes, NULL, &clStatus);
+	cl_mem destination = clCreateBuffer(context->clContext, CL_MEM_READ_WRITE, bytes, NULL, &clStatus);
+	clppProgram::checkCLStatus(clStatus);
+
+	vector<double> times;
+	for(unsigned int i = 0; i < options.warmups + options.loops; i++)
+	{
+		cl_event event;
+		clStatus = clEnqueueCopyBuffer(context->clQueue, source, destination, 0, 0, bytes, 0, NULL, &event);
+		clppProgram::checkCLStatus(clStatus);
+		clWaitForEvents(1, &event);
+
+		cl_ulong start, end;
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, 0);
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, 0);
+		clReleaseEvent(event);
+
+		if (i >= options.warmups)
+			times.push_back((double)(end - start));
+	}
+
+	clReleaseMemObject(source);
+	clReleaseMemObject(destination);
+
+	double time = computeStatistics(times).median;
+	return time > 0 ? 2 * bytes / time : 0; // Bytes per ns = GB/s
+}
+
+// Group the kernels recorded from 'firstRecord' (The measured runs) by primitive and stage.
+static void collectStages(clppProfiler* profiler, size_t firstRecord, const BenchmarkOptions& options, const string& primitive,
+	unsigned int datasetSize, double copyBandwidth, vector<BenchmarkStageResult>& results)
+{
+	const vector<clppProfilerRecord>& records = profiler->getRecords();
+
+	vector<string> keys;
+	map<string, vector<double> > times;
+	map<string, double> bytes;
+	map<string, BenchmarkStageResult> stages;
+	for(size_t i = firstRecord; i < records.size(); i++)
+	{
+		const clppProfilerRecord& record = records[i];
+		if (record.queue == 0 || record.bytes == 0 || record.stage == "Write" || record.stage == "Read")
+			continue;
+
+		string key = record.primitive + " / " + record.stage;
+		if (stages.find(key) == stages.end())
+		{
+			keys.push_back(key);
+			BenchmarkStageResult& stage = stages[key];
+			stage.primitive = primitive;
+			stage.owner = record.primitive;
+			stage.stage = record.stage;
+			stage.datasetSize = datasetSize;
+			stage.copyGigabytesPerSecond = copyBandwidth;
+		}
+
+		times[key].push_back((double)(record.end - record.start));
+		bytes[key] += record.bytes;
+	}
+
+	for(size_t i = 0; i < keys.size(); i++)
+	{
+		BenchmarkStageResult& stage = stages[keys[i]];
+		const vector<double>& launchTimes = times[keys[i]];
+
+		double total = 0;
+		for(size_t t = 0; t < launchTimes.size(); t++)
+			total += launchTimes[t];
+
+		stage.launches = (unsigned int)(launchTimes.size() / options.loops);
+		stage.time = computeStatistics(launchTimes).median * 1e-6;
+		stage.gigabytesPerSecond = total > 0 ? bytes[keys[i]] / total : 0;
+		results.push_back(stage);
+	}
+}
+
+// Each kernel is timed by its own event : the in-order queue runs it alone, on the inputs prepared by the previous stages.
+void benchmark_stages(clppContext* context, const BenchmarkOptions& options, unsigned int datasetSize, vector<BenchmarkStageResult>& results)
+{
+	clppProfiler* profiler = context->getProfiler();
+	size_t elementSize = options.keysOnly ? sizeof(int) : 2 * sizeof(int);
+	double copyBandwidth = measureCopyBandwidth(context, options, elementSize * datasetSize);
+
+	unsigned int* datas = (unsigned int*)malloc(elementSize * datasetSize);
+
+	//---- The sort : local sort, local histogram, permute and the nested scan for the radix sorts
+	clppSort* sort = createSort(context, options, datasetSize);
+	size_t firstRecord = 0;
+	for(unsigned int i = 0; i < options.warmups + options.loops; i++)
+	{
+		makeDistributionVector(datas, datasetSize, options.bits, options.keysOnly, options.distributions[0], i + 1);
+		sort->pushDatas(datas, datasetSize);
+		if (i == options.warmups)
+			firstRecord = profiler->getRecords().size();
+		sort->sort();
+		sort->waitCompletion();
+	}
+	collectStages(profiler, firstRecord, options, sort->getName(), datasetSize, copyBandwidth, results);
+	delete sort;
+
+	//---- The scans : kernel__ExclusivePrefixScan/kernel__UniformAdd (default), kernel__scan_block_anylength (gpu)
+	// and kernel__LookBackInit/kernel__LookBackScan (lookback)
+	const char* scanAlgorithms[] = { "default", "gpu", "lookback" };
+	for(int s = 0; s < 3; s++)
+	{
+		clppScan* scan = createScan(context, scanAlgorithms[s], datasetSize);
+		for(unsigned int i = 0; i < options.warmups + options.loops; i++)
+		{
+			makeRandomInt32Vector(datas, datasetSize, 8, true);
+			scan->pushDatas(datas, datasetSize);
+			if (i == options.warmups)
+				firstRecord = profiler->getRecords().size();
+			scan->scan();
+			scan->waitCompletion();
+		}
+		collectStages(profiler, firstRecord, options, scan->getName(), datasetSize, copyBandwidth, results);
+		delete scan;
+	}
+
+	free(datas);
+
+	// Only kept for the trace
+	if (!options.profile)
+		profiler->clear();
 }
 
 #pragma endregion
@@ -466,13 +2205,97 @@ void makeRandomInt32Vector(unsigned int* a, unsigned int numElements, unsigned i
 		//a[i * mult + 0] &= 0x7FFFFFFF; // To insure it is a signed value
 
 		if (a[i * mult + 0] >= max)
-			cout << "Error, max int = " << max << endl;
+			cerr << "Error, max int = " << max << endl;
 
 		if (!keysOnly)
 			a[i * mult + 1] = i;
     }
 }
 
+// Xorshift generator : portable 32 bits random words (rand() only gives 15 bits on some platforms)
+static unsigned int nextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+const char* getDistributionName(BenchmarkDistribution distribution)
+{
+	static const char* names[Distribution_Count] = { "uniform", "sorted", "reverse", "fewunique", "equal", "zipf", "sawtooth", "lowentropy" };
+	return names[distribution];
+}
+
+// The keys are lower than the max 'signed' value of 'keybits' bits, the values (Key-Value) are the original indices.
+void makeDistributionVector(unsigned int* a, unsigned int numElements, unsigned int keybits, bool keysOnly, BenchmarkDistribution distribution, unsigned int seed)
+{
+	int mult = keysOnly ? 1 : 2;
+	unsigned int max = ( 1u << (keybits-1) ) - 1; // Max 'signed' value
+	unsigned int state = 2463534242u ^ (seed * 2654435761u);
+
+	//---- Few unique / Zipf : the set of keys
+	vector<unsigned int> uniqueKeys(distribution == Distribution_FewUnique ? 16 : 1024);
+	for(size_t k = 0; k < uniqueKeys.size(); k++)
+		uniqueKeys[k] = nextRandom(state) % max;
+
+	// Zipf : P(rank k) ~ 1/(k+1)
+	vector<double> zipfCDF;
+	if (distribution == Distribution_Zipf)
+	{
+		zipfCDF.resize(uniqueKeys.size());
+		double sum = 0;
+		for(size_t k = 0; k < zipfCDF.size(); k++)
+			zipfCDF[k] = (sum += 1.0 / (k + 1));
+		for(size_t k = 0; k < zipfCDF.size(); k++)
+			zipfCDF[k] /= sum;
+	}
+
+	const unsigned int sawtoothPeriod = 4096;
+
+	for(unsigned int i = 0; i < numElements; i++)
+	{
+		unsigned int key = 0;
+		switch(distribution)
+		{
+		case Distribution_Uniform:
+			key = nextRandom(state) % max;
+			break;
+		case Distribution_Sorted:
+			key = (unsigned int)(((double)i / numElements) * max);
+			break;
+		case Distribution_Reverse:
+			key = (unsigned int)(((double)(numElements - 1 - i) / numElements) * max);
+			break;
+		case Distribution_FewUnique:
+			key = uniqueKeys[nextRandom(state) % uniqueKeys.size()];
+			break;
+		case Distribution_Equal:
+			key = max / 2;
+			break;
+		case Distribution_Zipf:
+			{
+				double u = (double)nextRandom(state) / 4294967296.0;
+				size_t rank = lower_bound(zipfCDF.begin(), zipfCDF.end(), u) - zipfCDF.begin();
+				key = uniqueKeys[min(rank, uniqueKeys.size() - 1)];
+			}
+			break;
+		case Distribution_Sawtooth:
+			key = (unsigned int)(((double)(i % sawtoothPeriod) / sawtoothPeriod) * max);
+			break;
+		case Distribution_LowEntropy:
+			key = (nextRandom(state) & nextRandom(state)) % max;
+			break;
+		default:
+			break;
+		}
+
+		a[i * mult + 0] = key;
+		if (!keysOnly)
+			a[i * mult + 1] = i;
+	}
+}
+
 // NVidia version
 //void makeRandomInt32Vector(unsigned int *a, unsigned int numElements, unsigned int keybits, bool keysOnly)
 //{
@@ -507,7 +2330,7 @@ bool checkIsSorted(unsigned int* tocheck, size_t datasetSize, string algorithmNa
 	{
 		if (previous > tocheck[i*mult])
 		{
-			cout << "Algorithm FAILED : LoopId[" << sortId << "] " << algorithmName << endl;
+			cerr << "Algorithm FAILED : LoopId[" << sortId << "] " << algorithmName << endl;
 			return false;
 		}
 		previous = tocheck[i*mult];
@@ -537,7 +2360,7 @@ bool checkHasLooseDatasKV(unsigned int* unsorted, unsigned int* sorted, size_t d
 
 		if (!hasFound)
 		{
-			cout << "Algorithm FAILED, we have loose some datas : " << algorithmName << endl;
+			cerr << "Algorithm FAILED, we have loose some datas : " << algorithmName << endl;
 			return false;
 		}
 	}
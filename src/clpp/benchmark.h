@@ -1,10 +1,97 @@
 #ifndef __CLPP_BENCHMARK_H__
 #define __CLPP_BENCHMARK_H__
 
+#include <string>
+#include <vector>
+
 // Base class to sort a set of datas with clpp
 class clppSort_Blelloch
 {
 	void sort(void* keys, void* values, unsigned int keyBits, size_t numElements);
 };
 
-#endif
\ No newline at end of file
+enum BenchmarkFormat { Format_Text, Format_CSV, Format_JSON };
+
+// The distributions of the keys to sort
+enum BenchmarkDistribution
+{
+	Distribution_Uniform,		// Uniform random keys
+	Distribution_Sorted,		// Already sorted
+	Distribution_Reverse,		// Sorted in the reverse order
+	Distribution_FewUnique,		// 16 different random keys
+	Distribution_Equal,			// All the keys are equal
+	Distribution_Zipf,			// Zipf-skewed ranks (s = 1) over 1024 random keys
+	Distribution_Sawtooth,		// Ascending runs of 4096 keys
+	Distribution_LowEntropy,	// Bitwise AND of 2 random words
+	Distribution_Count
+};
+
+// The statistics of the measured runs, in ms
+struct BenchmarkStatistics
+{
+	double mean;
+	double median;
+	double p90;
+	double p99;
+	double mad;		// Median absolute deviation
+	double min;
+};
+
+// The result of a kernel stage, by the micro-benchmarks of the stages
+struct BenchmarkStageResult
+{
+	std::string primitive;				// The benchmarked primitive
+	std::string owner;					// The primitive which enqueues the kernel (Ex: the scan of a radix sort)
+	std::string stage;
+	unsigned int datasetSize;
+	unsigned int launches;				// Per run
+	double time;						// Median time of a launch, in ms
+	double gigabytesPerSecond;			// Device memory read and written / time
+	double copyGigabytesPerSecond;		// The copy bandwidth of the device (Read + write)
+};
+
+// The benchmark parameters, set by the command line (See printUsage)
+struct BenchmarkOptions
+{
+	std::string primitive;				// scan, sort, stages, or a check of the scans (typed...)
+	std::string algorithm;				// best, default, gpu (scan) / best, radix, radixgpu, bitonic, bitonicgpu, stream, cpu (sort)
+	bool keysOnly;						// Keys or Key-Values (sort)
+	unsigned int bits;					// The number of bits to sort
+	std::vector<unsigned int> sizes;	// The data set sizes
+	std::vector<BenchmarkDistribution> distributions;	// The key distributions (sort)
+	unsigned int loops;					// The number of measured runs of each size
+	unsigned int warmups;				// The number of runs before the measured ones
+	unsigned int platformId;
+	unsigned int deviceId;
+	BenchmarkFormat format;
+	std::string output;					// The output file (Empty = standard output)
+	bool profile;						// Enable the profiler, write clpp_trace.json
+	bool deviceData;					// Generate the data sets on the device (sort)
+	std::string baseline;				// A previous CSV output to compare with (Empty = none)
+	double threshold;					// The slowdown, in percent, considered as a regression
+};
+
+// The result of the runs of one size
+struct BenchmarkResult
+{
+	std::string primitive;
+	std::string algorithm;				// The name of the primitive object
+	bool keysOnly;
+	unsigned int bits;
+	unsigned int datasetSize;
+	BenchmarkDistribution distribution;
+	size_t elementSize;					// In bytes
+	unsigned int loops;
+	unsigned int warmups;
+	BenchmarkStatistics hostTime;		// Monotonic host clock, from the start of the operation to its completion
+	BenchmarkStatistics deviceTime;		// From the start of the first command to the end of the last one
+	bool hasDeviceTime;					// The queue supports the profiling
+	double time;						// The median time used for the throughput and the baseline, in ms (Device time when available)
+	double keysPerSecond;
+	double gigabytesPerSecond;			// Data set bytes / time
+	bool passed;						// All the runs gave the expected result
+	double baselineTime;				// The time of the baseline, in ms (0 if none)
+	bool regressed;						// Slower than the baseline by more than the threshold
+};
+
+#endif
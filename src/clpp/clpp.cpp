@@ -2,18 +2,49 @@
 
 #include "clpp/clppScan_Default.h"
 #include "clpp/clppScan_GPU.h"
+#include "clpp/clppScan_LookBack.h"
 
 #include "clpp/clppSort_RadixSort.h"
 #include "clpp/clppSort_RadixSortGPU.h"
 #include "clpp/clppSort_BitonicSort.h"
 #include "clpp/clppSort_BitonicSortGPU.h"
 
-clppScan* clpp::createBestScan(clppContext* context, size_t valueSize, unsigned int maxElements)
+clppScan* clpp::createBestScan(clppContext* context, size_t valueSize, unsigned int maxElements, clppScanAlgorithm algorithm)
 {
-	if (context->isGPU)// && context->Vendor == clppVendor::Vendor_NVidia)
-		return new clppScan_GPU(context, valueSize, maxElements);
+	return createBestScan(context, valueSize == 8 ? Value_Long : Value_Int, maxElements, algorithm);
+}
+
+clppScan* clpp::createBestScan(clppContext* context, clppValueType valueType, unsigned int maxElements, clppScanAlgorithm algorithm)
+{
+	return createBestScan(context, clppOperator::sum(valueType), maxElements, algorithm);
+}
+
+clppScan* clpp::createBestScan(clppContext* context, const clppOperator& op, unsigned int maxElements, clppScanAlgorithm algorithm)
+{
+	if (algorithm == ScanAlgorithm_Best)
+		algorithm = context->isGPU ? ScanAlgorithm_GPU : ScanAlgorithm_Default;
+
+	switch(algorithm)
+	{
+	case ScanAlgorithm_GPU:
+		return new clppScan_GPU(context, op, maxElements);
+	case ScanAlgorithm_LookBack:
+		return new clppScan_LookBack(context, op, maxElements);
+	default:
+		return new clppScan_Default(context, op, maxElements);
+	}
+}
+
+clppScan* clpp::createBestScan(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements, clppScanAlgorithm algorithm)
+{
+	if (algorithm == ScanAlgorithm_Best)
+		algorithm = context->isGPU ? ScanAlgorithm_GPU : ScanAlgorithm_Default;
+
+	// Only the Default and the GPU scans fuse the transform
+	if (algorithm == ScanAlgorithm_GPU)
+		return new clppScan_GPU(context, op, transform, maxElements);
 
-	return new clppScan_Default(context, valueSize, maxElements);
+	return new clppScan_Default(context, op, transform, maxElements);
 }
 
 clppSort* clpp::createBestSort(clppContext* context, unsigned int maxElements, unsigned int bits)
@@ -5,12 +5,26 @@
 #include "clpp/clppSort.h"
 #include "clpp/clppScan.h"
 
+// The scan algorithms
+enum clppScanAlgorithm
+{
+	ScanAlgorithm_Best,			// Chosen for the device
+	ScanAlgorithm_Default,		// Multi-level scan (clppScan_Default)
+	ScanAlgorithm_GPU,			// Single work-group scan (clppScan_GPU)
+	ScanAlgorithm_LookBack		// Single-pass scan with decoupled look-back (clppScan_LookBack)
+};
+
 class clpp
 {
 public:
 	
-	// Create the best scan primitive for the context and a number of elements to scan.
-	static clppScan* createBestScan(clppContext* context, size_t valueSize, unsigned int maxElements);
+	// Create the best scan primitive for the context and a number of elements to scan, or the given algorithm.
+	static clppScan* createBestScan(clppContext* context, size_t valueSize, unsigned int maxElements, clppScanAlgorithm algorithm = ScanAlgorithm_Best);
+	static clppScan* createBestScan(clppContext* context, clppValueType valueType, unsigned int maxElements, clppScanAlgorithm algorithm = ScanAlgorithm_Best);
+	static clppScan* createBestScan(clppContext* context, const clppOperator& op, unsigned int maxElements, clppScanAlgorithm algorithm = ScanAlgorithm_Best);
+
+	// Create the best transform-scan : the scan of transform(x), to an output buffer (Default or GPU algorithm only).
+	static clppScan* createBestScan(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements, clppScanAlgorithm algorithm = ScanAlgorithm_Best);
 
 	// Create the best sort primitive for the context and a number of elements to sort.
 	static clppSort* createBestSort(clppContext* context, unsigned int maxElements, unsigned int bits);
@@ -0,0 +1,152 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// Batched prefix scan : many independent arrays of the same length (The rows of a 2D buffer) in a single launch.
+//
+// Algorithm :
+// -----------
+// The rows are mapped to the work-groups : a row is scanned by LANES work-items, a work-group scans
+// (local size / LANES) rows side by side. Each work-item scans BATCH_ITEMS consecutive values, the lanes of a row
+// are scanned in local memory, and a row longer than a tile (LANES * BATCH_ITEMS) is scanned tile by tile with a carry.
+// So small rows fill the work-groups and the scan is bound by the memory bandwidth, not by the launches.
+//------------------------------------------------------------
+
+// The type of the values T, OPERATOR_APPLY and OPERATOR_IDENTITY are defined by the clppOperator of the scan.
+// BATCH_ITEMS, the number of values per work-item, is defined by clppBatchedScan::compilePreprocess.
+
+//------------------------------------------------------------
+// scan_lanes_exclusive
+//
+// Purpose : Exclusive scan of one value per lane of a row (The lanes are a power of 2), returns the total of the row.
+// All the work-items of the work-group call it.
+//------------------------------------------------------------
+
+inline T scan_lanes_exclusive(__local T* buffer, const uint lane, const uint lanes, T* total)
+{
+	uint offset = 1;
+
+	// bottom-up
+	for(uint d = lanes >> 1; d > 0; d >>= 1)
+	{
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		if (lane < d)
+		{
+			const uint ai = offset * (2 * lane + 1) - 1;
+			const uint bi = offset * (2 * lane + 2) - 1;
+			buffer[bi] = OPERATOR_APPLY(buffer[ai], buffer[bi]);
+		}
+		offset <<= 1;
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+	*total = buffer[lanes - 1];
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if (lane == 0)
+		buffer[lanes - 1] = OPERATOR_IDENTITY;
+
+	// top-down
+	for(uint d = 1; d < lanes; d <<= 1)
+	{
+		offset >>= 1;
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		if (lane < d)
+		{
+			const uint ai = offset * (2 * lane + 1) - 1;
+			const uint bi = offset * (2 * lane + 2) - 1;
+			T tmp = buffer[ai];
+			buffer[ai] = buffer[bi];
+			buffer[bi] = OPERATOR_APPLY(buffer[bi], tmp);
+		}
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	return buffer[lane];
+}
+
+//------------------------------------------------------------
+// kernel__BatchedScan
+//
+// Purpose : Scan the rows, exclusive or inclusive, to 'output' (Can be the data set, with the same layout).
+// 'total' (Can be null) receives the total of each row, from 'totalIndex'.
+//------------------------------------------------------------
+
+__kernel
+void kernel__BatchedScan(
+	__global T* dataSet,
+	__global T* output,
+	__local T* localBuffer,				// BATCH_ITEMS * local size values, then local size values
+	const uint rows,
+	const uint length,
+	const uint rowPitch,
+	const uint lanes,
+	const uint inclusive,
+	__global T* total,
+	const uint totalIndex)
+{
+	const uint tid = get_local_id(0);
+	const uint lwz = get_local_size(0);
+	const uint tileSize = lanes * BATCH_ITEMS;
+
+	// The row of the work-item, and its slot in the work-group
+	const uint slot = tid / lanes;
+	const uint lane = tid % lanes;
+	const uint row = get_group_id(0) * (lwz / lanes) + slot;
+	const bool validRow = row < rows;
+
+	__local T* rowBuffer = localBuffer + slot * tileSize;
+	__local T* laneBuffer = localBuffer + lwz * BATCH_ITEMS + slot * lanes;
+
+	__global T* rowInput = dataSet + (size_t)row * rowPitch;
+	__global T* rowOutput = output + (size_t)row * rowPitch;
+
+	T carry = OPERATOR_IDENTITY;
+	for(uint tileOffset = 0; tileOffset < length; tileOffset += tileSize)
+	{
+		//---- Coalesced load, then each work-item takes BATCH_ITEMS consecutive values
+		for(uint k = 0; k < BATCH_ITEMS; k++)
+		{
+			const uint i = k * lanes + lane;
+			rowBuffer[i] = (validRow && tileOffset + i < length) ? rowInput[tileOffset + i] : OPERATOR_IDENTITY;
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		T values[BATCH_ITEMS];
+		T laneTotal = OPERATOR_IDENTITY;
+		for(uint k = 0; k < BATCH_ITEMS; k++)
+		{
+			values[k] = rowBuffer[lane * BATCH_ITEMS + k];
+			laneTotal = OPERATOR_APPLY(laneTotal, values[k]);
+		}
+
+		//---- Scan of the lanes
+		laneBuffer[lane] = laneTotal;
+		T tileTotal;
+		T prefix = OPERATOR_APPLY(carry, scan_lanes_exclusive(laneBuffer, lane, lanes, &tileTotal));
+
+		//---- Apply the prefix to the values, then coalesced store
+		for(uint k = 0; k < BATCH_ITEMS; k++)
+		{
+			T inclusivePrefix = OPERATOR_APPLY(prefix, values[k]);
+			rowBuffer[lane * BATCH_ITEMS + k] = inclusive ? inclusivePrefix : prefix;
+			prefix = inclusivePrefix;
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		for(uint k = 0; k < BATCH_ITEMS; k++)
+		{
+			const uint i = k * lanes + lane;
+			if (validRow && tileOffset + i < length)
+				rowOutput[tileOffset + i] = rowBuffer[i];
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		carry = OPERATOR_APPLY(carry, tileTotal);
+	}
+
+	if (total && validRow && lane == 0)
+		total[totalIndex + row] = carry;
+}
@@ -0,0 +1,249 @@
+#include "clpp/clppBatchedScan.h"
+#include "clpp/clppBatchedScan_CLKernel.h"
+
+// The values per work-item
+#define BATCH_ITEMS 4
+
+#pragma region Constructor
+
+clppBatchedScan::clppBatchedScan(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppScan(context, valueType, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppBatchedScan::clppBatchedScan(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	clppScan(context, op, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+void clppBatchedScan::createPlan(unsigned int maxElements)
+{
+	_clBuffer_values = 0;
+	_clBuffer_ownedValues = 0;
+	_maxElements = maxElements;
+	_isBound = false;
+	_kernel_Scan = 0;
+	_rows = 0;
+	_length = 0;
+	_rowPitch = 0;
+	_lanes = 1;
+	_clBuffer_ownedRowTotals = 0;
+	_rowTotalsCapacity = 0;
+	_useOwnedRowTotals = false;
+
+	if (!checkValueType())
+		return;
+
+	if (!compile(_context, clCode_clppBatchedScan))
+		return;
+
+	//---- Owned kernel : the arguments are bound once by 'bind'
+	_kernel_Scan = createKernel("kernel__BatchedScan");
+
+	//---- The lanes scan needs a power of 2, and the tiles have to fit in the local memory
+	size_t maxWorkgroupSize;
+	cl_ulong localMemSize;
+	clGetKernelWorkGroupInfo(_kernel_Scan, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkgroupSize, 0);
+	clGetDeviceInfo(_context->clDevice, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &localMemSize, 0);
+
+	for(_workgroupSize = 1; _workgroupSize * 2 <= maxWorkgroupSize; _workgroupSize *= 2);
+	while(_workgroupSize > 1 && (BATCH_ITEMS + 1) * _workgroupSize * _valueSize > localMemSize)
+		_workgroupSize /= 2;
+
+	_clBuffer_ownedValues = allocateBuffer(_valueSize * maxElements);
+}
+
+clppBatchedScan::~clppBatchedScan()
+{
+	releaseBuffer(_clBuffer_ownedValues);
+	releaseBuffer(_clBuffer_ownedRowTotals);
+}
+
+#pragma endregion
+
+#pragma region compilePreprocess
+
+string clppBatchedScan::compilePreprocess(string kernel)
+{
+	ostringstream lines;
+	lines << "#define BATCH_ITEMS " << BATCH_ITEMS << endl;
+
+	return clppScan::compilePreprocess(lines.str() + kernel);
+}
+
+#pragma endregion
+
+#pragma region scan
+
+void clppBatchedScan::setLayout(unsigned int rows, unsigned int length, unsigned int rowPitch)
+{
+	assert(rowPitch >= length);
+
+	_rows = rows;
+	_length = length;
+	_rowPitch = rowPitch;
+
+	// Enough lanes for a row in one tile, the other rows of the work-group use the remaining work-items
+	for(_lanes = 1; _lanes < _workgroupSize && _lanes * BATCH_ITEMS < length; _lanes *= 2);
+
+	if (_useOwnedRowTotals && _rows > _rowTotalsCapacity)
+		allocateRowTotals();
+
+	_isBound = false;
+}
+
+void clppBatchedScan::scan()
+{
+	cl_int clStatus;
+
+	if (_rows == 0 || _length == 0)
+		return;
+
+	assert((size_t)(_rows - 1) * _rowPitch + _length <= _datasetSize);
+
+	if (!_isBound)
+		bind();
+
+	//---- A single launch : (work-group size / lanes) rows per work-group
+	size_t rowsPerWorkgroup = _workgroupSize / _lanes;
+	size_t localWorkSize = {_workgroupSize};
+	size_t globalWorkSize = {((_rows + rowsPerWorkgroup - 1) / rowsPerWorkgroup) * _workgroupSize};
+
+	size_t bytes = 2 * _valueSize * (size_t)_rows * _length;
+	clStatus = enqueueKernel(_kernel_Scan, 1, &globalWorkSize, &localWorkSize, "Batched scan", bytes);
+	checkCLStatus(clStatus);
+}
+
+// Bind the arguments : only when the layout or the buffers have changed.
+void clppBatchedScan::bind()
+{
+	cl_int clStatus;
+
+	cl_mem clOutput = getOutputBuffer();
+	unsigned int inclusive = _inclusive ? 1 : 0;
+
+	clStatus  = clSetKernelArg(_kernel_Scan, 0, sizeof(cl_mem), &_clBuffer_values);
+	clStatus |= clSetKernelArg(_kernel_Scan, 1, sizeof(cl_mem), &clOutput);
+	clStatus |= clSetKernelArg(_kernel_Scan, 2, (BATCH_ITEMS + 1) * _workgroupSize * _valueSize, 0);
+	clStatus |= clSetKernelArg(_kernel_Scan, 3, sizeof(int), &_rows);
+	clStatus |= clSetKernelArg(_kernel_Scan, 4, sizeof(int), &_length);
+	clStatus |= clSetKernelArg(_kernel_Scan, 5, sizeof(int), &_rowPitch);
+	clStatus |= clSetKernelArg(_kernel_Scan, 6, sizeof(int), &_lanes);
+	clStatus |= clSetKernelArg(_kernel_Scan, 7, sizeof(int), &inclusive);
+	clStatus |= clSetKernelArg(_kernel_Scan, 8, sizeof(cl_mem), &_clBuffer_total);
+	clStatus |= clSetKernelArg(_kernel_Scan, 9, sizeof(int), &_totalIndex);
+	checkCLStatus(clStatus);
+
+	_isBound = true;
+}
+
+#pragma endregion
+
+#pragma region pushDatas
+
+void clppBatchedScan::pushDatas(void* values, size_t datasetSize)
+{
+	cl_int clStatus;
+
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	//---- Use our own buffer (Allocated by the plan)
+	_values = values;
+	setDataset(_clBuffer_ownedValues, datasetSize);
+	_is_clBuffersOwner = true;
+
+	//---- Copy on the device
+	clStatus = enqueueWriteBuffer(_clBuffer_values, _valueSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
+}
+
+void clppBatchedScan::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
+{
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	_values = 0;
+	setDataset(clBuffer_values, datasetSize);
+	_is_clBuffersOwner = false;
+}
+
+void clppBatchedScan::setDataset(cl_mem clBuffer_values, size_t datasetSize)
+{
+	if (clBuffer_values != _clBuffer_values)
+		_isBound = false;
+
+	_clBuffer_values = clBuffer_values;
+	_datasetSize = datasetSize;
+}
+
+#pragma endregion
+
+#pragma region popDatas
+
+void clppBatchedScan::popDatas()
+{
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
+}
+
+void clppBatchedScan::popDatas(void* dataSet)
+{
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, dataSet);
+	checkCLStatus(clStatus);
+}
+
+#pragma endregion
+
+#pragma region Inclusive, out-of-place and total
+
+void clppBatchedScan::setInclusive(bool inclusive)
+{
+	clppScan::setInclusive(inclusive);
+	_isBound = false;
+}
+
+void clppBatchedScan::setOutput(cl_mem clBuffer_output)
+{
+	clppScan::setOutput(clBuffer_output);
+	_isBound = false;
+}
+
+void clppBatchedScan::setTotal(bool enable, cl_mem clBuffer_total, unsigned int index)
+{
+	// The internal buffer has one value per row
+	_useOwnedRowTotals = enable && !clBuffer_total;
+	if (_useOwnedRowTotals)
+	{
+		if (!_clBuffer_ownedRowTotals || _rows > _rowTotalsCapacity)
+			allocateRowTotals();
+		clBuffer_total = _clBuffer_ownedRowTotals;
+		index = 0;
+	}
+
+	clppScan::setTotal(enable, clBuffer_total, index);
+	_isBound = false;
+}
+
+void clppBatchedScan::allocateRowTotals()
+{
+	releaseBuffer(_clBuffer_ownedRowTotals);
+
+	_rowTotalsCapacity = _rows > 0 ? _rows : 1;
+	_clBuffer_ownedRowTotals = allocateBuffer(_valueSize * _rowTotalsCapacity);
+
+	if (_clBuffer_total)
+		_clBuffer_total = _clBuffer_ownedRowTotals;
+}
+
+void clppBatchedScan::popRowTotals(void* totals)
+{
+	assert(_clBuffer_total);
+
+	cl_int clStatus = enqueueReadBuffer(_clBuffer_total, _valueSize * _rows, totals, _valueSize * _totalIndex);
+	checkCLStatus(clStatus);
+}
+
+#pragma endregion
@@ -0,0 +1,67 @@
+#ifndef __CLPP_BATCHED_SCAN_H__
+#define __CLPP_BATCHED_SCAN_H__
+
+#include "clpp/clppScan.h"
+
+// Batched scan : the independent scans of the rows of a 2D buffer (Ex: per-image histograms), in a single launch.
+// The data set is the whole buffer (At least rows * rowPitch values), the output buffer has the same layout.
+// The total (See setTotal) is one value per row, from 'index' : read by popRowTotals with the internal buffer.
+class clppBatchedScan : public clppScan
+{
+public:
+	clppBatchedScan(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppBatchedScan(clppContext* context, const clppOperator& op, unsigned int maxElements);
+	~clppBatchedScan();
+
+	string getName() { return "Batched prefix sum (exclusive)"; }
+
+	string compilePreprocess(string kernel);
+
+	// The layout : 'rows' arrays of 'length' values, a row starts 'rowPitch' values after the previous one (>= length).
+	void setLayout(unsigned int rows, unsigned int length, unsigned int rowPitch);
+
+	void scan();
+
+	void pushDatas(void* values, size_t datasetSize);
+	void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize);
+
+	void popDatas();
+	void popDatas(void* dataSet);
+
+	void setInclusive(bool inclusive);
+	void setOutput(cl_mem clBuffer_output);
+	void setTotal(bool enable, cl_mem clBuffer_total = 0, unsigned int index = 0);
+
+	// Retreive the totals of the rows (One value per row)
+	void popRowTotals(void* totals);
+
+	// Asynchronous versions (Defined by clppScan)
+	using clppScan::scan;
+	using clppScan::pushDatas;
+	using clppScan::pushCLDatas;
+	using clppScan::popDatas;
+
+private:
+	cl_kernel _kernel_Scan;
+	bool _isBound;						// The kernel arguments are up to date
+
+	unsigned int _maxElements;
+	cl_mem _clBuffer_ownedValues;		// Used by pushDatas
+
+	unsigned int _rows;
+	unsigned int _length;
+	unsigned int _rowPitch;
+	unsigned int _lanes;				// The work-items per row : a power of 2, up to the work-group size
+
+	cl_mem _clBuffer_ownedRowTotals;	// The internal buffer of the totals
+	unsigned int _rowTotalsCapacity;
+	bool _useOwnedRowTotals;
+
+	void allocateRowTotals();
+
+	void createPlan(unsigned int maxElements);
+	void setDataset(cl_mem clBuffer_values, size_t datasetSize);
+	void bind();
+};
+
+#endif
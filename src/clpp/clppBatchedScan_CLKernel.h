@@ -0,0 +1,106 @@
+
+char clCode_clppBatchedScan[]=
+"inline T scan_lanes_exclusive(__local T* buffer, const uint lane, const uint lanes, T* total)\n"
+"{\n"
+"	uint offset = 1;\n"
+"	// bottom-up\n"
+"	for(uint d = lanes >> 1; d > 0; d >>= 1)\n"
+"	{\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		if (lane < d)\n"
+"		{\n"
+"			const uint ai = offset * (2 * lane + 1) - 1;\n"
+"			const uint bi = offset * (2 * lane + 2) - 1;\n"
+"			buffer[bi] = OPERATOR_APPLY(buffer[ai], buffer[bi]);\n"
+"		}\n"
+"		offset <<= 1;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	*total = buffer[lanes - 1];\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	if (lane == 0)\n"
+"		buffer[lanes - 1] = OPERATOR_IDENTITY;\n"
+"	// top-down\n"
+"	for(uint d = 1; d < lanes; d <<= 1)\n"
+"	{\n"
+"		offset >>= 1;\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		if (lane < d)\n"
+"		{\n"
+"			const uint ai = offset * (2 * lane + 1) - 1;\n"
+"			const uint bi = offset * (2 * lane + 2) - 1;\n"
+"			T tmp = buffer[ai];\n"
+"			buffer[ai] = buffer[bi];\n"
+"			buffer[bi] = OPERATOR_APPLY(buffer[bi], tmp);\n"
+"		}\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	return buffer[lane];\n"
+"}\n"
+"__kernel\n"
+"void kernel__BatchedScan(\n"
+"	__global T* dataSet,\n"
+"	__global T* output,\n"
+"	__local T* localBuffer,				// BATCH_ITEMS * local size values, then local size values\n"
+"	const uint rows,\n"
+"	const uint length,\n"
+"	const uint rowPitch,\n"
+"	const uint lanes,\n"
+"	const uint inclusive,\n"
+"	__global T* total,\n"
+"	const uint totalIndex)\n"
+"{\n"
+"	const uint tid = get_local_id(0);\n"
+"	const uint lwz = get_local_size(0);\n"
+"	const uint tileSize = lanes * BATCH_ITEMS;\n"
+"	// The row of the work-item, and its slot in the work-group\n"
+"	const uint slot = tid / lanes;\n"
+"	const uint lane = tid % lanes;\n"
+"	const uint row = get_group_id(0) * (lwz / lanes) + slot;\n"
+"	const bool validRow = row < rows;\n"
+"	__local T* rowBuffer = localBuffer + slot * tileSize;\n"
+"	__local T* laneBuffer = localBuffer + lwz * BATCH_ITEMS + slot * lanes;\n"
+"	__global T* rowInput = dataSet + (size_t)row * rowPitch;\n"
+"	__global T* rowOutput = output + (size_t)row * rowPitch;\n"
+"	T carry = OPERATOR_IDENTITY;\n"
+"	for(uint tileOffset = 0; tileOffset < length; tileOffset += tileSize)\n"
+"	{\n"
+"		//---- Coalesced load, then each work-item takes BATCH_ITEMS consecutive values\n"
+"		for(uint k = 0; k < BATCH_ITEMS; k++)\n"
+"		{\n"
+"			const uint i = k * lanes + lane;\n"
+"			rowBuffer[i] = (validRow && tileOffset + i < length) ? rowInput[tileOffset + i] : OPERATOR_IDENTITY;\n"
+"		}\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		T values[BATCH_ITEMS];\n"
+"		T laneTotal = OPERATOR_IDENTITY;\n"
+"		for(uint k = 0; k < BATCH_ITEMS; k++)\n"
+"		{\n"
+"			values[k] = rowBuffer[lane * BATCH_ITEMS + k];\n"
+"			laneTotal = OPERATOR_APPLY(laneTotal, values[k]);\n"
+"		}\n"
+"		//---- Scan of the lanes\n"
+"		laneBuffer[lane] = laneTotal;\n"
+"		T tileTotal;\n"
+"		T prefix = OPERATOR_APPLY(carry, scan_lanes_exclusive(laneBuffer, lane, lanes, &tileTotal));\n"
+"		//---- Apply the prefix to the values, then coalesced store\n"
+"		for(uint k = 0; k < BATCH_ITEMS; k++)\n"
+"		{\n"
+"			T inclusivePrefix = OPERATOR_APPLY(prefix, values[k]);\n"
+"			rowBuffer[lane * BATCH_ITEMS + k] = inclusive ? inclusivePrefix : prefix;\n"
+"			prefix = inclusivePrefix;\n"
+"		}\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		for(uint k = 0; k < BATCH_ITEMS; k++)\n"
+"		{\n"
+"			const uint i = k * lanes + lane;\n"
+"			if (validRow && tileOffset + i < length)\n"
+"				rowOutput[tileOffset + i] = rowBuffer[i];\n"
+"		}\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		carry = OPERATOR_APPLY(carry, tileTotal);\n"
+"	}\n"
+"	if (total && validRow && lane == 0)\n"
+"		total[totalIndex + row] = carry;\n"
+"}\n"
+;
@@ -0,0 +1,130 @@
+#include "clpp/clppBufferPool.h"
+#include "clpp/clppProgram.h"
+
+// The power-of-two classes end there : 1MB
+#define SIZE_CLASS_THRESHOLD (1 << 20)
+
+#pragma region Constructor
+
+clppBufferPool::clppBufferPool(cl_context context, cl_device_id device)
+{
+	_context = context;
+
+	_maxAllocSize = 0;
+	clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &_maxAllocSize, 0);
+
+	_bytesInUse = 0;
+	_bytesReserved = 0;
+	_highWaterMarkInUse = 0;
+	_highWaterMarkReserved = 0;
+	_allocationsCount = 0;
+	_reusesCount = 0;
+}
+
+clppBufferPool::~clppBufferPool()
+{
+	trim();
+
+	// The buffers still used by a primitive
+	for(std::map<cl_mem, size_t>::iterator it = _usedBuffers.begin(); it != _usedBuffers.end(); it++)
+		clReleaseMemObject(it->first);
+	_usedBuffers.clear();
+}
+
+#pragma endregion
+
+#pragma region allocate / release
+
+size_t clppBufferPool::getSizeClass(size_t size)
+{
+	size_t sizeClass = 256;
+	while(sizeClass < size && sizeClass < SIZE_CLASS_THRESHOLD)
+		sizeClass <<= 1;
+
+	//---- Large buffers : 8 classes between 2 powers of 2
+	if (sizeClass < size)
+	{
+		size_t step = SIZE_CLASS_THRESHOLD / 8;
+		while(step * 16 <= size)
+			step <<= 1;
+
+		sizeClass = ((size + step - 1) / step) * step;
+	}
+
+	//---- Larger than the largest buffer of the device : the exact size
+	if (_maxAllocSize > 0 && sizeClass > _maxAllocSize)
+		sizeClass = size;
+
+	return sizeClass;
+}
+
+cl_mem clppBufferPool::allocate(size_t size)
+{
+	size_t sizeClass = getSizeClass(size);
+
+	cl_mem buffer;
+	std::vector<cl_mem>& freeBuffers = _freeBuffers[sizeClass];
+	if (freeBuffers.size() > 0)
+	{
+		//---- Reuse
+		buffer = freeBuffers.back();
+		freeBuffers.pop_back();
+		_reusesCount++;
+	}
+	else
+	{
+		//---- Create
+		cl_int clStatus;
+		buffer = clCreateBuffer(_context, CL_MEM_READ_WRITE, sizeClass, NULL, &clStatus);
+		clppProgram::checkCLStatus(clStatus);
+
+		_allocationsCount++;
+		_bytesReserved += sizeClass;
+		_highWaterMarkReserved = std::max(_highWaterMarkReserved, _bytesReserved);
+	}
+
+	_usedBuffers[buffer] = sizeClass;
+	_bytesInUse += sizeClass;
+	_highWaterMarkInUse = std::max(_highWaterMarkInUse, _bytesInUse);
+
+	return buffer;
+}
+
+void clppBufferPool::release(cl_mem buffer)
+{
+	std::map<cl_mem, size_t>::iterator it = _usedBuffers.find(buffer);
+	assert(it != _usedBuffers.end());
+	if (it == _usedBuffers.end())
+		return;
+
+	_freeBuffers[it->second].push_back(buffer);
+	_bytesInUse -= it->second;
+	_usedBuffers.erase(it);
+}
+
+void clppBufferPool::trim()
+{
+	for(std::map<size_t, std::vector<cl_mem> >::iterator it = _freeBuffers.begin(); it != _freeBuffers.end(); it++)
+	{
+		for(size_t i = 0; i < it->second.size(); i++)
+			clReleaseMemObject(it->second[i]);
+
+		_bytesReserved -= it->first * it->second.size();
+	}
+	_freeBuffers.clear();
+}
+
+#pragma endregion
+
+#pragma region printStatistics
+
+void clppBufferPool::printStatistics()
+{
+	cout << "Buffer pool" << endl;
+	cout << "    In use             : " << _bytesInUse << " bytes (High-water mark " << _highWaterMarkInUse << ")" << endl;
+	cout << "    Reserved           : " << _bytesReserved << " bytes (High-water mark " << _highWaterMarkReserved << ")" << endl;
+	cout << "    Allocations        : " << _allocationsCount << endl;
+	cout << "    Reuses             : " << _reusesCount << endl;
+}
+
+#pragma endregion
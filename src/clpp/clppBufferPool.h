@@ -0,0 +1,61 @@
+#ifndef __CLPP_BUFFERPOOL_H__
+#define __CLPP_BUFFERPOOL_H__
+
+#if defined (__APPLE__) || defined(MACOSX)
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+#include <map>
+#include <vector>
+
+// Pool of device buffers, shared by all the primitives of a context.
+// The buffers are allocated by size classes, a released buffer is kept to be reused by the next
+// allocation of the same class : powers of two up to SIZE_CLASS_THRESHOLD, then 8 classes between
+// two powers of two (At most 12.5% lost), and the exact size when the class would exceed the
+// largest buffer of the device (CL_DEVICE_MAX_MEM_ALLOC_SIZE).
+class clppBufferPool
+{
+public:
+	clppBufferPool(cl_context context, cl_device_id device);
+	~clppBufferPool();
+
+	// Returns a read-write buffer of at least 'size' bytes.
+	cl_mem allocate(size_t size);
+
+	// Give a buffer back to the pool.
+	void release(cl_mem buffer);
+
+	// Release all the free buffers to the OpenCL driver.
+	void trim();
+
+	// Statistics
+	size_t getBytesInUse() { return _bytesInUse; }
+	size_t getBytesReserved() { return _bytesReserved; }				// In use + free
+	size_t getHighWaterMarkInUse() { return _highWaterMarkInUse; }
+	size_t getHighWaterMarkReserved() { return _highWaterMarkReserved; }
+	unsigned int getAllocationsCount() { return _allocationsCount; }	// Calls to clCreateBuffer
+	unsigned int getReusesCount() { return _reusesCount; }				// Allocations served by a free buffer
+
+	// Print the statistics.
+	void printStatistics();
+
+private:
+	cl_context _context;
+	cl_ulong _maxAllocSize;		// CL_DEVICE_MAX_MEM_ALLOC_SIZE
+
+	std::map<size_t, std::vector<cl_mem> > _freeBuffers;	// The free buffers by size class
+	std::map<cl_mem, size_t> _usedBuffers;					// The size class of the buffers in use
+
+	size_t _bytesInUse;
+	size_t _bytesReserved;
+	size_t _highWaterMarkInUse;
+	size_t _highWaterMarkReserved;
+	unsigned int _allocationsCount;
+	unsigned int _reusesCount;
+
+	size_t getSizeClass(size_t size);
+};
+
+#endif
@@ -3,10 +3,53 @@
 #include<assert.h>
 #include <iostream>
 #include <string.h>
+#include <stdio.h>
 #include <algorithm>
 
 using namespace std;
 
+clppContext::clppContext()
+{
+	clContext = 0;
+	clPlatform = 0;
+	clDevice = 0;
+	clQueue = 0;
+	_owner = 0;
+	_registry = 0;
+	_bufferPool = 0;
+	_profiler = 0;
+	isGPU = isCPU = false;
+	Vendor = Vendor_Unknown;
+	memBaseAddrAlign = 1;
+	supportsDouble = false;
+	openCLCVersion = 100;
+}
+
+clppContext::clppContext(const clppContext& context, cl_command_queue queue)
+{
+	clContext = context.clContext;
+	clPlatform = context.clPlatform;
+	clDevice = context.clDevice;
+	clQueue = queue;
+
+	_owner = context._owner;
+	_registry = context._registry;
+	_bufferPool = context._bufferPool;
+	_profiler = context._profiler;
+
+	isGPU = context.isGPU;
+	isCPU = context.isCPU;
+	Vendor = context.Vendor;
+	memBaseAddrAlign = context.memBaseAddrAlign;
+	supportsDouble = context.supportsDouble;
+	openCLCVersion = context.openCLCVersion;
+}
+
+clppContext::~clppContext()
+{
+	releaseShared();
+}
+
 void clppContext::setup()
 {
 	setup(0, 0);
@@ -14,6 +57,10 @@ void clppContext::setup()
 
 void clppContext::setup(cl_platform_id platform, cl_device_id device, cl_context context, cl_command_queue queue)
 {
+	cl_context previousContext = clContext;
+	cl_device_id previousDevice = clDevice;
+	cl_command_queue previousQueue = clQueue;
+
 	isGPU = isCPU = false;
 	Vendor = Vendor_Unknown;
 
@@ -45,15 +92,31 @@ void clppContext::setup(cl_platform_id platform, cl_device_id device, cl_context
 	if (infoType & CL_DEVICE_TYPE_GPU)
 		isGPU = true;
 
+	cl_uint alignBits = 8;
+	clGetDeviceInfo(clDevice, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(alignBits), &alignBits, &infoLen);
+	memBaseAddrAlign = alignBits / 8;
+
+	char extensions[4096] = "";
+	clGetDeviceInfo(clDevice, CL_DEVICE_EXTENSIONS, sizeof(extensions), extensions, &infoLen);
+	supportsDouble = strstr(extensions, "cl_khr_fp64") != NULL || strstr(extensions, "cl_amd_fp64") != NULL;
+	openCLCVersion = readOpenCLCVersion();
+
 	//---- Context
 	clContext = context;
 
 	//---- Queue
 	clQueue = queue;
+
+	//---- Programs registry, buffers pool and profiler
+	setupShared(previousContext, previousDevice, previousQueue);
 }
 
 void clppContext::setup(unsigned int platformId, unsigned int deviceId)
 {
+	cl_context previousContext = clContext;
+	cl_device_id previousDevice = clDevice;
+	cl_command_queue previousQueue = clQueue;
+
 	isGPU = isCPU = false;
 	Vendor = Vendor_Unknown;
 
@@ -106,6 +169,15 @@ void clppContext::setup(unsigned int platformId, unsigned int deviceId)
 	if (infoType & CL_DEVICE_TYPE_GPU)
 		isGPU = true;
 
+	cl_uint alignBits = 8;
+	clGetDeviceInfo(clDevice, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(alignBits), &alignBits, &infoLen);
+	memBaseAddrAlign = alignBits / 8;
+
+	char extensions[4096] = "";
+	clGetDeviceInfo(clDevice, CL_DEVICE_EXTENSIONS, sizeof(extensions), extensions, &infoLen);
+	supportsDouble = strstr(extensions, "cl_khr_fp64") != NULL || strstr(extensions, "cl_amd_fp64") != NULL;
+	openCLCVersion = readOpenCLCVersion();
+
 	//---- Context
 	clContext = clCreateContext(0, 1, &clDevice, NULL, NULL, &clStatus);
 	assert(clStatus == CL_SUCCESS);
@@ -113,8 +185,59 @@ void clppContext::setup(unsigned int platformId, unsigned int deviceId)
 	//---- Queue
 	clQueue = clCreateCommandQueue(clContext, clDevice, CL_QUEUE_PROFILING_ENABLE, &clStatus);
 	assert(clStatus == CL_SUCCESS);
+
+	//---- Programs registry, buffers pool and profiler
+	setupShared(previousContext, previousDevice, previousQueue);
 }
 
+#pragma region Shared objects
+
+void clppContext::setupShared(cl_context previousContext, cl_device_id previousDevice, cl_command_queue previousQueue)
+{
+	//---- Bound to another context, device or queue : recreated
+	if (_registry && (clContext != previousContext || clDevice != previousDevice || clQueue != previousQueue))
+		releaseShared();
+
+	if (_registry)
+		return;
+
+	_registry = new clppRegistry();
+	_bufferPool = new clppBufferPool(clContext, clDevice);
+	_profiler = new clppProfiler(clQueue);
+	_owner = this;
+}
+
+void clppContext::releaseShared()
+{
+	// Only by the context that created them
+	if (_owner == this)
+	{
+		//---- The kernels, then their programs
+		if (_registry)
+		{
+			for(map<pair<cl_program, string>, cl_kernel>::iterator it = _registry->kernels.begin(); it != _registry->kernels.end(); it++)
+				clReleaseKernel(it->second);
+			for(map<string, cl_program>::iterator it = _registry->programs.begin(); it != _registry->programs.end(); it++)
+				clReleaseProgram(it->second);
+
+			delete _registry;
+		}
+
+		//---- The pooled buffers (Free or still used)
+		delete _bufferPool;
+
+		//---- The profiler and the events it retains
+		delete _profiler;
+	}
+
+	_owner = 0;
+	_registry = 0;
+	_bufferPool = 0;
+	_profiler = 0;
+}
+
+#pragma endregion
+
 char* clppContext::stristr(const char *String, const char *Pattern)
 {
     char *pptr, *sptr, *start;
@@ -150,29 +273,41 @@ char* clppContext::stristr(const char *String, const char *Pattern)
     return(NULL);
 }
 
+// The vendor attributes of the warp (or wavefront) width, in the cl_nv_device_attribute_query and cl_amd_device_attribute_query extensions
+#ifndef CL_DEVICE_WARP_SIZE_NV
+#define CL_DEVICE_WARP_SIZE_NV 0x4003
+#endif
+#ifndef CL_DEVICE_WAVEFRONT_WIDTH_AMD
+#define CL_DEVICE_WAVEFRONT_WIDTH_AMD 0x4043
+#endif
+
 int clppContext::GetSIMTCapability()
 {
-	// NVidia : 32
-	if (Vendor == Vendor_NVidia && isGPU)
-		return 32;
+	// The width is only known when the device reports it : the vendor and the size of the work-groups are not enough
+	// (Ex: the AMD wavefronts are 64, 32 or 16 wide, and the CPU runtimes don't run the work-items in lockstep).
+	char extensions[4096] = "";
+	clGetDeviceInfo(clDevice, CL_DEVICE_EXTENSIONS, sizeof(extensions), extensions, NULL);
+
+	cl_uint width = 0;
+	if (strstr(extensions, "cl_nv_device_attribute_query") != NULL)
+		clGetDeviceInfo(clDevice, CL_DEVICE_WARP_SIZE_NV, sizeof(width), &width, NULL);
+	else if (strstr(extensions, "cl_amd_device_attribute_query") != NULL)
+		clGetDeviceInfo(clDevice, CL_DEVICE_WAVEFRONT_WIDTH_AMD, sizeof(width), &width, NULL);
+
+	return (width > 0) ? width : 1;
+}
 
-	if (Vendor == Vendor_AMD && isGPU)
-	{
-		// ATI : Actually the wavefront size is only 64 for the highend cards(48XX, 58XX, 57XX), but 32 for the middleend cards and 16 for the lowend cards.	
-		//clGetKernelWorkGroupInfo(kernel__scan, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
-		//clGetKernelWorkGroupInfo(kernel__scan, _context->clDevice, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &_workgroupSize, 0);
-
-		// http://developer.amd.com/sdks/amdappsdk/assets/AMD_Accelerated_Parallel_Processing_OpenCL_Programming_Guide.pdf
-		size_t returned_size;
-		size_t max_work_group_size;
-		clGetDeviceInfo(clDevice, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_work_group_size), &max_work_group_size, &returned_size);
-		if (max_work_group_size == 256)
-			return 64;
-
-		return 32;
-	}
+unsigned int clppContext::readOpenCLCVersion()
+{
+	// "OpenCL C <major>.<minor> <vendor-specific information>", not available on the OpenCL 1.0 devices
+	char version[1024] = "";
+	clGetDeviceInfo(clDevice, CL_DEVICE_OPENCL_C_VERSION, sizeof(version), version, NULL);
+
+	unsigned int major = 1, minor = 0;
+	if (sscanf(version, "OpenCL C %u.%u", &major, &minor) != 2)
+		return 100;
 
-	return 1;
+	return major * 100 + minor * 10;
 }
 
 void clppContext::printInformation()
@@ -191,4 +326,41 @@ void clppContext::printInformation()
 
 	cout << "OpenCL Platform : " << platformName << endl;
 	cout << "OpenCL Device   : " << deviceName << endl << endl<< endl;
-}
\ No newline at end of file
+}
+
+#pragma region Registry
+
+cl_program clppContext::getProgram(const string& key)
+{
+	map<string, cl_program>::iterator it = _registry->programs.find(key);
+	if (it == _registry->programs.end())
+		return 0;
+
+	return it->second;
+}
+
+void clppContext::registerProgram(const string& key, cl_program program)
+{
+	// The registry keeps its own reference, the program lives as long as the context
+	clRetainProgram(program);
+	_registry->programs[key] = program;
+}
+
+cl_kernel clppContext::getKernel(cl_program program, const char* kernelName)
+{
+	pair<cl_program, string> key(program, string(kernelName));
+
+	map<pair<cl_program, string>, cl_kernel>::iterator it = _registry->kernels.find(key);
+	if (it != _registry->kernels.end())
+		return it->second;
+
+	cl_int clStatus;
+	cl_kernel kernel = clCreateKernel(program, kernelName, &clStatus);
+	assert(clStatus == CL_SUCCESS);
+
+	_registry->kernels[key] = kernel;
+
+	return kernel;
+}
+
+#pragma endregion
\ No newline at end of file
@@ -7,16 +7,42 @@
 #include <CL/cl.h>
 #endif
 
+#include <map>
+#include <string>
+
+#include "clpp/clppBufferPool.h"
+#include "clpp/clppProfiler.h"
+
 enum clppVendor { Vendor_Unknown, Vendor_NVidia, Vendor_AMD, Vendor_Intel };
 
+// Registry of the built programs and kernels, shared by all the primitives of a context.
+struct clppRegistry
+{
+	std::map<std::string, cl_program> programs;
+	std::map<std::pair<cl_program, std::string>, cl_kernel> kernels;
+};
+
 class clppContext
 {
 public:
+	clppContext();
+
+	// The same context, device, registry, pool and profiler, with another command queue (Not released).
+	// It doesn't own the shared objects : it must be deleted before 'context'.
+	clppContext(const clppContext& context, cl_command_queue queue);
+
+	// Release the shared objects (Only by the context that created them, not by the contexts of other queues).
+	// The primitives must be deleted before : their buffers are released with the pool.
+	~clppContext();
+
 	cl_context clContext;			// OpenCL context
 	cl_platform_id clPlatform;		// OpenCL Platform
 	cl_device_id clDevice;			// OpenCL Device
 	cl_command_queue clQueue;		// OpenCL command queue 
 
+	// The shared objects (Registry, pool and profiler) are bound to the OpenCL context, the device and the queue :
+	// a new setup with another one recreates them, the primitives created before must be deleted first.
+
 	// Default setup : use the default platform and default device
 	void setup();
 
@@ -26,18 +52,57 @@ public:
 	// Setup with a specific platform and device
 	void setup(unsigned int platformId, unsigned int deviceId);
 
-	// Returns the SIMT Capability of the device.
+	// Returns the SIMT Capability of the device : the warp (or wavefront) width reported by the device,
+	// 1 when unknown (The work-items can't be assumed to run in lockstep).
 	int GetSIMTCapability();
 
 	// Print the information related to the context.
 	void printInformation();
 
+	// Returns the program already built for this key (preprocessed source + build options), or 0.
+	cl_program getProgram(const std::string& key);
+
+	// Register a built program, it is shared by all the primitives using the same key.
+	void registerProgram(const std::string& key, cl_program program);
+
+	// Returns the kernel 'kernelName' of a registered program (Created on the first request).
+	// The kernels are shared : every enqueue must set all the kernel arguments.
+	cl_kernel getKernel(cl_program program, const char* kernelName);
+
+	// Returns the pool used to allocate the device buffers (Shared by the copies of the context).
+	clppBufferPool* getBufferPool() { return _bufferPool; }
+
+	// Returns the profiler of the enqueued commands (Shared by the copies of the context, disabled by default).
+	clppProfiler* getProfiler() { return _profiler; }
+
+	// Write the profiled activity to a Chrome trace-event JSON file. (The profiler must be enabled)
+	bool writeTrace(const std::string& fileName) { return _profiler->writeTrace(fileName); }
+
 	// Informations
 	bool isGPU;
 	bool isCPU;
 	clppVendor Vendor;
+	size_t memBaseAddrAlign;	// Alignment of the sub-buffers origins, in bytes
+	bool supportsDouble;		// cl_khr_fp64 (or cl_amd_fp64) is available
+	unsigned int openCLCVersion;	// The OpenCL C version of the device (Ex: 120 for 1.2, 200 for 2.0)
 
 private:
+	clppContext* _owner;		// The context that created the shared objects, it releases them
+	clppRegistry* _registry;
+	clppBufferPool* _bufferPool;
+	clppProfiler* _profiler;
+
+	// Not copyable : the shared objects have a single owner
+	clppContext(const clppContext&);
+	clppContext& operator=(const clppContext&);
+
+	// Create the shared objects for the current context, device and queue (Released first if they were bound to others).
+	void setupShared(cl_context previousContext, cl_device_id previousDevice, cl_command_queue previousQueue);
+	void releaseShared();
+
+	// Returns the OpenCL C version of the device (Ex: 120 for 1.2).
+	unsigned int readOpenCLCVersion();
+
 	// Case-insensitive strstr() work-alike.
 	static char* stristr(const char *String, const char *Pattern);
 };
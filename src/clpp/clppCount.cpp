@@ -18,6 +18,7 @@ clppCount::clppCount(clppContext* context, size_t valueSize, unsigned int counti
 	_clBuffer_CountingBlocks = 0;
 	_countingsBuffer = 0;
 	_clBuffer_Countings = 0;
+	_scan = 0;
 
 	//if (!compile(context, clCode_clppScan_Default))
 	//	return;
@@ -26,10 +27,7 @@ clppCount::clppCount(clppContext* context, size_t valueSize, unsigned int counti
 		return;
 
 	//---- Prepare all the kernels
-	cl_int clStatus;
-
-	_kernel_Count = clCreateKernel(_clProgram, "kernel__Count", &clStatus);
-	checkCLStatus(clStatus);
+	_kernel_Count = getKernel("kernel__Count");
 
 	//---- Get the workgroup size
 	clGetKernelWorkGroupInfo(_kernel_Count, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
@@ -38,34 +36,34 @@ clppCount::clppCount(clppContext* context, size_t valueSize, unsigned int counti
 	//_workgroupSize = 512;
 	//clGetKernelWorkGroupInfo(_kernel_Scan, _context->clDevice, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &_workgroupSize, 0);
 
-	string scanExpression = "#define OPERATOR_APPLY(DATA,INDEX1,INDEX2) DATA[INDEX1]+DATA[INDEX2]";
-
-//#define T int
-//#define OPERATOR_APPLY(A,B) A+B
-//#define OPERATOR_IDENTITY 0
-
 	_scan = clpp::createBestScan(context, sizeof(int), maxElements);
 }
 
 clppCount::~clppCount()
 {
-	if (_is_clBuffersOwner && _clBuffer_values)
-		clReleaseMemObject(_clBuffer_values);
+	if (_is_clBuffersOwner)
+		releaseBuffer(_clBuffer_values);
 
-	if (_clBuffer_CountingBlocks)
-		clReleaseMemObject(_clBuffer_CountingBlocks);
+	releaseBuffer(_clBuffer_CountingBlocks);
 
-	if (_clBuffer_CountingBlocks)
+	if (_countingsBuffer)
 	{
-		clReleaseMemObject(_clBuffer_Countings);
+		releaseBuffer(_clBuffer_Countings);
 		free(_countingsBuffer);
 	}
+
+	delete _scan;
 }
 
 #pragma endregion
 
 #pragma region count
 
+string clppCount::getName()
+{
+	return "Count";
+}
+
 void clppCount::count()
 {
 	cl_int clStatus;
@@ -81,12 +79,28 @@ void clppCount::count()
 	clStatus |= clSetKernelArg(_kernel_Count, 3, sizeof(int), &valuesPerWorkgroup);
 	clStatus |= clSetKernelArg(_kernel_Count, 4, sizeof(int), &_datasetSize);
 
-	clStatus |= clEnqueueNDRangeKernel(_context->clQueue, _kernel_Count, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+	size_t bytes = _valueSize * _datasetSize + sizeof(int) * _countings * (globalWorkSize / _workgroupSize);
+	clStatus |= enqueueKernel(_kernel_Count, 1, &globalWorkSize, &localWorkSize, "Count", bytes);
 	checkCLStatus(clStatus);
 
 	//---- Scan to retreive the totals
 	_scan->pushCLDatas(_clBuffer_CountingBlocks, globalWorkSize);
-	_scan->scan();
+	if (_trackEvents)
+	{
+		// The scan is the last command
+		cl_event scanEvent;
+		_scan->scan(0, NULL, &scanEvent);
+		adoptEvent(scanEvent);
+	}
+	else
+		_scan->scan();
+}
+
+void clppCount::count(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	count();
+	endAsync(event);
 }
 
 #pragma endregion
@@ -107,7 +121,7 @@ void clppCount::pushDatas(void* values, size_t datasetSize)
 	if (!_countingsBuffer)
 	{
 		_countingsBuffer = (unsigned int*)malloc(_countings * sizeof(int));
-		_clBuffer_Countings  = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _countings * sizeof(int), 0, &clStatus);
+		_clBuffer_Countings = allocateBuffer(_countings * sizeof(int));
 	}
 
 	//---- Compute the number of temporary blocks
@@ -116,31 +130,29 @@ void clppCount::pushDatas(void* values, size_t datasetSize)
 		int workgroupsCount = (_datasetSize + _workgroupSize-1) / _workgroupSize;
 		int blocksCount = _countings * workgroupsCount;
 
-		if (_clBuffer_CountingBlocks)
-			clReleaseMemObject(_clBuffer_CountingBlocks);
-
-		_clBuffer_CountingBlocks  = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, blocksCount * sizeof(int), NULL, &clStatus);
+		releaseBuffer(_clBuffer_CountingBlocks);
+		_clBuffer_CountingBlocks = allocateBuffer(blocksCount * sizeof(int));
 	}
 
-	//---- Copy on the device
+	//---- Allocate
 	if (reallocate)
 	{
-		//---- Release
-		if (_clBuffer_values)
-			clReleaseMemObject(_clBuffer_values);
+		if (_is_clBuffersOwner)
+			releaseBuffer(_clBuffer_values);
 
-		_clBuffer_values  = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _valueSize * _datasetSize, _values, &clStatus);
+		_clBuffer_values = allocateBuffer(_valueSize * _datasetSize);
 		_is_clBuffersOwner = true;
-		checkCLStatus(clStatus);
 	}
-	else
-		// Just resend
-		clEnqueueWriteBuffer(_context->clQueue, _clBuffer_values, CL_FALSE, 0, _valueSize * _datasetSize, _values, 0, 0, 0);
+
+	//---- Copy on the device
+	clStatus = enqueueWriteBuffer(_clBuffer_values, _valueSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
 }
 
 void clppCount::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
 {
-	cl_int clStatus;
+	if (_is_clBuffersOwner)
+		releaseBuffer(_clBuffer_values);
 
 	_values = 0;
 	_clBuffer_values = clBuffer_values;
@@ -151,7 +163,7 @@ void clppCount::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
 	if (!_countingsBuffer)
 	{
 		_countingsBuffer = (unsigned int*)malloc(_countings * sizeof(int));
-		_clBuffer_Countings  = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _countings * sizeof(int), 0, &clStatus);
+		_clBuffer_Countings = allocateBuffer(_countings * sizeof(int));
 	}
 
 	//---- Compute the number of needed blocks
@@ -159,29 +171,47 @@ void clppCount::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
 	{
 		int blocksCount = _countings * (_datasetSize + _workgroupSize-1) / _workgroupSize;
 
-		if (_clBuffer_CountingBlocks)
-			clReleaseMemObject(_clBuffer_CountingBlocks);
-
-		_clBuffer_CountingBlocks  = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, blocksCount * sizeof(int), 0, &clStatus);
+		releaseBuffer(_clBuffer_CountingBlocks);
+		_clBuffer_CountingBlocks = allocateBuffer(blocksCount * sizeof(int));
 	}
 
 	_is_clBuffersOwner = false;
 }
 
+void clppCount::pushDatas(void* values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	pushDatas(values, datasetSize);
+	endAsync(event);
+}
+
+void clppCount::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents)
+{
+	setWaitList(numWaitEvents, waitEvents);
+	pushCLDatas(clBuffer_values, datasetSize);
+}
+
 #pragma endregion
 
 #pragma region popDatas
 
 void clppCount::popDatas()
 {
-	cl_int clStatus = clEnqueueReadBuffer(_context->clQueue, _clBuffer_values, CL_TRUE, 0, _valueSize * _datasetSize, _values, 0, NULL, NULL);
+	cl_int clStatus = enqueueReadBuffer(_clBuffer_values, _valueSize * _datasetSize, _values);
 	checkCLStatus(clStatus);
 }
 
 void clppCount::popDatas(void* dataSet)
 {
-	cl_int clStatus = clEnqueueReadBuffer(_context->clQueue, _clBuffer_values, CL_TRUE, 0, _valueSize * _datasetSize, dataSet, 0, NULL, NULL);
+	cl_int clStatus = enqueueReadBuffer(_clBuffer_values, _valueSize * _datasetSize, dataSet);
 	checkCLStatus(clStatus);
 }
 
+void clppCount::popDatas(void* dataSet, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	popDatas(dataSet);
+	endAsync(event);
+}
+
 #pragma endregion
\ No newline at end of file
@@ -29,9 +29,14 @@ public:
 	void popDatas();
 	void popDatas(void* dataSet);
 
-protected:
-	size_t _datasetSize;	// The number of values to scan
+	// Asynchronous versions : the commands wait for 'waitEvents' and 'event' receives the completion event
+	// (Can be null, else it must be released by the caller). An asynchronous popDatas doesn't block.
+	void count(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void pushDatas(void* values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents);
+	void popDatas(void* dataSet, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
 
+protected:
 	void* _values;			// The associated data set to scan
 	size_t _valueSize;		// The size of a value in bytes
 
@@ -0,0 +1,94 @@
+#include "clpp/clppOperator.h"
+
+#pragma region Constructor
+
+clppOperator::clppOperator(clppValueType valueType, const string& source)
+{
+	_valueType = valueType;
+	_valueSize = clppProgram::getValueTypeSize(valueType);
+	_source = source;
+	_collective = "";
+}
+
+clppOperator::clppOperator(size_t valueSize, const string& source)
+{
+	_valueType = Value_Custom;
+	_valueSize = valueSize;
+	_source = source;
+	_collective = "";
+}
+
+#pragma endregion
+
+#pragma region Predefined operators
+
+clppOperator clppOperator::sum(clppValueType valueType)
+{
+	clppOperator op(valueType, "#define OPERATOR_APPLY(A,B) ((A)+(B))\n#define OPERATOR_IDENTITY ((T)0)\n");
+	op._collective = "add";
+	return op;
+}
+
+clppOperator clppOperator::product(clppValueType valueType)
+{
+	return clppOperator(valueType, "#define OPERATOR_APPLY(A,B) ((A)*(B))\n#define OPERATOR_IDENTITY ((T)1)\n");
+}
+
+clppOperator clppOperator::minimum(clppValueType valueType)
+{
+	clppOperator op(valueType, "#define OPERATOR_APPLY(A,B) min(A,B)\n#define OPERATOR_IDENTITY T_MAX\n");
+	op._collective = "min";
+	return op;
+}
+
+clppOperator clppOperator::maximum(clppValueType valueType)
+{
+	clppOperator op(valueType, "#define OPERATOR_APPLY(A,B) max(A,B)\n#define OPERATOR_IDENTITY T_MIN\n");
+	op._collective = "max";
+	return op;
+}
+
+clppOperator clppOperator::bitwiseOr(clppValueType valueType)
+{
+	return clppOperator(valueType, "#define OPERATOR_APPLY(A,B) ((A)|(B))\n#define OPERATOR_IDENTITY ((T)0)\n");
+}
+
+#pragma endregion
+
+#pragma region getDefinitions
+
+string clppOperator::getDefinitions() const
+{
+	// The limits of the predefined types
+	static const char* minimums[] = { "INT_MIN", "0", "(-INFINITY)", "(-INFINITY)", "LONG_MIN", "0" };
+	static const char* maximums[] = { "INT_MAX", "UINT_MAX", "INFINITY", "INFINITY", "LONG_MAX", "ULONG_MAX" };
+
+	string source;
+	if (_valueType == Value_Double)
+	{
+		source += "#ifdef cl_khr_fp64\n#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n";
+		source += "#else\n#pragma OPENCL EXTENSION cl_amd_fp64 : enable\n#endif\n";
+	}
+
+	if (_valueType != Value_Custom)
+	{
+		string typeName = clppProgram::getValueTypeName(_valueType);
+		source += "#define T " + typeName + "\n";
+		source += "#define T2 " + typeName + "2\n";
+		source += string("#define T_MIN ((T)") + minimums[_valueType] + ")\n";
+		source += string("#define T_MAX ((T)") + maximums[_valueType] + ")\n";
+		source += "#define SUPPORT_VECTOR_LOADS\n";
+	}
+
+	// The built-in collectives have the same identity as the operator (0, the max or the min of the type)
+	if (_collective.length() > 0)
+	{
+		source += "#define OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE work_group_scan_exclusive_" + _collective + "\n";
+		source += "#define OPERATOR_WORK_GROUP_REDUCE work_group_reduce_" + _collective + "\n";
+		source += "#define OPERATOR_SUB_GROUP_SCAN_EXCLUSIVE sub_group_scan_exclusive_" + _collective + "\n";
+	}
+
+	return source + _source + "\n";
+}
+
+#pragma endregion
@@ -0,0 +1,51 @@
+#ifndef __CLPP_OPERATOR_H__
+#define __CLPP_OPERATOR_H__
+
+#include "clpp/clppProgram.h"
+
+// A binary associative operator of the scans and the reductions : an OpenCL snippet, injected by compilePreprocess,
+// which defines for the values of type T :
+//   OPERATOR_APPLY(A,B) : the combination of 2 values (The left operand comes first in the data set)
+//   OPERATOR_IDENTITY   : the identity value
+// The snippet can use T_MIN and T_MAX, the limits of the predefined types.
+//
+// Example, a running max : clppOperator(Value_Float, "#define OPERATOR_APPLY(A,B) max(A,B)\n#define OPERATOR_IDENTITY T_MIN\n")
+//
+// With a custom value type, the snippet defines T too (Ex: a struct of 'valueSize' bytes, with the host layout) :
+//   typedef struct { uint count; float sum; } CountSum;
+//   #define T CountSum
+//   #define OPERATOR_APPLY(A,B) ((CountSum){(A).count + (B).count, (A).sum + (B).sum})
+//   #define OPERATOR_IDENTITY ((CountSum){0, 0.0f})
+class clppOperator
+{
+public:
+	// An operator of a predefined type
+	clppOperator(clppValueType valueType, const string& source);
+
+	// An operator of a custom type (Value_Custom) of 'valueSize' bytes, defined by 'source'
+	clppOperator(size_t valueSize, const string& source);
+
+	// The predefined operators
+	static clppOperator sum(clppValueType valueType);
+	static clppOperator product(clppValueType valueType);
+	static clppOperator minimum(clppValueType valueType);
+	static clppOperator maximum(clppValueType valueType);
+	static clppOperator bitwiseOr(clppValueType valueType);		// Integers only
+
+	clppValueType getValueType() const { return _valueType; }
+	size_t getValueSize() const { return _valueSize; }
+
+	// Returns the definitions to insert before the kernels : the type T, its limits and the operator.
+	// SUPPORT_VECTOR_LOADS is defined for the predefined types (vload2/vstore2 of T2).
+	// The sum, the minimum and the maximum define their built-in collectives too : OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE,
+	// OPERATOR_WORK_GROUP_REDUCE and OPERATOR_SUB_GROUP_SCAN_EXCLUSIVE (Used when the device supports them).
+	string getDefinitions() const;
+
+private:
+	clppValueType _valueType;
+	size_t _valueSize;
+	string _source;
+	string _collective;		// The suffix of the built-in collectives (add, min or max), empty if none
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "clpp/clppProfiler.h"
+#include "clpp/clppProgram.h"
+
+#include <map>
+#include <fstream>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+#pragma region Constructor
+
+clppProfiler::clppProfiler(cl_command_queue queue)
+{
+	_queue = queue;
+	_enabled = false;
+}
+
+clppProfiler::~clppProfiler()
+{
+	clear();
+}
+
+#pragma endregion
+
+#pragma region setEnabled
+
+bool clppProfiler::setEnabled(bool enabled)
+{
+	if (enabled)
+	{
+		cl_command_queue_properties properties = 0;
+		clGetCommandQueueInfo(_queue, CL_QUEUE_PROPERTIES, sizeof(properties), &properties, 0);
+		if (!(properties & CL_QUEUE_PROFILING_ENABLE))
+		{
+			_enabled = false;
+			return false;
+		}
+	}
+
+	_enabled = enabled;
+	return true;
+}
+
+#pragma endregion
+
+#pragma region record
+
+void clppProfiler::record(const std::string& primitive, const char* stage, size_t datasetSize, cl_event event, size_t bytes)
+{
+	clppProfilerRecord record;
+	record.primitive = primitive;
+	record.stage = stage ? stage : "";
+	record.datasetSize = datasetSize;
+	record.bytes = bytes;
+	record.queue = 0;
+	record.queued = record.submit = record.start = record.end = 0;
+	record.hostQueued = getHostTime();
+
+	clRetainEvent(event);
+	_pending.push_back(record);
+	_pendingEvents.push_back(event);
+}
+
+void clppProfiler::recordHost(const std::string& primitive, const char* stage, size_t datasetSize, cl_ulong hostStart, cl_ulong hostEnd)
+{
+	clppProfilerRecord record;
+	record.primitive = primitive;
+	record.stage = stage ? stage : "";
+	record.datasetSize = datasetSize;
+	record.bytes = 0;
+	record.queue = 0;
+	record.queued = record.submit = record.start = record.hostQueued = hostStart;
+	record.end = hostEnd;
+
+	_records.push_back(record);
+}
+
+cl_ulong clppProfiler::getHostTime()
+{
+#ifdef WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (cl_ulong)(counter.QuadPart * (1e9 / frequency.QuadPart));
+#elif defined(__APPLE__)
+	struct timeval time;
+	gettimeofday(&time, 0);
+	return (cl_ulong)time.tv_sec * 1000000000ULL + (cl_ulong)time.tv_usec * 1000ULL;
+#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (cl_ulong)time.tv_sec * 1000000000ULL + (cl_ulong)time.tv_nsec;
+#endif
+}
+
+const std::vector<clppProfilerRecord>& clppProfiler::getRecords()
+{
+	resolve();
+	return _records;
+}
+
+cl_ulong clppProfiler::getDeviceSpan(size_t firstRecord)
+{
+	resolve();
+
+	cl_ulong start = 0, end = 0;
+	for(size_t i = firstRecord; i < _records.size(); i++)
+	{
+		const clppProfilerRecord& record = _records[i];
+		if (record.queue == 0)
+			continue;
+
+		if (end == 0 || record.start < start)
+			start = record.start;
+		if (record.end > end)
+			end = record.end;
+	}
+
+	return end - start;
+}
+
+void clppProfiler::resolve()
+{
+	if (_pendingEvents.size() == 0)
+		return;
+
+	cl_int clStatus = clWaitForEvents((cl_uint)_pendingEvents.size(), &_pendingEvents[0]);
+	clppProgram::checkCLStatus(clStatus);
+
+	for(size_t i = 0; i < _pending.size(); i++)
+	{
+		clppProfilerRecord& record = _pending[i];
+		cl_event event = _pendingEvents[i];
+
+		clGetEventInfo(event, CL_EVENT_COMMAND_QUEUE, sizeof(cl_command_queue), &record.queue, 0);
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &record.queued, 0);
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &record.submit, 0);
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &record.start, 0);
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &record.end, 0);
+		clReleaseEvent(event);
+
+		_records.push_back(record);
+	}
+
+	_pending.clear();
+	_pendingEvents.clear();
+}
+
+void clppProfiler::clear()
+{
+	for(size_t i = 0; i < _pendingEvents.size(); i++)
+		clReleaseEvent(_pendingEvents[i]);
+
+	_pending.clear();
+	_pendingEvents.clear();
+	_records.clear();
+}
+
+#pragma endregion
+
+#pragma region printStatistics
+
+void clppProfiler::printStatistics()
+{
+	resolve();
+
+	// By primitive and stage, in order of appearance
+	std::vector<std::string> keys;
+	std::map<std::string, unsigned int> counts;
+	std::map<std::string, cl_ulong> times;
+	std::map<std::string, cl_ulong> waits;
+	std::map<std::string, double> bytes;
+	for(size_t i = 0; i < _records.size(); i++)
+	{
+		const clppProfilerRecord& record = _records[i];
+		std::string key = record.primitive + " / " + record.stage;
+		if (counts.find(key) == counts.end())
+			keys.push_back(key);
+
+		counts[key]++;
+		times[key] += record.end - record.start;
+		waits[key] += record.start - record.queued;
+		bytes[key] += record.bytes;
+	}
+
+	cout << "Profiler (" << _records.size() << " commands)" << endl;
+	for(size_t i = 0; i < keys.size(); i++)
+	{
+		const std::string& key = keys[i];
+		cout << "    " << key << " : " << counts[key] << " x " << (times[key] / counts[key]) * 1e-3 << " us";
+		cout << " (Total " << times[key] * 1e-6 << " ms, Queued " << (waits[key] / counts[key]) * 1e-3 << " us";
+		if (bytes[key] > 0 && times[key] > 0)
+			cout << ", " << bytes[key] / times[key] << " GB/s";
+		cout << ")" << endl;
+	}
+}
+
+#pragma endregion
+
+#pragma region writeTrace
+
+static std::string escapeJSON(const std::string& text)
+{
+	std::string escaped;
+	for(size_t i = 0; i < text.length(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\')
+			escaped += '\\';
+		escaped += text[i];
+	}
+	return escaped;
+}
+
+bool clppProfiler::writeTrace(const std::string& fileName)
+{
+	resolve();
+
+	std::ofstream file(fileName.c_str());
+	if (!file.is_open())
+		return false;
+
+	// The device timestamps are moved to the host clock : the command started 'start - queued' after it has been enqueued.
+	std::vector<cl_ulong> hostStarts(_records.size());
+	cl_ulong origin = 0;
+	for(size_t i = 0; i < _records.size(); i++)
+	{
+		const clppProfilerRecord& record = _records[i];
+		hostStarts[i] = record.hostQueued + (record.start - record.queued);
+		if (i == 0 || record.hostQueued < origin)
+			origin = record.hostQueued;
+	}
+
+	// One track for the host (0), one per queue
+	std::map<cl_command_queue, int> tracks;
+	tracks[0] = 0;
+
+	file.precision(15);
+	file << "{\"traceEvents\":[" << endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Host\"}}";
+	for(size_t i = 0; i < _records.size(); i++)
+	{
+		const clppProfilerRecord& record = _records[i];
+
+		if (tracks.find(record.queue) == tracks.end())
+		{
+			int track = (int)tracks.size();
+			tracks[record.queue] = track;
+			file << "," << endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"name\":\"Queue " << track << "\"}}";
+		}
+
+		// Complete event, in microseconds
+		file << "," << endl << "{\"name\":\"" << escapeJSON(record.stage) << "\",\"cat\":\"" << escapeJSON(record.primitive) << "\",\"ph\":\"X\"";
+		file << ",\"ts\":" << (hostStarts[i] - origin) * 1e-3 << ",\"dur\":" << (record.end - record.start) * 1e-3;
+		file << ",\"pid\":1,\"tid\":" << tracks[record.queue];
+		file << ",\"args\":{\"primitive\":\"" << escapeJSON(record.primitive) << "\",\"datasetSize\":" << record.datasetSize;
+		if (record.queue)
+			file << ",\"queuedToStart_us\":" << (record.start - record.queued) * 1e-3;
+		if (record.bytes)
+			file << ",\"bytes\":" << record.bytes;
+		file << "}}";
+	}
+	file << endl << "],\"displayTimeUnit\":\"ns\"}" << endl;
+
+	return true;
+}
+
+#pragma endregion
@@ -0,0 +1,83 @@
+#ifndef __CLPP_PROFILER_H__
+#define __CLPP_PROFILER_H__
+
+#if defined (__APPLE__) || defined(MACOSX)
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+#include <string>
+#include <vector>
+
+// A profiled command, or a host activity (queue = 0 : compilation, wait...).
+// The timestamps are in nanoseconds : the OpenCL device counters for a command, the host clock for a host activity.
+struct clppProfilerRecord
+{
+	std::string primitive;	// The name of the primitive (Ex: "Radix sort")
+	std::string stage;		// The stage of the primitive (Ex: "Local sort", "Scan level 0", "Read")
+	size_t datasetSize;		// The data set size of the primitive
+	size_t bytes;			// The device memory read and written by the command (0 if unknown)
+	cl_command_queue queue;
+
+	cl_ulong queued;
+	cl_ulong submit;
+	cl_ulong start;
+	cl_ulong end;
+
+	cl_ulong hostQueued;	// The host clock when the command has been enqueued
+};
+
+// Profiler of the commands enqueued by the primitives, shared by all the primitives of a context.
+// When enabled, every kernel and transfer is enqueued with an event, the timestamps are only read
+// when the records are requested : the queue is never serialized.
+// The queue must have been created with CL_QUEUE_PROFILING_ENABLE.
+class clppProfiler
+{
+public:
+	clppProfiler(cl_command_queue queue);
+	~clppProfiler();
+
+	// Start (or stop) to profile. Returns false if the queue does not support the profiling.
+	bool setEnabled(bool enabled);
+	bool isEnabled() { return _enabled; }
+
+	// Record an enqueued command, the profiler keeps a reference on the event.
+	void record(const std::string& primitive, const char* stage, size_t datasetSize, cl_event event, size_t bytes = 0);
+
+	// Record a host activity, between 'hostStart' and 'hostEnd' (See getHostTime).
+	void recordHost(const std::string& primitive, const char* stage, size_t datasetSize, cl_ulong hostStart, cl_ulong hostEnd);
+
+	// The host clock, in nanoseconds.
+	static cl_ulong getHostTime();
+
+	// Returns the records : wait for the pending commands and read their timestamps.
+	const std::vector<clppProfilerRecord>& getRecords();
+
+	// The device time of the commands recorded from the index 'firstRecord' : from the start of the first one
+	// to the end of the last one, in nanoseconds (0 if none). The host activities are not counted.
+	cl_ulong getDeviceSpan(size_t firstRecord);
+
+	// Forget all the records.
+	void clear();
+
+	// Print the count, total and average time of each stage (And its bandwidth when the traffic is known).
+	void printStatistics();
+
+	// Write the records to a Chrome trace-event JSON file (chrome://tracing, Perfetto).
+	// The host activities and each queue have their own track, the device timestamps are
+	// moved to the host clock so that the idle gaps between the commands are visible.
+	bool writeTrace(const std::string& fileName);
+
+private:
+	cl_command_queue _queue;
+	bool _enabled;
+
+	std::vector<clppProfilerRecord> _records;	// The resolved records
+	std::vector<clppProfilerRecord> _pending;	// The records waiting for their timestamps
+	std::vector<cl_event> _pendingEvents;
+
+	void resolve();
+};
+
+#endif
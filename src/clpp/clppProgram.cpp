@@ -1,5 +1,7 @@
 #include "clpp/clppProgram.h"
 
+#include <iterator>
+
 #ifdef WIN32
 #include <windows.h>
 #endif
@@ -9,17 +11,30 @@
 #endif
 
 string clppProgram::_basePath;
+string clppProgram::_cachePath;
 
 clppProgram::clppProgram()
 {
 	_clProgram = 0;
 	_context = 0;
+	_datasetSize = 0;
+	_lastEvent = 0;
+	_trackEvents = false;
+	_tempStorage = 0;
+	_tempStorageOffset = 0;
 }
 
 clppProgram::~clppProgram()
 {
     cl_int clStatus;
 
+	waitListConsumed();
+	if (_lastEvent)
+		clReleaseEvent(_lastEvent);
+
+	for(size_t i = 0; i < _ownedKernels.size(); i++)
+		clReleaseKernel(_ownedKernels[i]);
+
 	if (_clProgram)
 	{
 		clStatus = clReleaseProgram(_clProgram);
@@ -37,6 +52,16 @@ void clppProgram::setBasePath(string basePath)
 	_basePath = basePath;
 }
 
+string clppProgram::getCachePath()
+{
+	return _cachePath;
+}
+
+void clppProgram::setCachePath(string cachePath)
+{
+	_cachePath = cachePath;
+}
+
 bool clppProgram::compile(clppContext* context, string fileName)
 {
 	string programSource = loadSource(_basePath + fileName);
@@ -49,25 +74,51 @@ bool clppProgram::compile(clppContext* context, char* kernelCode)
 	cl_int clStatus;
 
 	_context = context;
+	cl_ulong hostStart = clppProfiler::getHostTime();
 
 	string programSource = string(kernelCode);
 
 	//---- Some preprocessing
 	programSource = compilePreprocess(programSource);
 
-	//---- Build the program
-	const char* ptr = programSource.c_str();
-	size_t len = programSource.length();
-	_clProgram = clCreateProgramWithSource(context->clContext, 1, (const char **)&ptr, &len, &clStatus);
-	checkCLStatus(clStatus);
-
 #ifdef __APPLE__
     //const char* buildOptions = "-DMAC -cl-fast-relaxed-math";
-	const char* buildOptions = "";
+	string options = "";
 #else
     //const char* buildOptions = "-cl-fast-relaxed-math";
-	const char* buildOptions = "";
+	string options = "";
 #endif
+	options += getBuildOptions();
+	const char* buildOptions = options.c_str();
+
+	//---- Already built for this context ?
+	string registryKey = programSource + "\n" + buildOptions;
+	_clProgram = context->getProgram(registryKey);
+	if (_clProgram)
+	{
+		clRetainProgram(_clProgram);
+		profileHost("Compile (Shared)", hostStart);
+		return true;
+	}
+
+	//---- Try to reload a previously compiled binary
+	string cacheFile;
+	if (_cachePath.length() > 0)
+	{
+		cacheFile = getCacheFileName(programSource, buildOptions);
+		if (loadBinary(cacheFile, buildOptions))
+		{
+			context->registerProgram(registryKey, _clProgram);
+			profileHost("Compile (Cached binary)", hostStart);
+			return true;
+		}
+	}
+
+	//---- Build the program
+	const char* ptr = programSource.c_str();
+	size_t len = programSource.length();
+	_clProgram = clCreateProgramWithSource(context->clContext, 1, (const char **)&ptr, &len, &clStatus);
+	checkCLStatus(clStatus);
 
 	clStatus = clBuildProgram(_clProgram, 0, NULL, buildOptions, NULL, NULL);
   
@@ -85,9 +136,173 @@ bool clppProgram::compile(clppContext* context, char* kernelCode)
 		return false;
 	}
 
+	//---- Store the binary for the next runs
+	if (cacheFile.length() > 0)
+		saveBinary(cacheFile);
+
+	context->registerProgram(registryKey, _clProgram);
+	profileHost("Compile", hostStart);
+
+	return true;
+}
+
+cl_kernel clppProgram::getKernel(const char* kernelName)
+{
+	return _context->getKernel(_clProgram, kernelName);
+}
+
+cl_kernel clppProgram::createKernel(const char* kernelName)
+{
+	cl_int clStatus;
+	cl_kernel kernel = clCreateKernel(_clProgram, kernelName, &clStatus);
+	checkCLStatus(clStatus);
+
+	_ownedKernels.push_back(kernel);
+
+	return kernel;
+}
+
+#pragma region Binary cache
+
+// 64 bits FNV-1a hash
+static cl_ulong hashString(cl_ulong hash, const string& text)
+{
+	for(size_t i = 0; i < text.length(); i++)
+	{
+		hash ^= (unsigned char)text[i];
+		hash *= 1099511628211ULL;
+	}
+
+	// Separator, to distinguish "ab"+"c" from "a"+"bc"
+	hash ^= 0xFF;
+	hash *= 1099511628211ULL;
+
+	return hash;
+}
+
+static string getDeviceInfoString(cl_device_id device, cl_device_info info)
+{
+	char infoStr[1024];
+	size_t infoLen = 0;
+	if (clGetDeviceInfo(device, info, sizeof(infoStr), infoStr, &infoLen) != CL_SUCCESS)
+		return "";
+	return string(infoStr);
+}
+
+string clppProgram::getCacheFileName(string programSource, const char* buildOptions)
+{
+	char platformVersion[1024];
+	if (clGetPlatformInfo(_context->clPlatform, CL_PLATFORM_VERSION, sizeof(platformVersion), platformVersion, NULL) != CL_SUCCESS)
+		platformVersion[0] = 0;
+
+	cl_ulong hash = 14695981039346656037ULL;
+	hash = hashString(hash, programSource);
+	hash = hashString(hash, buildOptions);
+	hash = hashString(hash, platformVersion);
+	hash = hashString(hash, getDeviceInfoString(_context->clDevice, CL_DEVICE_VENDOR));
+	hash = hashString(hash, getDeviceInfoString(_context->clDevice, CL_DEVICE_NAME));
+	hash = hashString(hash, getDeviceInfoString(_context->clDevice, CL_DEVICE_VERSION));
+	hash = hashString(hash, getDeviceInfoString(_context->clDevice, CL_DRIVER_VERSION));
+
+	char name[64];
+	sprintf(name, "clpp_%08x%08x.bin", (unsigned int)(hash >> 32), (unsigned int)(hash & 0xFFFFFFFF));
+
+	return _cachePath + name;
+}
+
+bool clppProgram::loadBinary(string cacheFile, const char* buildOptions)
+{
+	ifstream infile(cacheFile.c_str(), ios_base::in | ios_base::binary);
+	if (!infile)
+		return false;
+
+	string binary((istreambuf_iterator<char>(infile)), istreambuf_iterator<char>());
+	infile.close();
+	if (binary.length() < 1)
+		return false;
+
+	//---- Create the program from the binary
+	cl_int clStatus, binaryStatus;
+	const unsigned char* ptr = (const unsigned char*)binary.data();
+	size_t len = binary.length();
+	_clProgram = clCreateProgramWithBinary(_context->clContext, 1, &_context->clDevice, &len, &ptr, &binaryStatus, &clStatus);
+	if (clStatus != CL_SUCCESS || binaryStatus != CL_SUCCESS)
+	{
+		// Invalid or outdated binary : we will rebuild from the sources
+		if (_clProgram)
+			clReleaseProgram(_clProgram);
+		_clProgram = 0;
+		return false;
+	}
+
+	clStatus = clBuildProgram(_clProgram, 1, &_context->clDevice, buildOptions, NULL, NULL);
+	if (clStatus != CL_SUCCESS)
+	{
+		clReleaseProgram(_clProgram);
+		_clProgram = 0;
+		return false;
+	}
+
 	return true;
 }
 
+void clppProgram::saveBinary(string cacheFile)
+{
+	cl_int clStatus;
+
+	//---- Retreive the index of our device in the program
+	cl_uint devicesCount;
+	clStatus = clGetProgramInfo(_clProgram, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &devicesCount, NULL);
+	if (clStatus != CL_SUCCESS || devicesCount < 1)
+		return;
+
+	cl_device_id* devices = new cl_device_id[devicesCount];
+	size_t* binarySizes = new size_t[devicesCount];
+	unsigned char** binaries = new unsigned char*[devicesCount];
+	for(cl_uint i = 0; i < devicesCount; i++)
+		binaries[i] = 0;
+
+	clStatus = clGetProgramInfo(_clProgram, CL_PROGRAM_DEVICES, sizeof(cl_device_id) * devicesCount, devices, NULL);
+	clStatus |= clGetProgramInfo(_clProgram, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * devicesCount, binarySizes, NULL);
+
+	//---- Retreive the binaries
+	if (clStatus == CL_SUCCESS)
+	{
+		for(cl_uint i = 0; i < devicesCount; i++)
+			binaries[i] = new unsigned char[binarySizes[i] > 0 ? binarySizes[i] : 1];
+
+		clStatus = clGetProgramInfo(_clProgram, CL_PROGRAM_BINARIES, sizeof(unsigned char*) * devicesCount, binaries, NULL);
+	}
+
+	//---- Write our binary (In a temporary file first, to never expose an incomplete binary)
+	for(cl_uint i = 0; i < devicesCount && clStatus == CL_SUCCESS; i++)
+	{
+		if (devices[i] != _context->clDevice || binarySizes[i] < 1)
+			continue;
+
+		string tempFile = cacheFile + ".tmp";
+		ofstream outfile(tempFile.c_str(), ios_base::out | ios_base::binary);
+		if (!outfile)
+			break;
+
+		outfile.write((const char*)binaries[i], binarySizes[i]);
+		outfile.close();
+
+		remove(cacheFile.c_str());
+		if (rename(tempFile.c_str(), cacheFile.c_str()) != 0)
+			remove(tempFile.c_str());
+		break;
+	}
+
+	for(cl_uint i = 0; i < devicesCount; i++)
+		delete [] binaries[i];
+	delete [] binaries;
+	delete [] binarySizes;
+	delete [] devices;
+}
+
+#pragma endregion
+
 string clppProgram::compilePreprocess(string programSource)
 {
 	string source = "";
@@ -105,6 +320,15 @@ string clppProgram::compilePreprocess(string programSource)
 	else if (_context->isCPU)
 		source += "#define OCL_DEVICE_CPU\n";
 
+	// The collectives, detected by the compiler : the work-group functions need OpenCL C 2.0 (Optional in 3.0, See getBuildOptions)
+	source += "#if (defined(__OPENCL_C_VERSION__) && __OPENCL_C_VERSION__ == 200) || defined(__opencl_c_work_group_collective_functions)\n";
+	source += "#define SUPPORT_WORK_GROUP_COLLECTIVES\n";
+	source += "#endif\n";
+	source += "#if defined(cl_khr_subgroups) || defined(cl_intel_subgroups) || defined(__opencl_c_subgroups)\n";
+	source += "#ifdef cl_khr_subgroups\n#pragma OPENCL EXTENSION cl_khr_subgroups : enable\n#endif\n";
+	source += "#define SUPPORT_SUB_GROUPS\n";
+	source += "#endif\n";
+
 	return source + programSource;
 }
 
@@ -188,10 +412,242 @@ void clppProgram::checkCLStatus(cl_int clStatus)
 	assert(clStatus == CL_SUCCESS);
 }
 
+const char* clppProgram::getValueTypeName(clppValueType valueType)
+{
+	static const char* names[] = { "int", "uint", "float", "double", "long", "ulong", "T" };
+	return names[valueType];
+}
+
+size_t clppProgram::getValueTypeSize(clppValueType valueType)
+{
+	if (valueType == Value_Custom)
+		return 0;
+
+	return (valueType == Value_Double || valueType == Value_Long || valueType == Value_ULong) ? 8 : 4;
+}
+
+bool clppProgram::checkDatasetSize(size_t datasetSize, size_t maxElements)
+{
+	if (datasetSize <= maxElements)
+		return true;
+
+	printf("Error: %s : the data set (%u elements) is larger than maxElements (%u)\n", getName().c_str(), (unsigned int)datasetSize, (unsigned int)maxElements);
+	return false;
+}
+
 void clppProgram::waitCompletion()
 {
+	cl_ulong hostStart = clppProfiler::getHostTime();
 	clFinish(_context->clQueue);
+	profileHost("Wait", hostStart);
 
 	//cl_int clStatus = clFinish(_context->clQueue);
 	//checkCLStatus(clStatus);
 }
+
+#pragma region Buffers
+
+cl_mem clppProgram::allocateBuffer(size_t size)
+{
+	return _context->getBufferPool()->allocate(size);
+}
+
+void clppProgram::releaseBuffer(cl_mem& buffer)
+{
+	if (!buffer)
+		return;
+
+	_context->getBufferPool()->release(buffer);
+	buffer = 0;
+}
+
+size_t clppProgram::getScratchBytes(size_t size)
+{
+	size_t align = _context->memBaseAddrAlign;
+	return ((size + align - 1) / align) * align;
+}
+
+cl_mem clppProgram::allocateScratch(size_t size, size_t& scratchOffset)
+{
+	if (!_tempStorage)
+		return allocateBuffer(size);
+
+	cl_buffer_region region;
+	region.origin = _tempStorageOffset + scratchOffset;
+	region.size = size;
+
+	cl_int clStatus;
+	cl_mem buffer = clCreateSubBuffer(_tempStorage, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &clStatus);
+	checkCLStatus(clStatus);
+
+	scratchOffset += getScratchBytes(size);
+
+	return buffer;
+}
+
+void clppProgram::releaseScratch(cl_mem& buffer)
+{
+	if (!buffer)
+		return;
+
+	// A sub-buffer of the temporary storage, or a buffer of the pool
+	cl_mem parent = 0;
+	clGetMemObjectInfo(buffer, CL_MEM_ASSOCIATED_MEMOBJECT, sizeof(cl_mem), &parent, 0);
+	if (parent)
+	{
+		clReleaseMemObject(buffer);
+		buffer = 0;
+	}
+	else
+		releaseBuffer(buffer);
+}
+
+#pragma endregion
+
+#pragma region Asynchronous API
+
+void clppProgram::setWaitList(cl_uint numWaitEvents, const cl_event* waitEvents)
+{
+	for(cl_uint i = 0; i < numWaitEvents; i++)
+	{
+		clRetainEvent(waitEvents[i]);
+		_waitList.push_back(waitEvents[i]);
+	}
+}
+
+void clppProgram::setTrackEvents(bool trackEvents)
+{
+	_trackEvents = trackEvents;
+}
+
+cl_event clppProgram::getCompletionEvent()
+{
+	// Nothing tracked since the wait-list has been set : we use a marker
+	if (!_lastEvent || _waitList.size() > 0)
+	{
+		cl_int clStatus = CL_SUCCESS;
+		if (_waitList.size() > 0)
+			clStatus = clEnqueueWaitForEvents(_context->clQueue, (cl_uint)_waitList.size(), &_waitList[0]);
+
+		// The marker always needs an event, even when the commands are not tracked
+		bool trackEvents = _trackEvents;
+		_trackEvents = true;
+		clStatus |= clEnqueueMarker(_context->clQueue, nextEvent());
+		_trackEvents = trackEvents;
+
+		checkCLStatus(clStatus);
+		waitListConsumed();
+	}
+
+	cl_event event = _lastEvent;
+	_lastEvent = 0;
+
+	return event;
+}
+
+void clppProgram::beginAsync(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	setWaitList(numWaitEvents, waitEvents);
+	setTrackEvents(event != 0);
+}
+
+void clppProgram::endAsync(cl_event* event)
+{
+	if (event)
+		*event = getCompletionEvent();
+	setTrackEvents(false);
+}
+
+cl_event* clppProgram::nextEvent()
+{
+	// The profiler needs an event too
+	if (!_trackEvents && !isProfiling())
+		return NULL;
+
+	if (_lastEvent)
+		clReleaseEvent(_lastEvent);
+	_lastEvent = 0;
+
+	return &_lastEvent;
+}
+
+void clppProgram::waitListConsumed()
+{
+	for(size_t i = 0; i < _waitList.size(); i++)
+		clReleaseEvent(_waitList[i]);
+	_waitList.clear();
+}
+
+// Called after each enqueue : the wait-list has been consumed and the command can be profiled.
+void clppProgram::commandEnqueued(const char* stage, size_t bytes)
+{
+	waitListConsumed();
+
+	if (!_lastEvent)
+		return;
+
+	profileEvent(stage, _lastEvent, bytes);
+
+	// Only requested by the profiler
+	if (!_trackEvents)
+	{
+		clReleaseEvent(_lastEvent);
+		_lastEvent = 0;
+	}
+}
+
+bool clppProgram::isProfiling()
+{
+	return _context && _context->getProfiler() && _context->getProfiler()->isEnabled();
+}
+
+void clppProgram::profileEvent(const char* stage, cl_event event, size_t bytes)
+{
+	if (isProfiling())
+		_context->getProfiler()->record(getName(), stage, _datasetSize, event, bytes);
+}
+
+void clppProgram::profileHost(const char* stage, cl_ulong hostStart)
+{
+	if (isProfiling())
+		_context->getProfiler()->recordHost(getName(), stage, _datasetSize, hostStart, clppProfiler::getHostTime());
+}
+
+void clppProgram::adoptEvent(cl_event event)
+{
+	if (_lastEvent)
+		clReleaseEvent(_lastEvent);
+	_lastEvent = event;
+}
+
+cl_int clppProgram::enqueueKernel(cl_kernel kernel, cl_uint workDim, const size_t* globalWorkSize, const size_t* localWorkSize, const char* stage, size_t bytes)
+{
+	cl_int clStatus = clEnqueueNDRangeKernel(_context->clQueue, kernel, workDim, NULL, globalWorkSize, localWorkSize,
+		(cl_uint)_waitList.size(), _waitList.size() > 0 ? &_waitList[0] : NULL, nextEvent());
+	commandEnqueued(stage, bytes);
+
+	return clStatus;
+}
+
+cl_int clppProgram::enqueueWriteBuffer(cl_mem buffer, size_t size, const void* ptr)
+{
+	cl_int clStatus = clEnqueueWriteBuffer(_context->clQueue, buffer, CL_FALSE, 0, size, ptr,
+		(cl_uint)_waitList.size(), _waitList.size() > 0 ? &_waitList[0] : NULL, nextEvent());
+	commandEnqueued("Write", size);
+
+	return clStatus;
+}
+
+cl_int clppProgram::enqueueReadBuffer(cl_mem buffer, size_t size, void* ptr, size_t offset)
+{
+	// Blocking, except when the caller waits for the completion event
+	cl_bool blocking = _trackEvents ? CL_FALSE : CL_TRUE;
+
+	cl_int clStatus = clEnqueueReadBuffer(_context->clQueue, buffer, blocking, offset, size, ptr,
+		(cl_uint)_waitList.size(), _waitList.size() > 0 ? &_waitList[0] : NULL, nextEvent());
+	commandEnqueued("Read", size);
+
+	return clStatus;
+}
+
+#pragma endregion
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <stdexcept>
 #include <assert.h>
 #include <math.h>
+#include <vector>
 
 #if defined (__APPLE__) || defined(MACOSX)
 #include <OpenCL/opencl.h>
@@ -21,6 +22,10 @@
 
 //enum clppVendor { Vendor_Unknown, Vendor_NVidia, Vendor_AMD, Vendor_Intel };
 
+// The types of the values (The OpenCL type 'T' of the kernels). Value_Double needs cl_khr_fp64.
+// Value_Custom : the type is defined by the source of an operator (See clppOperator).
+enum clppValueType { Value_Int, Value_UInt, Value_Float, Value_Double, Value_Long, Value_ULong, Value_Custom };
+
 
 using namespace std;
 
@@ -34,12 +39,33 @@ public:
 	bool compile(clppContext* context, char* kernelCode);
 	virtual string compilePreprocess(string programSource);
 
+	// The options added to the build of the program (Ex: the OpenCL C version)
+	virtual string getBuildOptions() { return ""; }
+
+	// Returns the algorithm name
+	virtual string getName() = 0;
+
 	// Wait for the end of the program
 	virtual void waitCompletion();
 
+	// Asynchronous API : the next command enqueued by the primitive will wait for 'waitEvents'.
+	void setWaitList(cl_uint numWaitEvents, const cl_event* waitEvents);
+
+	// Asynchronous API : start (or stop) to track the enqueued commands, the last one is returned by 'getCompletionEvent'.
+	// When tracked, the reads to the host are not blocking anymore.
+	void setTrackEvents(bool trackEvents);
+
+	// Returns the event of the last tracked command, never 0. The caller must release it.
+	// If no command has been tracked since, a marker is enqueued to provide the event.
+	cl_event getCompletionEvent();
+
 	// Helper method : use to retreive textual error message
 	static void checkCLStatus(cl_int clStatus);
 
+	// The OpenCL name and the size in bytes of a value type
+	static const char* getValueTypeName(clppValueType valueType);
+	static size_t getValueTypeSize(clppValueType valueType);
+
 	// Load the cl source code
 	static string loadSource(string path);
 
@@ -47,15 +73,84 @@ public:
 	static string getBasePath();
 	static void setBasePath(string basePath);
 
+	// Set/Get the path of the program binary cache. (Empty = no cache)
+	// The compiled programs are stored there and reloaded with clCreateProgramWithBinary,
+	// the key is a hash of the preprocessed source, the build options and the device/driver version.
+	static string getCachePath();
+	static void setCachePath(string cachePath);
+
 protected:
 	cl_program _clProgram;
 	clppContext* _context;
 
+	size_t _datasetSize;	// The number of items of the current data set
+
+	vector<cl_kernel> _ownedKernels;	// Created by 'createKernel', released with the program
+
+	// Caller-owned temporary storage (0 if none)
+	cl_mem _tempStorage;
+	size_t _tempStorageOffset;
+
+	// Asynchronous API
+	std::vector<cl_event> _waitList;	// The events the next enqueued command has to wait for
+	cl_event _lastEvent;				// The event of the last enqueued command (when tracked)
+	bool _trackEvents;
+
 	static string _basePath;
+	static string _cachePath;
 
 protected:
 	static const char* getOpenCLErrorString(cl_int err);
 
+	// Returns a kernel of the program. (Shared with the other instances using the same program)
+	cl_kernel getKernel(const char* kernelName);
+
+	// Create a kernel owned by this instance : its arguments can be bound once and kept between the launches.
+	cl_kernel createKernel(const char* kernelName);
+
+	// Allocate a device buffer from the context's pool, and give it back (The buffer is set to 0).
+	cl_mem allocateBuffer(size_t size);
+	void releaseBuffer(cl_mem& buffer);
+
+	// Scratch buffers : a sub-buffer of the caller's temporary storage at 'scratchOffset' when one is set,
+	// else a buffer of the pool. 'scratchOffset' is advanced to the next aligned position.
+	cl_mem allocateScratch(size_t size, size_t& scratchOffset);
+	void releaseScratch(cl_mem& buffer);
+
+	// The size of a scratch buffer in the temporary storage (Aligned for the next sub-buffer).
+	size_t getScratchBytes(size_t size);
+
+	// Returns false, with an error, when a data set is larger than the buffers of the plan (In all the builds).
+	bool checkDatasetSize(size_t datasetSize, size_t maxElements);
+
+	// Enqueue the commands : they wait for the pending wait-list and, when tracked, keep the last event.
+	// When the profiler is enabled, the command is recorded under 'stage' ("Write" and "Read" for the transfers),
+	// with the device memory it reads and writes ('bytes', 0 if unknown) for the bandwidth.
+	cl_int enqueueKernel(cl_kernel kernel, cl_uint workDim, const size_t* globalWorkSize, const size_t* localWorkSize, const char* stage, size_t bytes = 0);
+	cl_int enqueueWriteBuffer(cl_mem buffer, size_t size, const void* ptr);
+	cl_int enqueueReadBuffer(cl_mem buffer, size_t size, void* ptr, size_t offset = 0);
+
+	// Profiling : a command, or a host activity started at 'hostStart' and ending now (See clppProfiler::getHostTime).
+	bool isProfiling();
+	void profileEvent(const char* stage, cl_event event, size_t bytes = 0);
+	void profileHost(const char* stage, cl_ulong hostStart);
+
+	// Wrap a synchronous operation : set the wait-list before and return the completion event after.
+	void beginAsync(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void endAsync(cl_event* event);
+
+	// Use the completion event of a nested primitive as our last event.
+	void adoptEvent(cl_event event);
+
+	cl_event* nextEvent();
+	void waitListConsumed();
+	void commandEnqueued(const char* stage, size_t bytes = 0);
+
+	// Binary cache
+	string getCacheFileName(string programSource, const char* buildOptions);
+	bool loadBinary(string cacheFile, const char* buildOptions);
+	void saveBinary(string cacheFile);
+
 	static size_t toMultipleOf(size_t N, size_t base) 
 	{
 		return static_cast<size_t>((ceil((double)N / (double)base) * base));
@@ -0,0 +1,123 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// Fill a data set with random keys (or key-value pairs) directly on the device.
+//
+// Algorithm :
+// -----------
+// Counter-based generator : each work-item hashes its index with Philox4x32-10,
+// so there is no state to store and the same seed always gives the same data set.
+//
+// References :
+// ------------
+// Parallel Random Numbers: As Easy as 1, 2, 3. John K. Salmon, Mark A. Moraes, Ron O. Dror, David E. Shaw.
+// http://www.thesalmons.org/john/random123/papers/random123sc11.pdf
+//------------------------------------------------------------
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// Must match clppRandomDistribution
+#define RANDOM_UNIFORM 0
+#define RANDOM_SORTED 1
+#define RANDOM_REVERSE 2
+#define RANDOM_FEWUNIQUE 3
+#define RANDOM_EQUAL 4
+#define RANDOM_ZIPF 5
+#define RANDOM_SAWTOOTH 6
+#define RANDOM_LOWENTROPY 7
+
+#define FEWUNIQUE_KEYS 16
+#define ZIPF_KEYS 1024
+#define SAWTOOTH_PERIOD 4096
+
+// The streams of counters : the data set words, and the words used to build the sets of unique keys
+#define STREAM_DATASET 0
+#define STREAM_KEYS 1
+
+//------------------------------------------------------------
+// philox4x32_10
+//
+// Purpose : Hash a 128 bits counter into 4 random words.
+//------------------------------------------------------------
+
+inline
+uint4 philox4x32_round(uint4 counter, uint2 key)
+{
+	uint hi0 = mul_hi(PHILOX_M0, counter.x);
+	uint lo0 = PHILOX_M0 * counter.x;
+	uint hi1 = mul_hi(PHILOX_M1, counter.z);
+	uint lo1 = PHILOX_M1 * counter.z;
+	return (uint4)(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+}
+
+inline
+uint4 philox4x32_10(uint4 counter, uint2 key)
+{
+	for(int round = 0; round < 9; round++)
+	{
+		counter = philox4x32_round(counter, key);
+		key += (uint2)(PHILOX_W0, PHILOX_W1);
+	}
+	return philox4x32_round(counter, key);
+}
+
+//------------------------------------------------------------
+// kernel__Random
+//
+// Purpose : Generate one key (and its value, the index) per work-item.
+// The keys are lower than 'maxKey'.
+//------------------------------------------------------------
+
+__kernel
+void kernel__Random(__global KV_TYPE* data, const uint datasetSize, const uint seed, const uint distribution, const uint maxKey)
+{
+	uint i = get_global_id(0);
+	if (i >= datasetSize)
+		return;
+
+	uint2 key = (uint2)(seed, 0x5DEECE66u);
+	uint4 words = philox4x32_10((uint4)(i, STREAM_DATASET, 0, 0), key);
+
+	uint value = 0;
+	switch(distribution)
+	{
+	case RANDOM_UNIFORM:
+		value = words.x % maxKey;
+		break;
+	case RANDOM_SORTED:
+		value = (uint)(((ulong)i * maxKey) / datasetSize);
+		break;
+	case RANDOM_REVERSE:
+		value = (uint)(((ulong)(datasetSize - 1 - i) * maxKey) / datasetSize);
+		break;
+	case RANDOM_FEWUNIQUE:
+		value = philox4x32_10((uint4)(words.x % FEWUNIQUE_KEYS, STREAM_KEYS, 0, 0), key).x % maxKey;
+		break;
+	case RANDOM_EQUAL:
+		value = maxKey / 2;
+		break;
+	case RANDOM_ZIPF:
+		{
+			// Inverse of the continuous CDF of P(rank k) ~ 1/(k+1)
+			float u = words.x * (1.0f / 4294967296.0f);
+			uint rank = min((uint)max(exp(u * log((float)(ZIPF_KEYS + 1))), 1.0f) - 1, (uint)(ZIPF_KEYS - 1));
+			value = philox4x32_10((uint4)(rank, STREAM_KEYS, 0, 0), key).x % maxKey;
+		}
+		break;
+	case RANDOM_SAWTOOTH:
+		value = (uint)(((ulong)(i % SAWTOOTH_PERIOD) * maxKey) / SAWTOOTH_PERIOD);
+		break;
+	case RANDOM_LOWENTROPY:
+		value = (words.x & words.y) % maxKey;
+		break;
+	}
+
+#ifdef KEYS_ONLY
+	data[i] = value;
+#else
+	data[i] = (uint2)(value, i);
+#endif
+}
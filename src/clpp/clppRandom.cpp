@@ -0,0 +1,87 @@
+#include "clpp/clppRandom.h"
+#include "clpp/clppRandom_CLKernel.h"
+
+#pragma region Constructor
+
+clppRandom::clppRandom(clppContext* context, bool keysOnly) :
+	clppProgram()
+{
+	_keysOnly = keysOnly;
+	_distribution = Random_Uniform;
+	_keyBits = 32;
+	_kernel_Random = 0;
+	_workgroupSize = 0;
+
+	if (!compile(context, clCode_clppRandom))
+		return;
+
+	//---- Owned kernel : only the buffer, the size and the seed change between the launches
+	_kernel_Random = createKernel("kernel__Random");
+
+	clGetKernelWorkGroupInfo(_kernel_Random, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
+}
+
+#pragma endregion
+
+#pragma region compilePreprocess
+
+string clppRandom::compilePreprocess(string kernel)
+{
+	string source = _keysOnly ? "#define KV_TYPE uint\n" : "#define KV_TYPE uint2\n";
+
+	if (_keysOnly)
+		source += "#define KEYS_ONLY 1\n";
+
+	return clppProgram::compilePreprocess(source + kernel);
+}
+
+#pragma endregion
+
+#pragma region generate
+
+string clppRandom::getName()
+{
+	return "Random";
+}
+
+void clppRandom::setDistribution(clppRandomDistribution distribution, unsigned int keyBits)
+{
+	_distribution = distribution;
+	_keyBits = keyBits;
+}
+
+void clppRandom::generate(cl_mem clBuffer_dataSet, size_t datasetSize, unsigned int seed)
+{
+	cl_int clStatus;
+
+	_datasetSize = datasetSize;
+
+	unsigned int size = (unsigned int)datasetSize;
+	unsigned int distribution = _distribution;
+	unsigned int maxKey = (1u << (_keyBits - 1)) - 1; // Max 'signed' value
+	if (maxKey == 0)
+		maxKey = 1;
+
+	clStatus  = clSetKernelArg(_kernel_Random, 0, sizeof(cl_mem), &clBuffer_dataSet);
+	clStatus |= clSetKernelArg(_kernel_Random, 1, sizeof(int), &size);
+	clStatus |= clSetKernelArg(_kernel_Random, 2, sizeof(int), &seed);
+	clStatus |= clSetKernelArg(_kernel_Random, 3, sizeof(int), &distribution);
+	clStatus |= clSetKernelArg(_kernel_Random, 4, sizeof(int), &maxKey);
+	checkCLStatus(clStatus);
+
+	size_t globalWorkSize = {toMultipleOf(datasetSize, _workgroupSize)};
+	size_t localWorkSize = {_workgroupSize};
+
+	size_t elementSize = _keysOnly ? sizeof(int) : 2 * sizeof(int);
+	clStatus = enqueueKernel(_kernel_Random, 1, &globalWorkSize, &localWorkSize, "Generate", elementSize * datasetSize);
+	checkCLStatus(clStatus);
+}
+
+void clppRandom::generate(cl_mem clBuffer_dataSet, size_t datasetSize, unsigned int seed, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	generate(clBuffer_dataSet, datasetSize, seed);
+	endAsync(event);
+}
+
+#pragma endregion
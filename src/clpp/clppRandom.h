@@ -0,0 +1,53 @@
+#ifndef __CLPP_RANDOM_H__
+#define __CLPP_RANDOM_H__
+
+#include "clpp/clppProgram.h"
+
+// The shapes of the generated keys
+enum clppRandomDistribution
+{
+	Random_Uniform,			// Uniform random keys
+	Random_Sorted,			// Already sorted
+	Random_Reverse,			// Sorted in the reverse order
+	Random_FewUnique,		// 16 different random keys
+	Random_Equal,			// All the keys are equal
+	Random_Zipf,			// Zipf-skewed ranks (s = 1) over 1024 random keys
+	Random_Sawtooth,		// Ascending runs of 4096 keys
+	Random_LowEntropy,		// Bitwise AND of 2 random words
+	Random_Count
+};
+
+// Fill a device buffer with random keys or key-value pairs, without any host round-trip.
+// Counter-based (Philox4x32-10) : the same seed gives the same data set, whatever the device.
+class clppRandom : public clppProgram
+{
+public:
+	// Create a generator of keys, or of key-value pairs (The value is the index of the pair).
+	clppRandom(clppContext* context, bool keysOnly);
+
+	// Returns the algorithm name
+	string getName();
+
+	string compilePreprocess(string kernel);
+
+	// Set the shape of the keys : they are lower than the max 'signed' value of 'keyBits' bits. (Default : uniform, 32 bits)
+	void setDistribution(clppRandomDistribution distribution, unsigned int keyBits);
+
+	// Fill 'clBuffer_dataSet' with 'datasetSize' keys (or pairs).
+	void generate(cl_mem clBuffer_dataSet, size_t datasetSize, unsigned int seed);
+
+	// Asynchronous version : the command waits for 'waitEvents' and 'event' receives the completion event
+	// (Can be null, else it must be released by the caller).
+	void generate(cl_mem clBuffer_dataSet, size_t datasetSize, unsigned int seed, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+
+private:
+	bool _keysOnly;
+
+	clppRandomDistribution _distribution;
+	unsigned int _keyBits;
+
+	cl_kernel _kernel_Random;
+	size_t _workgroupSize;
+};
+
+#endif
@@ -0,0 +1,86 @@
+
+char clCode_clppRandom[]=
+"#define PHILOX_M0 0xD2511F53u\n"
+"#define PHILOX_M1 0xCD9E8D57u\n"
+"#define PHILOX_W0 0x9E3779B9u\n"
+"#define PHILOX_W1 0xBB67AE85u\n"
+"#define RANDOM_UNIFORM 0\n"
+"#define RANDOM_SORTED 1\n"
+"#define RANDOM_REVERSE 2\n"
+"#define RANDOM_FEWUNIQUE 3\n"
+"#define RANDOM_EQUAL 4\n"
+"#define RANDOM_ZIPF 5\n"
+"#define RANDOM_SAWTOOTH 6\n"
+"#define RANDOM_LOWENTROPY 7\n"
+"#define FEWUNIQUE_KEYS 16\n"
+"#define ZIPF_KEYS 1024\n"
+"#define SAWTOOTH_PERIOD 4096\n"
+"#define STREAM_DATASET 0\n"
+"#define STREAM_KEYS 1\n"
+"inline\n"
+"uint4 philox4x32_round(uint4 counter, uint2 key)\n"
+"{\n"
+"	uint hi0 = mul_hi(PHILOX_M0, counter.x);\n"
+"	uint lo0 = PHILOX_M0 * counter.x;\n"
+"	uint hi1 = mul_hi(PHILOX_M1, counter.z);\n"
+"	uint lo1 = PHILOX_M1 * counter.z;\n"
+"	return (uint4)(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);\n"
+"}\n"
+"inline\n"
+"uint4 philox4x32_10(uint4 counter, uint2 key)\n"
+"{\n"
+"	for(int round = 0; round < 9; round++)\n"
+"	{\n"
+"		counter = philox4x32_round(counter, key);\n"
+"		key += (uint2)(PHILOX_W0, PHILOX_W1);\n"
+"	}\n"
+"	return philox4x32_round(counter, key);\n"
+"}\n"
+"__kernel\n"
+"void kernel__Random(__global KV_TYPE* data, const uint datasetSize, const uint seed, const uint distribution, const uint maxKey)\n"
+"{\n"
+"	uint i = get_global_id(0);\n"
+"	if (i >= datasetSize)\n"
+"		return;\n"
+"	uint2 key = (uint2)(seed, 0x5DEECE66u);\n"
+"	uint4 words = philox4x32_10((uint4)(i, STREAM_DATASET, 0, 0), key);\n"
+"	uint value = 0;\n"
+"	switch(distribution)\n"
+"	{\n"
+"	case RANDOM_UNIFORM:\n"
+"		value = words.x % maxKey;\n"
+"		break;\n"
+"	case RANDOM_SORTED:\n"
+"		value = (uint)(((ulong)i * maxKey) / datasetSize);\n"
+"		break;\n"
+"	case RANDOM_REVERSE:\n"
+"		value = (uint)(((ulong)(datasetSize - 1 - i) * maxKey) / datasetSize);\n"
+"		break;\n"
+"	case RANDOM_FEWUNIQUE:\n"
+"		value = philox4x32_10((uint4)(words.x % FEWUNIQUE_KEYS, STREAM_KEYS, 0, 0), key).x % maxKey;\n"
+"		break;\n"
+"	case RANDOM_EQUAL:\n"
+"		value = maxKey / 2;\n"
+"		break;\n"
+"	case RANDOM_ZIPF:\n"
+"		{\n"
+"			// Inverse of the continuous CDF of P(rank k) ~ 1/(k+1)\n"
+"			float u = words.x * (1.0f / 4294967296.0f);\n"
+"			uint rank = min((uint)max(exp(u * log((float)(ZIPF_KEYS + 1))), 1.0f) - 1, (uint)(ZIPF_KEYS - 1));\n"
+"			value = philox4x32_10((uint4)(rank, STREAM_KEYS, 0, 0), key).x % maxKey;\n"
+"		}\n"
+"		break;\n"
+"	case RANDOM_SAWTOOTH:\n"
+"		value = (uint)(((ulong)(i % SAWTOOTH_PERIOD) * maxKey) / SAWTOOTH_PERIOD);\n"
+"		break;\n"
+"	case RANDOM_LOWENTROPY:\n"
+"		value = (words.x & words.y) % maxKey;\n"
+"		break;\n"
+"	}\n"
+"#ifdef KEYS_ONLY\n"
+"	data[i] = value;\n"
+"#else\n"
+"	data[i] = (uint2)(value, i);\n"
+"#endif\n"
+"}\n"
+;
@@ -0,0 +1,77 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// Reduce a data set to a single value : the sum, the min, the max... of all the elements.
+//
+// Algorithm :
+// -----------
+// Each work-group reduces a contiguous range of the data set, in tiles of 'local size' consecutive elements :
+// the loads are coalesced, each tile is reduced in local memory with a sequential addressing tree and the
+// results of the tiles are accumulated from left to right.
+// The sequential addressing combines the slot i with the slot i + s, so each work-item stores its element in
+// the bit-reversed slot : the tree then combines the elements of the tile in order.
+// The partial results (At most one per work-item) are reduced by a single work-group, with the same kernel.
+//
+// The elements are combined in the data set order : the operator only has to be associative (Not commutative).
+//
+// References :
+// ------------
+// Mark Harris. Optimizing Parallel Reduction in CUDA.
+// http://developer.download.nvidia.com/compute/cuda/1.1-Beta/x86_website/projects/reduction/doc/reduction.pdf
+//------------------------------------------------------------
+
+// The type of the values T, OPERATOR_APPLY and OPERATOR_IDENTITY are defined by the clppOperator of the reduction
+
+//------------------------------------------------------------
+// kernel__Reduce
+//
+// Purpose : Reduce the data set to one value per work-group. (The local size is a power of 2)
+//------------------------------------------------------------
+
+__kernel
+void kernel__Reduce(
+	__global const T* input,
+	__global T* output,
+	__local T* localBuffer,
+	const uint size)
+{
+	const uint tid = get_local_id(0);
+	const uint lwz = get_local_size(0);
+	const uint groups = get_num_groups(0);
+
+	// The range of the work-group, a multiple of the tiles
+	const uint groupLength = ((size + groups - 1) / groups + lwz - 1) / lwz * lwz;
+	const uint groupStart = min(get_group_id(0) * groupLength, size);
+	const uint groupEnd = min(groupStart + groupLength, size);
+
+	// The bit-reversed slot of the work-item
+	uint slot = 0;
+	for(uint b = 1, r = lwz >> 1; b < lwz; b <<= 1, r >>= 1)
+		if (tid & b)
+			slot |= r;
+
+	T value = OPERATOR_IDENTITY;
+	for(uint tileStart = groupStart; tileStart < groupEnd; tileStart += lwz)
+	{
+		// Coalesced load of the tile (The previous tile must have been read)
+		const uint i = tileStart + tid;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		localBuffer[slot] = i < groupEnd ? input[i] : OPERATOR_IDENTITY;
+
+		// Sequential addressing tree reduction
+		for(uint s = lwz >> 1; s > 0; s >>= 1)
+		{
+			barrier(CLK_LOCAL_MEM_FENCE);
+
+			if (tid < s)
+				localBuffer[tid] = OPERATOR_APPLY(localBuffer[tid], localBuffer[tid + s]);
+		}
+
+		// The tiles are accumulated from left to right
+		if (tid == 0)
+			value = OPERATOR_APPLY(value, localBuffer[0]);
+	}
+
+	if (tid == 0)
+		output[get_group_id(0)] = value;
+}
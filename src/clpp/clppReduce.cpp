@@ -0,0 +1,191 @@
+#include "clpp/clppReduce.h"
+#include "clpp/clppReduce_CLKernel.h"
+
+#pragma region Constructor
+
+clppReduce::clppReduce(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppProgram(), _operator(clppOperator::sum(valueType))
+{
+	_context = context;
+	createPlan(maxElements);
+}
+
+clppReduce::clppReduce(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	clppProgram(), _operator(op)
+{
+	_context = context;
+	createPlan(maxElements);
+}
+
+void clppReduce::createPlan(unsigned int maxElements)
+{
+	_valueSize = _operator.getValueSize();
+	_clBuffer_values = 0;
+	_clBuffer_ownedValues = 0;
+	_maxElements = maxElements;
+	_kernel_Reduce = 0;
+	_kernel_ReducePartials = 0;
+	_workgroupSize = 0;
+	_clBuffer_Partials = 0;
+	_clBuffer_Result = 0;
+
+	if (_operator.getValueType() == Value_Double && !_context->supportsDouble)
+	{
+		printf("Error: The device doesn't support the double precision (cl_khr_fp64)\n");
+		return;
+	}
+
+	if (!compile(_context, clCode_clppReduce))
+		return;
+
+	//---- Owned kernels : the 2 passes have different arguments
+	_kernel_Reduce = createKernel("kernel__Reduce");
+	_kernel_ReducePartials = createKernel("kernel__Reduce");
+
+	//---- The tree reduction needs a power of 2
+	size_t maxWorkgroupSize;
+	clGetKernelWorkGroupInfo(_kernel_Reduce, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkgroupSize, 0);
+	for(_workgroupSize = 1; _workgroupSize * 2 <= maxWorkgroupSize; _workgroupSize *= 2);
+
+	//---- At most one partial result per work-item of the last pass
+	_clBuffer_Partials = allocateBuffer(_valueSize * _workgroupSize);
+	_clBuffer_Result = allocateBuffer(_valueSize);
+}
+
+clppReduce::~clppReduce()
+{
+	releaseBuffer(_clBuffer_ownedValues);
+	releaseBuffer(_clBuffer_Partials);
+	releaseBuffer(_clBuffer_Result);
+}
+
+#pragma endregion
+
+#pragma region compilePreprocess
+
+string clppReduce::compilePreprocess(string kernel)
+{
+	return clppProgram::compilePreprocess(_operator.getDefinitions() + kernel);
+}
+
+#pragma endregion
+
+#pragma region reduce
+
+string clppReduce::getName()
+{
+	return "Reduce";
+}
+
+void clppReduce::reduce()
+{
+	cl_int clStatus;
+
+	//---- Pass 1 : each work-group reduces a contiguous range of the data set, tile by tile
+	size_t workgroups = (_datasetSize + _workgroupSize - 1) / _workgroupSize;
+	if (workgroups > _workgroupSize)
+		workgroups = _workgroupSize;
+	if (workgroups < 1)
+		workgroups = 1;
+
+	unsigned int size = (unsigned int)_datasetSize;
+	cl_mem output = workgroups > 1 ? _clBuffer_Partials : _clBuffer_Result;
+
+	clStatus  = clSetKernelArg(_kernel_Reduce, 0, sizeof(cl_mem), &_clBuffer_values);
+	clStatus |= clSetKernelArg(_kernel_Reduce, 1, sizeof(cl_mem), &output);
+	clStatus |= clSetKernelArg(_kernel_Reduce, 2, _workgroupSize * _valueSize, 0);
+	clStatus |= clSetKernelArg(_kernel_Reduce, 3, sizeof(int), &size);
+	checkCLStatus(clStatus);
+
+	size_t globalWorkSize = {workgroups * _workgroupSize};
+	size_t localWorkSize = {_workgroupSize};
+	clStatus = enqueueKernel(_kernel_Reduce, 1, &globalWorkSize, &localWorkSize, "Reduce", _valueSize * (_datasetSize + workgroups));
+	checkCLStatus(clStatus);
+
+	if (workgroups < 2)
+		return;
+
+	//---- Pass 2 : a single work-group reduces the partial results
+	unsigned int partials = (unsigned int)workgroups;
+
+	clStatus  = clSetKernelArg(_kernel_ReducePartials, 0, sizeof(cl_mem), &_clBuffer_Partials);
+	clStatus |= clSetKernelArg(_kernel_ReducePartials, 1, sizeof(cl_mem), &_clBuffer_Result);
+	clStatus |= clSetKernelArg(_kernel_ReducePartials, 2, _workgroupSize * _valueSize, 0);
+	clStatus |= clSetKernelArg(_kernel_ReducePartials, 3, sizeof(int), &partials);
+	checkCLStatus(clStatus);
+
+	globalWorkSize = _workgroupSize;
+	clStatus = enqueueKernel(_kernel_ReducePartials, 1, &globalWorkSize, &localWorkSize, "Reduce partials", _valueSize * (workgroups + 1));
+	checkCLStatus(clStatus);
+}
+
+void clppReduce::reduce(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	reduce();
+	endAsync(event);
+}
+
+#pragma endregion
+
+#pragma region pushDatas
+
+void clppReduce::pushDatas(void* values, size_t datasetSize)
+{
+	cl_int clStatus;
+
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	_datasetSize = datasetSize;
+
+	//---- Allocated once, for maxElements
+	if (!_clBuffer_ownedValues)
+		_clBuffer_ownedValues = allocateBuffer(_valueSize * _maxElements);
+	_clBuffer_values = _clBuffer_ownedValues;
+
+	//---- Copy on the device
+	clStatus = enqueueWriteBuffer(_clBuffer_values, _valueSize * _datasetSize, values);
+	checkCLStatus(clStatus);
+}
+
+void clppReduce::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
+{
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	_clBuffer_values = clBuffer_values;
+	_datasetSize = datasetSize;
+}
+
+void clppReduce::pushDatas(void* values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	pushDatas(values, datasetSize);
+	endAsync(event);
+}
+
+void clppReduce::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents)
+{
+	setWaitList(numWaitEvents, waitEvents);
+	pushCLDatas(clBuffer_values, datasetSize);
+}
+
+#pragma endregion
+
+#pragma region popResult
+
+void clppReduce::popResult(void* result)
+{
+	cl_int clStatus = enqueueReadBuffer(_clBuffer_Result, _valueSize, result);
+	checkCLStatus(clStatus);
+}
+
+void clppReduce::popResult(void* result, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	popResult(result);
+	endAsync(event);
+}
+
+#pragma endregion
@@ -0,0 +1,63 @@
+#ifndef __CLPP_REDUCE_H__
+#define __CLPP_REDUCE_H__
+
+#include "clpp/clppProgram.h"
+#include "clpp/clppOperator.h"
+
+// Reduce a data set to a single value with an operator : the sum, the min, the max... or a custom operator.
+// The operator must be associative, it doesn't have to be commutative (The values are combined in the data set order).
+class clppReduce : public clppProgram
+{
+public:
+	// Create a new reduction.
+	// maxElements : the maximum number of elements to reduce.
+	clppReduce(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppReduce(clppContext* context, const clppOperator& op, unsigned int maxElements);
+	~clppReduce();
+
+	// Returns the algorithm name
+	string getName();
+
+	string compilePreprocess(string kernel);
+
+	// Start the reduction
+	void reduce();
+
+	// Send a Host data set to the device
+	void pushDatas(void* values, size_t datasetSize);
+
+	// Push a buffer that is already on the device side. (Data are not sended)
+	void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize);
+
+	// Retreive the result, a single value of the operator's type.
+	void popResult(void* result);
+
+	// The device buffer of the result, for the next primitives
+	cl_mem getResultBuffer() { return _clBuffer_Result; }
+
+	// Asynchronous versions : the commands wait for 'waitEvents' and 'event' receives the completion event
+	// (Can be null, else it must be released by the caller). An asynchronous popResult doesn't block.
+	void reduce(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void pushDatas(void* values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents);
+	void popResult(void* result, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+
+private:
+	clppOperator _operator;
+	size_t _valueSize;		// The size of a value in bytes
+
+	cl_mem _clBuffer_values;
+	cl_mem _clBuffer_ownedValues;		// Used by pushDatas
+	unsigned int _maxElements;
+
+	cl_kernel _kernel_Reduce;			// The data set to the partial results, one per work-group
+	cl_kernel _kernel_ReducePartials;	// The partial results to the result
+	size_t _workgroupSize;				// A power of 2
+
+	cl_mem _clBuffer_Partials;
+	cl_mem _clBuffer_Result;
+
+	void createPlan(unsigned int maxElements);
+};
+
+#endif
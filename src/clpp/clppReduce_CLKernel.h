@@ -0,0 +1,43 @@
+
+char clCode_clppReduce[]=
+"__kernel\n"
+"void kernel__Reduce(\n"
+"	__global const T* input,\n"
+"	__global T* output,\n"
+"	__local T* localBuffer,\n"
+"	const uint size)\n"
+"{\n"
+"	const uint tid = get_local_id(0);\n"
+"	const uint lwz = get_local_size(0);\n"
+"	const uint groups = get_num_groups(0);\n"
+"	// The range of the work-group, a multiple of the tiles\n"
+"	const uint groupLength = ((size + groups - 1) / groups + lwz - 1) / lwz * lwz;\n"
+"	const uint groupStart = min(get_group_id(0) * groupLength, size);\n"
+"	const uint groupEnd = min(groupStart + groupLength, size);\n"
+"	// The bit-reversed slot of the work-item\n"
+"	uint slot = 0;\n"
+"	for(uint b = 1, r = lwz >> 1; b < lwz; b <<= 1, r >>= 1)\n"
+"		if (tid & b)\n"
+"			slot |= r;\n"
+"	T value = OPERATOR_IDENTITY;\n"
+"	for(uint tileStart = groupStart; tileStart < groupEnd; tileStart += lwz)\n"
+"	{\n"
+"		// Coalesced load of the tile (The previous tile must have been read)\n"
+"		const uint i = tileStart + tid;\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		localBuffer[slot] = i < groupEnd ? input[i] : OPERATOR_IDENTITY;\n"
+"		// Sequential addressing tree reduction\n"
+"		for(uint s = lwz >> 1; s > 0; s >>= 1)\n"
+"		{\n"
+"			barrier(CLK_LOCAL_MEM_FENCE);\n"
+"			if (tid < s)\n"
+"				localBuffer[tid] = OPERATOR_APPLY(localBuffer[tid], localBuffer[tid + s]);\n"
+"		}\n"
+"		// The tiles are accumulated from left to right\n"
+"		if (tid == 0)\n"
+"			value = OPERATOR_APPLY(value, localBuffer[0]);\n"
+"	}\n"
+"	if (tid == 0)\n"
+"		output[get_group_id(0)] = value;\n"
+"}\n"
+;
@@ -0,0 +1,139 @@
+#include "clpp/clppScan.h"
+
+#pragma region Constructor
+
+clppScan::clppScan(clppContext* context, size_t valueSize, unsigned int maxElements) :
+	_operator(clppOperator::sum(valueSize == 8 ? Value_Long : Value_Int))
+{
+	setup(context);
+}
+
+clppScan::clppScan(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	_operator(clppOperator::sum(valueType))
+{
+	setup(context);
+}
+
+clppScan::clppScan(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	_operator(op)
+{
+	setup(context);
+}
+
+clppScan::clppScan(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements) :
+	_operator(op),
+	_transform(transform)
+{
+	setup(context);
+}
+
+void clppScan::setup(clppContext* context)
+{
+	_values = 0;
+	_context = context;
+	_valueType = _operator.getValueType();
+	_valueSize = _operator.getValueSize();
+	_inputSize = _transform.isEnabled() ? _transform.getInputSize() : _valueSize;
+	_datasetSize = 0;
+	_clBuffer_values = 0;
+	_clBuffer_output = 0;
+	_inclusive = false;
+	_clBuffer_total = 0;
+	_clBuffer_ownedTotal = 0;
+	_totalIndex = 0;
+	_workgroupSize = 0;
+	_is_clBuffersOwner = false;
+}
+
+clppScan::~clppScan()
+{
+	releaseBuffer(_clBuffer_ownedTotal);
+}
+
+bool clppScan::checkValueType()
+{
+	bool isDouble = (_valueType == Value_Double) || (_transform.isEnabled() && _transform.getInputType() == Value_Double);
+	if (isDouble && !_context->supportsDouble)
+	{
+		printf("Error: The device doesn't support the double precision (cl_khr_fp64)\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool clppScan::checkTransformOutput()
+{
+	if (_transform.isEnabled() && !_clBuffer_output)
+	{
+		printf("Error: A transform-scan needs an output buffer (See setOutput)\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool clppScan::checkPopToInputs()
+{
+	if (_transform.isEnabled())
+	{
+		printf("Error: The results of a transform-scan must be read with popDatas(void*)\n");
+		return false;
+	}
+
+	return true;
+}
+
+#pragma endregion
+
+#pragma region compilePreprocess
+
+string clppScan::compilePreprocess(string kernel)
+{
+	return clppProgram::compilePreprocess(_operator.getDefinitions() + _transform.getDefinitions() + kernel);
+}
+
+string clppScan::getBuildOptions()
+{
+	// Without '-cl-std', the programs are built as OpenCL C 1.2 at most
+	if (_context->openCLCVersion >= 300)
+		return "-cl-std=CL3.0";
+	if (_context->openCLCVersion >= 200)
+		return "-cl-std=CL2.0";
+
+	return "";
+}
+
+#pragma endregion
+
+#pragma region Total
+
+void clppScan::setTotal(bool enable, cl_mem clBuffer_total, unsigned int index)
+{
+	if (!enable)
+	{
+		_clBuffer_total = 0;
+		return;
+	}
+
+	if (!clBuffer_total)
+	{
+		if (!_clBuffer_ownedTotal)
+			_clBuffer_ownedTotal = allocateBuffer(_valueSize);
+		clBuffer_total = _clBuffer_ownedTotal;
+		index = 0;
+	}
+
+	_clBuffer_total = clBuffer_total;
+	_totalIndex = index;
+}
+
+void clppScan::popTotal(void* total)
+{
+	assert(_clBuffer_total);
+
+	cl_int clStatus = enqueueReadBuffer(_clBuffer_total, _valueSize, total, _valueSize * _totalIndex);
+	checkCLStatus(clStatus);
+}
+
+#pragma endregion
@@ -2,6 +2,8 @@
 #define __CLPP_SCAN_H__
 
 #include "clpp/clppProgram.h"
+#include "clpp/clppOperator.h"
+#include "clpp/clppTransform.h"
 
 class clppScan : public clppProgram
 {
@@ -9,16 +11,29 @@ public:
 	
 	// Create a new scan.
 	// maxElements : the maximum number of elements to scan.
-	clppScan(clppContext* context, size_t valueSize, unsigned int maxElements)
-	{
-		_values = 0;
-		_context = context;
-		_valueSize = valueSize;
-		_datasetSize = 0;
-		_clBuffer_values = 0;
-		_workgroupSize = 0;
-		_is_clBuffersOwner = false;
-	}
+	// valueSize : 4 (int) or 8 (long) bytes, use a value type for the others (uint, float, double...).
+	// The default operator is the sum, use a clppOperator for the others (min, max, product, custom type...).
+	clppScan(clppContext* context, size_t valueSize, unsigned int maxElements);
+	clppScan(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppScan(clppContext* context, const clppOperator& op, unsigned int maxElements);
+
+	// Transform-scan : the scan of transform(x), the input is kept and the results are written to the output buffer.
+	// The data sets are inputs (Pushed with the input size), the results are values : read them with popDatas(void*),
+	// to a host buffer of datasetSize values (popDatas() refuses, the input array can be smaller).
+	clppScan(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements);
+	~clppScan();
+
+	// Returns the type of the scanned values
+	clppValueType getValueType() { return _valueType; }
+
+	// Returns the transform of the loaded values (Disabled by default)
+	const clppTransform& getTransform() { return _transform; }
+
+	// Define the type of the kernels ('T' and 'T2', its vector of 2, for the vector loads), the operator and the transform
+	string compilePreprocess(string kernel);
+
+	// Build with the OpenCL C version of the device, for the work-group collectives (2.0 and later)
+	string getBuildOptions();
 
 	// Returns the algorithm name
 	virtual string getName() = 0;
@@ -32,20 +47,109 @@ public:
 	// Push a buffer that is already on the device side. (Data are not sended)
 	virtual void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize) = 0;
 
-	// Retreive the datas (To the same zone as the source).
+	// Retreive the datas (To the same zone as the source). The results are read from the output buffer.
 	virtual void popDatas() = 0;
 	virtual void popDatas(void* dataSet) = 0;
 
-protected:
-	size_t _datasetSize;	// The number of values to scan
+	// Exclusive scan (Default) : each result combines the values before it, the first one is the identity.
+	// Inclusive scan : each result combines the values up to itself.
+	virtual void setInclusive(bool inclusive) { _inclusive = inclusive; }
+	bool isInclusive() { return _inclusive; }
+
+	// Out-of-place scan : the results are written to 'clBuffer_output' (At least the size of the data set)
+	// and the values are kept. Set 0 to scan in place again (Default).
+	virtual void setOutput(cl_mem clBuffer_output) { _clBuffer_output = clBuffer_output; }
+
+	// The buffer of the results : the output buffer, or the values when the scan is in place.
+	cl_mem getOutputBuffer() { return _clBuffer_output ? _clBuffer_output : _clBuffer_values; }
+
+	// The grand total (The reduction of all the values), written by the scan itself, without an extra kernel :
+	// to the value 'index' of 'clBuffer_total' (Ex: the argument buffer of the next kernel, or a mapped host buffer),
+	// or to an internal buffer when 'clBuffer_total' is 0. 'enable' false stops writing it (Default).
+	virtual void setTotal(bool enable, cl_mem clBuffer_total = 0, unsigned int index = 0);
+	cl_mem getTotalBuffer() { return _clBuffer_total; }
+
+	// Retreive the grand total of the last scan (One value).
+	void popTotal(void* total);
+
+	// Temporary storage, in 2 phases :
+	// 1 - getTempStorageBytes returns the exact scratch needed to scan up to 'datasetSize' elements.
+	// 2 - setTempStorage gives a caller-owned buffer for the scratch, at 'offset' (Aligned on CL_DEVICE_MEM_BASE_ADDR_ALIGN).
+	//     Set 0 to use the internal buffers again.
+	virtual size_t getTempStorageBytes(size_t datasetSize) { return 0; }
+	virtual void setTempStorage(cl_mem tempStorage, size_t offset = 0)
+	{
+		_tempStorage = tempStorage;
+		_tempStorageOffset = offset;
+	}
+
+	// Asynchronous versions : the commands wait for 'waitEvents' and 'event' receives the completion event
+	// (Can be null, else it must be released by the caller). An asynchronous popDatas doesn't block.
+	void scan(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+	{
+		beginAsync(numWaitEvents, waitEvents, event);
+		scan();
+		endAsync(event);
+	}
 
+	void pushDatas(void* values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+	{
+		beginAsync(numWaitEvents, waitEvents, event);
+		pushDatas(values, datasetSize);
+		endAsync(event);
+	}
+
+	// The wait-list is applied to the next enqueued command (Usually the scan).
+	void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents)
+	{
+		setWaitList(numWaitEvents, waitEvents);
+		pushCLDatas(clBuffer_values, datasetSize);
+	}
+
+	void popDatas(void* dataSet, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+	{
+		beginAsync(numWaitEvents, waitEvents, event);
+		popDatas(dataSet);
+		endAsync(event);
+	}
+
+	void popTotal(void* total, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+	{
+		beginAsync(numWaitEvents, waitEvents, event);
+		popTotal(total);
+		endAsync(event);
+	}
+
+protected:
 	void* _values;			// The associated data set to scan
+	clppOperator _operator;
+	clppValueType _valueType;
 	size_t _valueSize;		// The size of a value in bytes
+	clppTransform _transform;
+	size_t _inputSize;		// The size of an input in bytes : the value size without a transform
 
 	cl_mem _clBuffer_values;
+	cl_mem _clBuffer_output;	// 0 when the scan is in place
 	bool _is_clBuffersOwner;
+	bool _inclusive;
+
+	cl_mem _clBuffer_total;			// 0 when the total isn't written
+	cl_mem _clBuffer_ownedTotal;	// Used without a caller's buffer
+	unsigned int _totalIndex;
 
 	size_t _workgroupSize;
+
+	// False (And an error is printed) when the device can't handle the value type
+	bool checkValueType();
+
+	// False (And an error is printed) when a transform-scan has no output buffer : the results would overwrite the inputs
+	bool checkTransformOutput();
+
+	// False (And an error is printed) for a transform-scan : the results don't fit in the input array
+	bool checkPopToInputs();
+
+private:
+	void setup(clppContext* context);
 };
 
 #endif
\ No newline at end of file
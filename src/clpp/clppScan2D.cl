@@ -0,0 +1,103 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// Summed-area table (Integral image) : each value is the sum of the values above and on the left of it, itself included.
+//
+// Algorithm :
+// -----------
+// 1 - The rows are scanned by the batched scan (See clppBatchedScan.cl), inclusive.
+// 2 - The columns are scanned in blocks of COLUMN_TILE rows, so there is one work-item per column and per block :
+//     kernel__ColumnTotals sums the blocks, the totals of each column are scanned (Exclusive) by a batched scan,
+//     then kernel__ColumnScan scans each block from its carry. The accesses of the neighbour work-items are contiguous.
+//     (A single block needs no carry : the image is scanned by kernel__ColumnScan only)
+//
+// With a border, the table has a first row and a first column of 0 : (width + 1) x (height + 1) values.
+//
+// References :
+// ------------
+// Franklin C. Crow. Summed-area tables for texture mapping. SIGGRAPH 1984.
+//------------------------------------------------------------
+
+// The type of the values T, OPERATOR_APPLY and OPERATOR_IDENTITY are defined by the clppOperator (The sum)
+// COLUMN_TILE, the number of rows of a block, is defined by clppScan2D::compilePreprocess.
+
+//------------------------------------------------------------
+// kernel__ColumnTotals
+//
+// Purpose : The total of each block of each column (One work-item per column and per block).
+// The totals of a column are contiguous : 'totals' is a row of 'blocks' values per column.
+//------------------------------------------------------------
+
+__kernel
+void kernel__ColumnTotals(
+	__global const T* rows,
+	__global T* totals,
+	const uint width,
+	const uint height,
+	const uint rowsPitch,
+	const uint blocks)
+{
+	const uint x = get_global_id(0);
+	const uint block = get_global_id(1);
+	if (x >= width)
+		return;
+
+	const uint yStart = block * COLUMN_TILE;
+	const uint yEnd = min(yStart + COLUMN_TILE, height);
+
+	T sum = OPERATOR_IDENTITY;
+	for(uint y = yStart; y < yEnd; y++)
+		sum = OPERATOR_APPLY(sum, rows[(size_t)y * rowsPitch + x]);
+
+	totals[(size_t)x * blocks + block] = sum;
+}
+
+//------------------------------------------------------------
+// kernel__ColumnScan
+//
+// Purpose : Scan the blocks of the columns of the scanned rows to the table, from their carry (Can be null with a
+// single block). One work-item per column of the table and per block.
+//------------------------------------------------------------
+
+__kernel
+void kernel__ColumnScan(
+	__global const T* rows,
+	__global T* table,
+	__global const T* carries,
+	const uint width,
+	const uint height,
+	const uint rowsPitch,
+	const uint tablePitch,
+	const uint border,
+	const uint blocks)
+{
+	const uint column = get_global_id(0);
+	const uint block = get_global_id(1);
+	if (column >= width + border)
+		return;
+
+	const uint yStart = block * COLUMN_TILE;
+	const uint yEnd = min(yStart + COLUMN_TILE, height);
+	__global T* output = table + (size_t)border * tablePitch + column;
+
+	// The first row of the border
+	if (border && block == 0)
+		table[column] = OPERATOR_IDENTITY;
+
+	// The first column of the border
+	if (border && column == 0)
+	{
+		for(uint y = yStart; y < yEnd; y++)
+			output[(size_t)y * tablePitch] = OPERATOR_IDENTITY;
+		return;
+	}
+
+	const uint x = column - border;
+
+	T sum = carries ? carries[(size_t)x * blocks + block] : OPERATOR_IDENTITY;
+	for(uint y = yStart; y < yEnd; y++)
+	{
+		sum = OPERATOR_APPLY(sum, rows[(size_t)y * rowsPitch + x]);
+		output[(size_t)y * tablePitch] = sum;
+	}
+}
@@ -0,0 +1,288 @@
+#include "clpp/clppScan2D.h"
+#include "clpp/clppScan2D_CLKernel.h"
+
+// The rows of a block of the column scan
+#define COLUMN_TILE 32
+
+#pragma region Constructor
+
+clppScan2D::clppScan2D(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppProgram()
+{
+	_context = context;
+	_valueType = valueType;
+	_valueSize = getValueTypeSize(valueType);
+	_maxElements = maxElements;
+	_border = false;
+	_width = 0;
+	_height = 0;
+	_pitch = 0;
+	_clBuffer_image = 0;
+	_clBuffer_ownedImage = 0;
+	_clBuffer_rows = 0;
+	_clBuffer_table = 0;
+	_clBuffer_ownedTable = 0;
+	_ownedTableSize = 0;
+	_tablePitch = 0;
+	_isOwnedTable = true;
+	_kernel_ColumnTotals = 0;
+	_kernel_ColumnScan = 0;
+	_workgroupSize = 0;
+	_rowScan = 0;
+	_carryScan = 0;
+	_clBuffer_carries = 0;
+
+	if (_valueType == Value_Double && !_context->supportsDouble)
+	{
+		printf("Error: The device doesn't support the double precision (cl_khr_fp64)\n");
+		return;
+	}
+
+	if (!compile(context, clCode_clppScan2D))
+		return;
+
+	//---- Owned kernels : the arguments change with the image
+	_kernel_ColumnTotals = createKernel("kernel__ColumnTotals");
+	_kernel_ColumnScan = createKernel("kernel__ColumnScan");
+
+	size_t totalsWorkgroupSize;
+	clGetKernelWorkGroupInfo(_kernel_ColumnTotals, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &totalsWorkgroupSize, 0);
+	clGetKernelWorkGroupInfo(_kernel_ColumnScan, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
+	_workgroupSize = min(_workgroupSize, totalsWorkgroupSize);
+
+	//---- The rows : inclusive, to our own buffer
+	_rowScan = new clppBatchedScan(context, valueType, maxElements);
+	_rowScan->setInclusive(true);
+
+	_clBuffer_rows = allocateBuffer(_valueSize * maxElements);
+	_rowScan->setOutput(_clBuffer_rows);
+
+	//---- The carries of the column blocks : exclusive, in place. Only used with 2 blocks or more (height > COLUMN_TILE),
+	// so there are less than 2 * width * height / COLUMN_TILE carries.
+	unsigned int maxCarries = 2 * (maxElements / COLUMN_TILE) + 1;
+	_carryScan = new clppBatchedScan(context, valueType, maxCarries);
+	_clBuffer_carries = allocateBuffer(_valueSize * maxCarries);
+}
+
+clppScan2D::~clppScan2D()
+{
+	releaseBuffer(_clBuffer_ownedImage);
+	releaseBuffer(_clBuffer_rows);
+	releaseBuffer(_clBuffer_ownedTable);
+	releaseBuffer(_clBuffer_carries);
+
+	delete _rowScan;
+	delete _carryScan;
+}
+
+#pragma endregion
+
+#pragma region compilePreprocess
+
+string clppScan2D::compilePreprocess(string kernel)
+{
+	ostringstream lines;
+	lines << "#define COLUMN_TILE " << COLUMN_TILE << endl;
+
+	return clppProgram::compilePreprocess(clppOperator::sum(_valueType).getDefinitions() + lines.str() + kernel);
+}
+
+#pragma endregion
+
+#pragma region scan
+
+string clppScan2D::getName()
+{
+	return "Summed-area table";
+}
+
+void clppScan2D::setBorder(bool border)
+{
+	_border = border;
+	updateTable();
+}
+
+void clppScan2D::scan()
+{
+	cl_int clStatus;
+
+	if (_width == 0 || _height == 0)
+		return;
+
+	//---- 1 - The rows (The first command : it takes our wait-list)
+	_rowScan->pushCLDatas(_clBuffer_image, (size_t)(_height - 1) * _pitch + _width);
+	_rowScan->setLayout(_height, _width, _pitch);
+	if (_waitList.size() > 0)
+	{
+		_rowScan->scan((cl_uint)_waitList.size(), &_waitList[0], NULL);
+		waitListConsumed();
+	}
+	else
+		_rowScan->scan();
+
+	//---- 2 - The columns, in blocks of COLUMN_TILE rows, to the table
+	unsigned int border = _border ? 1 : 0;
+	unsigned int columns = _width + border;
+	unsigned int blocks = (_height + COLUMN_TILE - 1) / COLUMN_TILE;
+
+	// No more work-items than the columns in a work-group, the blocks are the 2nd dimension
+	size_t localWorkSize[2] = {_workgroupSize, 1};
+	while (localWorkSize[0] > 1 && localWorkSize[0] / 2 >= columns)
+		localWorkSize[0] /= 2;
+
+	//---- 2a - The carries of the blocks : the totals of the blocks, scanned per column
+	cl_mem carries = 0;
+	if (blocks > 1)
+	{
+		clStatus  = clSetKernelArg(_kernel_ColumnTotals, 0, sizeof(cl_mem), &_clBuffer_rows);
+		clStatus |= clSetKernelArg(_kernel_ColumnTotals, 1, sizeof(cl_mem), &_clBuffer_carries);
+		clStatus |= clSetKernelArg(_kernel_ColumnTotals, 2, sizeof(int), &_width);
+		clStatus |= clSetKernelArg(_kernel_ColumnTotals, 3, sizeof(int), &_height);
+		clStatus |= clSetKernelArg(_kernel_ColumnTotals, 4, sizeof(int), &_pitch);
+		clStatus |= clSetKernelArg(_kernel_ColumnTotals, 5, sizeof(int), &blocks);
+		checkCLStatus(clStatus);
+
+		size_t globalWorkSize[2] = {toMultipleOf(_width, localWorkSize[0]), blocks};
+		size_t bytes = _valueSize * ((size_t)_width * _height + (size_t)_width * blocks);
+		clStatus = enqueueKernel(_kernel_ColumnTotals, 2, globalWorkSize, localWorkSize, "Column totals", bytes);
+		checkCLStatus(clStatus);
+
+		_carryScan->pushCLDatas(_clBuffer_carries, (size_t)_width * blocks);
+		_carryScan->setLayout(_width, blocks, blocks);
+		_carryScan->scan();
+
+		carries = _clBuffer_carries;
+	}
+
+	//---- 2b - The blocks, from their carry
+	clStatus  = clSetKernelArg(_kernel_ColumnScan, 0, sizeof(cl_mem), &_clBuffer_rows);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 1, sizeof(cl_mem), &_clBuffer_table);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 2, sizeof(cl_mem), &carries);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 3, sizeof(int), &_width);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 4, sizeof(int), &_height);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 5, sizeof(int), &_pitch);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 6, sizeof(int), &_tablePitch);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 7, sizeof(int), &border);
+	clStatus |= clSetKernelArg(_kernel_ColumnScan, 8, sizeof(int), &blocks);
+	checkCLStatus(clStatus);
+
+	size_t globalWorkSize[2] = {toMultipleOf(columns, localWorkSize[0]), blocks};
+	size_t bytes = _valueSize * ((size_t)_width * _height + (size_t)columns * (_height + border) + (carries ? (size_t)_width * blocks : 0));
+	clStatus = enqueueKernel(_kernel_ColumnScan, 2, globalWorkSize, localWorkSize, "Column scan", bytes);
+	checkCLStatus(clStatus);
+}
+
+void clppScan2D::scan(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	scan();
+	endAsync(event);
+}
+
+#pragma endregion
+
+#pragma region pushDatas
+
+void clppScan2D::pushDatas(void* image, unsigned int width, unsigned int height, unsigned int pitch)
+{
+	cl_int clStatus;
+
+	if (!checkImage(width, height, pitch))
+		return;
+
+	//---- Allocated once, for maxElements
+	if (!_clBuffer_ownedImage)
+		_clBuffer_ownedImage = allocateBuffer(_valueSize * _maxElements);
+
+	pushCLDatas(_clBuffer_ownedImage, width, height, pitch);
+	if (_height == 0)
+		return;
+
+	//---- Copy on the device (The last row without its padding)
+	clStatus = enqueueWriteBuffer(_clBuffer_image, _valueSize * ((size_t)(_height - 1) * _pitch + _width), image);
+	checkCLStatus(clStatus);
+}
+
+void clppScan2D::pushCLDatas(cl_mem clBuffer_image, unsigned int width, unsigned int height, unsigned int pitch)
+{
+	if (!checkImage(width, height, pitch))
+		return;
+
+	_clBuffer_image = clBuffer_image;
+	_width = width;
+	_height = height;
+	_pitch = pitch;
+	_datasetSize = (size_t)width * height;
+
+	updateTable();
+}
+
+void clppScan2D::pushDatas(void* image, unsigned int width, unsigned int height, unsigned int pitch, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	pushDatas(image, width, height, pitch);
+	endAsync(event);
+}
+
+bool clppScan2D::checkImage(unsigned int width, unsigned int height, unsigned int pitch)
+{
+	if (pitch < width)
+	{
+		printf("Error: %s : the pitch (%u) is smaller than the width (%u)\n", getName().c_str(), pitch, width);
+		return false;
+	}
+
+	return checkDatasetSize((size_t)height * pitch, _maxElements);
+}
+
+#pragma endregion
+
+#pragma region Table
+
+void clppScan2D::setOutput(cl_mem clBuffer_table, unsigned int tablePitch)
+{
+	_isOwnedTable = (clBuffer_table == 0);
+	if (!_isOwnedTable)
+	{
+		_clBuffer_table = clBuffer_table;
+		_tablePitch = tablePitch;
+	}
+
+	updateTable();
+}
+
+// The internal table : its pitch is the width of the table, it grows with the images
+void clppScan2D::updateTable()
+{
+	if (!_isOwnedTable)
+		return;
+
+	_tablePitch = _width + (_border ? 1 : 0);
+	if (getTableSize() > _ownedTableSize)
+	{
+		releaseBuffer(_clBuffer_ownedTable);
+		_ownedTableSize = getTableSize();
+		_clBuffer_ownedTable = allocateBuffer(_valueSize * _ownedTableSize);
+	}
+
+	_clBuffer_table = _clBuffer_ownedTable;
+}
+
+#pragma endregion
+
+#pragma region popDatas
+
+void clppScan2D::popDatas(void* table)
+{
+	cl_int clStatus = enqueueReadBuffer(_clBuffer_table, _valueSize * getTableSize(), table);
+	checkCLStatus(clStatus);
+}
+
+void clppScan2D::popDatas(void* table, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	popDatas(table);
+	endAsync(event);
+}
+
+#pragma endregion
@@ -0,0 +1,85 @@
+#ifndef __CLPP_SCAN_2D_H__
+#define __CLPP_SCAN_2D_H__
+
+#include "clpp/clppProgram.h"
+#include "clpp/clppBatchedScan.h"
+
+// Summed-area table (2D inclusive scan) of a row-major image : int, uint or float (Or the other value types).
+// The rows are scanned by a batched scan, then the columns in blocks of rows : the carries of the blocks are
+// scanned by a second batched scan.
+class clppScan2D : public clppProgram
+{
+public:
+	// Create a new summed-area table.
+	// maxElements : the maximum size of the images, pitch included (pitch * height values).
+	clppScan2D(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	~clppScan2D();
+
+	// Returns the algorithm name
+	string getName();
+
+	string compilePreprocess(string kernel);
+
+	// Without border (Default) the table has the size of the image. With a border, the table has a first row and
+	// a first column of 0 : (width + 1) x (height + 1) values, the table(x + 1, y + 1) is the sum up to the image(x, y).
+	void setBorder(bool border);
+
+	// Start the scan
+	void scan();
+
+	// Send a Host image to the device : 'width' x 'height' values, a row starts 'pitch' values after the previous one.
+	void pushDatas(void* image, unsigned int width, unsigned int height, unsigned int pitch);
+
+	// Push an image that is already on the device side. (Data are not sended)
+	void pushCLDatas(cl_mem clBuffer_image, unsigned int width, unsigned int height, unsigned int pitch);
+
+	// Write the table to 'clBuffer_table', a row starts 'tablePitch' values after the previous one.
+	// Set 0 to use the internal buffer (Its pitch is the width of the table).
+	void setOutput(cl_mem clBuffer_table, unsigned int tablePitch);
+	cl_mem getOutputBuffer() { return _clBuffer_table; }
+
+	// Retreive the table, with its pitch.
+	void popDatas(void* table);
+
+	// Asynchronous versions : the commands wait for 'waitEvents' and 'event' receives the completion event
+	// (Can be null, else it must be released by the caller). An asynchronous popDatas doesn't block.
+	void scan(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void pushDatas(void* image, unsigned int width, unsigned int height, unsigned int pitch, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void popDatas(void* table, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+
+private:
+	clppValueType _valueType;
+	size_t _valueSize;
+	unsigned int _maxElements;
+
+	bool _border;
+	unsigned int _width;
+	unsigned int _height;
+	unsigned int _pitch;
+
+	cl_mem _clBuffer_image;
+	cl_mem _clBuffer_ownedImage;		// Used by pushDatas
+	cl_mem _clBuffer_rows;				// The scanned rows, with the pitch of the image
+
+	cl_mem _clBuffer_table;
+	cl_mem _clBuffer_ownedTable;		// Used without a caller's table
+	size_t _ownedTableSize;
+	unsigned int _tablePitch;
+	bool _isOwnedTable;
+
+	cl_kernel _kernel_ColumnTotals;		// The totals of the blocks of the columns
+	cl_kernel _kernel_ColumnScan;
+	size_t _workgroupSize;
+
+	clppBatchedScan* _rowScan;
+	clppBatchedScan* _carryScan;		// The totals of the blocks, one row per column, to their carries
+	cl_mem _clBuffer_carries;
+
+	size_t getTableSize() { return (size_t)(_height + (_border ? 1 : 0)) * _tablePitch; }
+	void updateTable();
+
+	// Returns false, with an error, when the image doesn't fit in the buffers of the plan
+	bool checkImage(unsigned int width, unsigned int height, unsigned int pitch);
+};
+
+#endif
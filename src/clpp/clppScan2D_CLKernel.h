@@ -0,0 +1,60 @@
+
+char clCode_clppScan2D[]=
+"__kernel\n"
+"void kernel__ColumnTotals(\n"
+"	__global const T* rows,\n"
+"	__global T* totals,\n"
+"	const uint width,\n"
+"	const uint height,\n"
+"	const uint rowsPitch,\n"
+"	const uint blocks)\n"
+"{\n"
+"	const uint x = get_global_id(0);\n"
+"	const uint block = get_global_id(1);\n"
+"	if (x >= width)\n"
+"		return;\n"
+"	const uint yStart = block * COLUMN_TILE;\n"
+"	const uint yEnd = min(yStart + COLUMN_TILE, height);\n"
+"	T sum = OPERATOR_IDENTITY;\n"
+"	for(uint y = yStart; y < yEnd; y++)\n"
+"		sum = OPERATOR_APPLY(sum, rows[(size_t)y * rowsPitch + x]);\n"
+"	totals[(size_t)x * blocks + block] = sum;\n"
+"}\n"
+"__kernel\n"
+"void kernel__ColumnScan(\n"
+"	__global const T* rows,\n"
+"	__global T* table,\n"
+"	__global const T* carries,\n"
+"	const uint width,\n"
+"	const uint height,\n"
+"	const uint rowsPitch,\n"
+"	const uint tablePitch,\n"
+"	const uint border,\n"
+"	const uint blocks)\n"
+"{\n"
+"	const uint column = get_global_id(0);\n"
+"	const uint block = get_global_id(1);\n"
+"	if (column >= width + border)\n"
+"		return;\n"
+"	const uint yStart = block * COLUMN_TILE;\n"
+"	const uint yEnd = min(yStart + COLUMN_TILE, height);\n"
+"	__global T* output = table + (size_t)border * tablePitch + column;\n"
+"	// The first row of the border\n"
+"	if (border && block == 0)\n"
+"		table[column] = OPERATOR_IDENTITY;\n"
+"	// The first column of the border\n"
+"	if (border && column == 0)\n"
+"	{\n"
+"		for(uint y = yStart; y < yEnd; y++)\n"
+"			output[(size_t)y * tablePitch] = OPERATOR_IDENTITY;\n"
+"		return;\n"
+"	}\n"
+"	const uint x = column - border;\n"
+"	T sum = carries ? carries[(size_t)x * blocks + block] : OPERATOR_IDENTITY;\n"
+"	for(uint y = yStart; y < yEnd; y++)\n"
+"	{\n"
+"		sum = OPERATOR_APPLY(sum, rows[(size_t)y * rowsPitch + x]);\n"
+"		output[(size_t)y * tablePitch] = sum;\n"
+"	}\n"
+"}\n"
+;
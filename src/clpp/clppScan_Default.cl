@@ -36,9 +36,17 @@
 //------------------------------------------------------------
 
 #pragma OPENCL EXTENSION cl_amd_printf : enable
-#define T int
+
+// The type of the values T (And T2, its vector of 2), OPERATOR_APPLY and OPERATOR_IDENTITY are defined by the clppOperator of the scan.
+// The vector loads are only used with the predefined types (SUPPORT_VECTOR_LOADS).
 //#define SUPPORT_AVOID_BANK_CONFLICT
 
+// The transform of the inputs (INPUT_T and TRANSFORM) is defined by the clppTransform of the scan, the identity without one
+#ifndef TRANSFORM
+#define INPUT_T T
+#define TRANSFORM(X) (X)
+#endif
+
 //------------------------------------------------------------
 // kernel__ExclusivePrefixScanSmall
 //
@@ -70,7 +78,7 @@ void kernel__ExclusivePrefixScanSmall(
 			int ai = offset*(2*tid + 1) - 1;
 			int bi = offset*(2*tid + 2) - 1;
 			
-			block[bi] += block[ai];
+			block[bi] = OPERATOR_APPLY(block[ai], block[bi]);
 		}
 		offset *= 2;
 	}
@@ -79,7 +87,7 @@ void kernel__ExclusivePrefixScanSmall(
 
     // Clear the last element
 	if(tid == 0)
-		block[length - 1] = 0;
+		block[length - 1] = OPERATOR_IDENTITY;
 
     // traverse down the tree building the scan in the place
 	for(int d = 1; d < length ; d *= 2)
@@ -92,9 +100,9 @@ void kernel__ExclusivePrefixScanSmall(
 			int ai = offset*(2*tid + 1) - 1;
 			int bi = offset*(2*tid + 2) - 1;
 			
-			float t = block[ai];
+			T t = block[ai];
 			block[ai] = block[bi];
-			block[bi] += t;
+			block[bi] = OPERATOR_APPLY(block[bi], t);
 		}
 	}
 	
@@ -108,7 +116,10 @@ void kernel__ExclusivePrefixScanSmall(
 //------------------------------------------------------------
 // kernel__ExclusivePrefixScan
 //
-// Purpose : do a scan on a chunck of data.
+// Purpose : do a scan on a chunck of data, exclusive or inclusive, to 'output' (Can be the data set).
+// The block sums are always the inclusive totals of the blocks.
+// 'total' (Can be null) receives the sum of the single block of the last level : the grand total.
+// 'input' (Can be null, first level only) : the values are TRANSFORM(input), the data set isn't read.
 //------------------------------------------------------------
 
 // Define this to more rigorously avoid bank conflicts, even at the lower (root) levels of the tree.
@@ -132,11 +143,16 @@ void kernel__ExclusivePrefixScanSmall(
 __kernel
 void kernel__ExclusivePrefixScan(
 	__global T* dataSet,
+	__global T* output,
 	
 	__local T* localBuffer,
 	
 	__global T* blockSums,
-	const uint blockSumsSize
+	const uint blockSumsSize,
+	const uint inclusive,
+	__global T* total,
+	const uint totalIndex,
+	__global const INPUT_T* input
 	)
 {
 	const uint gid = get_global_id(0);
@@ -163,11 +179,40 @@ void kernel__ExclusivePrefixScan(
 	uint gbi = gid + lwz;
 	uint bankOffsetA = CONFLICT_FREE_OFFSET(ai); 
 	uint bankOffsetB = CONFLICT_FREE_OFFSET(bi);
-	localBuffer[ai + bankOffsetA] = (gai < blockSumsSize) ? dataSet[gai] : 0; 
-	localBuffer[bi + bankOffsetB] = (gbi < blockSumsSize) ? dataSet[gbi] : 0;
+	// The values are kept for the inclusive scan
+	T value0 = (gai < blockSumsSize) ? (input ? TRANSFORM(input[gai]) : dataSet[gai]) : OPERATOR_IDENTITY;
+	T value1 = (gbi < blockSumsSize) ? (input ? TRANSFORM(input[gbi]) : dataSet[gbi]) : OPERATOR_IDENTITY;
+	localBuffer[ai + bankOffsetA] = value0; 
+	localBuffer[bi + bankOffsetB] = value1;
 #else
-	localBuffer[tid2_0] = (gid2_0 < blockSumsSize) ? dataSet[gid2_0] : 0;
-	localBuffer[tid2_1] = (gid2_1 < blockSumsSize) ? dataSet[gid2_1] : 0;
+	// The values are kept for the inclusive scan
+	T value0 = OPERATOR_IDENTITY;
+	T value1 = OPERATOR_IDENTITY;
+	if (input)
+	{
+		// Transform-scan : the inputs are transformed as they are loaded
+		if (gid2_0 < blockSumsSize)
+			value0 = TRANSFORM(input[gid2_0]);
+		if (gid2_1 < blockSumsSize)
+			value1 = TRANSFORM(input[gid2_1]);
+	}
+	else if (gid2_1 < blockSumsSize)
+	{
+#ifdef SUPPORT_VECTOR_LOADS
+		// The 2 values of the work-item are loaded at once
+		T2 values = vload2(gid, dataSet);
+		value0 = values.x;
+		value1 = values.y;
+#else
+		value0 = dataSet[gid2_0];
+		value1 = dataSet[gid2_1];
+#endif
+	}
+	else if (gid2_0 < blockSumsSize)
+		value0 = dataSet[gid2_0];
+
+	localBuffer[tid2_0] = value0;
+	localBuffer[tid2_1] = value1;
 #endif
 	
     // bottom-up
@@ -190,7 +235,7 @@ void kernel__ExclusivePrefixScan(
             const uint bi = mad24(offset, (tid2_1+1), -1);	// offset*(tid2_1+1)-1;
 #endif
 
-            localBuffer[bi] += localBuffer[ai];
+            localBuffer[bi] = OPERATOR_APPLY(localBuffer[ai], localBuffer[bi]);
         }
         offset <<= 1;
     }
@@ -213,13 +258,17 @@ void kernel__ExclusivePrefixScan(
 		uint index = localBufferSize-1;
 		index += CONFLICT_FREE_OFFSET(index);
 		blockSums[bid] = localBuffer[index];
-		localBuffer[index] = 0;
+		if (total)
+			total[totalIndex] = localBuffer[index];
+		localBuffer[index] = OPERATOR_IDENTITY;
 #else
 		// We store the biggest value (the last) to the sum-block for later use.
         blockSums[bid] = localBuffer[localBufferSize-1];		
+		if (total)
+			total[totalIndex] = localBuffer[localBufferSize-1];
 		//barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);		
 		// Clear the last element
-        localBuffer[localBufferSize - 1] = 0;
+        localBuffer[localBufferSize - 1] = OPERATOR_IDENTITY;
 #endif
     }
 
@@ -246,7 +295,7 @@ void kernel__ExclusivePrefixScan(
 
             T tmp = localBuffer[ai];
             localBuffer[ai] = localBuffer[bi];
-            localBuffer[bi] += tmp;
+            localBuffer[bi] = OPERATOR_APPLY(localBuffer[bi], tmp);
         }
     }
 
@@ -255,13 +304,36 @@ void kernel__ExclusivePrefixScan(
     // Copy back from the local buffer to the output array
 	
 #ifdef SUPPORT_AVOID_BANK_CONFLICT
-	dataSet[gai] = (gai < blockSumsSize) * localBuffer[ai + bankOffsetA];		
-	dataSet[gbi] = (gbi < blockSumsSize) * localBuffer[bi + bankOffsetB];		
+	T result0 = localBuffer[ai + bankOffsetA];
+	T result1 = localBuffer[bi + bankOffsetB];
+#else
+	T result0 = localBuffer[tid2_0];
+	T result1 = localBuffer[tid2_1];
+#endif
+
+	if (inclusive)
+	{
+		result0 = OPERATOR_APPLY(result0, value0);
+		result1 = OPERATOR_APPLY(result1, value1);
+	}
+
+#ifdef SUPPORT_AVOID_BANK_CONFLICT
+	if (gai < blockSumsSize)
+		output[gai] = result0;
+	if (gbi < blockSumsSize)
+		output[gbi] = result1;
 #else
-	if (gid2_0 < blockSumsSize)
-		dataSet[gid2_0] = localBuffer[tid2_0];
 	if (gid2_1 < blockSumsSize)
-		dataSet[gid2_1] = localBuffer[tid2_1];
+	{
+#ifdef SUPPORT_VECTOR_LOADS
+		vstore2((T2)(result0, result1), gid, output);
+#else
+		output[gid2_0] = result0;
+		output[gid2_1] = result1;
+#endif
+	}
+	else if (gid2_0 < blockSumsSize)
+		output[gid2_0] = result0;
 #endif
 
 }
@@ -304,13 +376,24 @@ void kernel__UniformAdd(
 #ifdef SUPPORT_AVOID_BANK_CONFLICT
 	unsigned int address = blockId * get_local_size(0) * 2 + get_local_id(0); 
 	
-	output[address] += localBuffer[0];
-    output[address + get_local_size(0)] += (get_local_id(0) + get_local_size(0) < outputSize) * localBuffer[0];
+	output[address] = OPERATOR_APPLY(localBuffer[0], output[address]);
+	if (get_local_id(0) + get_local_size(0) < outputSize)
+		output[address + get_local_size(0)] = OPERATOR_APPLY(localBuffer[0], output[address + get_local_size(0)]);
+#else
+	if (gid + 1 < outputSize)
+	{
+		// The block sum is the left operand : it combines the values before the block
+#ifdef SUPPORT_VECTOR_LOADS
+		T2 values = vload2(get_global_id(0), output);
+		values.x = OPERATOR_APPLY(localBuffer[0], values.x);
+		values.y = OPERATOR_APPLY(localBuffer[0], values.y);
+		vstore2(values, get_global_id(0), output);
 #else
-	if (gid < outputSize)
-		output[gid] += localBuffer[0];
-	gid++;
-	if (gid < outputSize)
-		output[gid] += localBuffer[0];
+		output[gid] = OPERATOR_APPLY(localBuffer[0], output[gid]);
+		output[gid + 1] = OPERATOR_APPLY(localBuffer[0], output[gid + 1]);
+#endif
+	}
+	else if (gid < outputSize)
+		output[gid] = OPERATOR_APPLY(localBuffer[0], output[gid]);
 #endif
 }
\ No newline at end of file
@@ -9,45 +9,95 @@
 
 clppScan_Default::clppScan_Default(clppContext* context, size_t valueSize, unsigned int maxElements) :
 	clppScan(context, valueSize, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppScan_Default::clppScan_Default(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppScan(context, valueType, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppScan_Default::clppScan_Default(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	clppScan(context, op, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppScan_Default::clppScan_Default(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements) :
+	clppScan(context, op, transform, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+void clppScan_Default::createPlan(unsigned int maxElements)
 {
 	_clBuffer_values = 0;
+	_clBuffer_ownedValues = 0;
 	_clBuffer_BlockSums = 0;
+	_blockSumsSizes = 0;
+	_blockSumsCount = 0;
+	_blockSumsElements = 0;
+	_maxElements = maxElements;
+	_kernels_Scan = 0;
+	_kernels_UniformAdd = 0;
+	_globalWorkSizes = 0;
+	_isBound = false;
+
+	if (!checkValueType())
+		return;
 
-	if (!compile(context, clCode_clppScan_Default))
+	if (!compile(_context, clCode_clppScan_Default))
 		return;
 
 	//if (!compile(context, string("clppScan_Default.cl")))
 	//	return;
 
-	//---- Prepare all the kernels
-	cl_int clStatus;
-
-	_kernel_Scan = clCreateKernel(_clProgram, "kernel__ExclusivePrefixScan", &clStatus);
-	checkCLStatus(clStatus);
-
-	//_kernel_ScanSmall = clCreateKernel(_clProgram, "kernel__ExclusivePrefixScanSmall", &clStatus);
-	//checkCLStatus(clStatus);
-
-	_kernel_UniformAdd = clCreateKernel(_clProgram, "kernel__UniformAdd", &clStatus);
-	checkCLStatus(clStatus);
-
 	//---- Get the workgroup size
-	clGetKernelWorkGroupInfo(_kernel_Scan, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
+	clGetKernelWorkGroupInfo(getKernel("kernel__ExclusivePrefixScan"), _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
 	//_workgroupSize = 128;
 	//_workgroupSize = 256;
 	//_workgroupSize = 512;
 	//clGetKernelWorkGroupInfo(_kernel_Scan, _context->clDevice, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &_workgroupSize, 0);
 
+	//---- The plan : all the levels for maxElements
+	_maxPass = computeLevels(maxElements, 0);
+	_clBuffer_BlockSums = new cl_mem[_maxPass];
+	_blockSumsSizes = new unsigned int[_maxPass + 1];
+	_globalWorkSizes = new size_t[_maxPass];
+
+	// One kernel per level, the arguments are bound once by 'bindLevels'
+	_kernels_Scan = new cl_kernel[_maxPass];
+	_kernels_UniformAdd = new cl_kernel[_maxPass];
+	for(unsigned int i = 0; i < _maxPass; i++)
+	{
+		_kernels_Scan[i] = createKernel("kernel__ExclusivePrefixScan");
+		_kernels_UniformAdd[i] = createKernel("kernel__UniformAdd");
+
+		// The profiler stages
+		ostringstream level;
+		level << i;
+		_stageNames.push_back("Scan level " + level.str());
+		_stageNames.push_back("Uniform add " + level.str());
+	}
+
 	//---- Prepare all the buffers
 	allocateBlockSums(maxElements);
+
+	_clBuffer_ownedValues = allocateBuffer(_inputSize * maxElements);
 }
 
 clppScan_Default::~clppScan_Default()
 {
-	if (_is_clBuffersOwner && _clBuffer_values)
-		clReleaseMemObject(_clBuffer_values);
+	releaseBuffer(_clBuffer_ownedValues);
 
 	freeBlockSums();
+	delete [] _clBuffer_BlockSums;
+	delete [] _blockSumsSizes;
+	delete [] _globalWorkSizes;
+	delete [] _kernels_Scan;
+	delete [] _kernels_UniformAdd;
 }
 
 #pragma endregion
@@ -58,45 +108,80 @@ void clppScan_Default::scan()
 {
 	cl_int clStatus;
 
-	clStatus  = clSetKernelArg(_kernel_Scan, 1, _workgroupSize * _valueSize, 0);
+	//---- Nothing to scan (And no empty launch)
+	if (_datasetSize == 0)
+		return;
+
+	// The inputs of a transform-scan are kept
+	if (!checkTransformOutput())
+		return;
+
+	if (!_isBound)
+		bindLevels();
+
+	size_t localWorkSize = {_workgroupSize / 2};
 
-	checkCLStatus(clStatus);
-	
 	//---- Apply the scan to each level
-	cl_mem clValues = _clBuffer_values;
+	// Traffic of a level : its values (The inputs of the first level) are read and written once, plus one block sum per workgroup
 	for(unsigned int i = 0; i < _pass; i++)
 	{
-		size_t globalWorkSize = {toMultipleOf(_blockSumsSizes[i] / 2, _workgroupSize / 2)};
-		size_t localWorkSize = {_workgroupSize / 2};
-
-		clStatus = clSetKernelArg(_kernel_Scan, 0, sizeof(cl_mem), &clValues);
-		clStatus |= clSetKernelArg(_kernel_Scan, 2, sizeof(cl_mem), &_clBuffer_BlockSums[i]);
-		clStatus |= clSetKernelArg(_kernel_Scan, 3, sizeof(int), &_blockSumsSizes[i]);
-
-		clStatus |= clEnqueueNDRangeKernel(_context->clQueue, _kernel_Scan, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+		size_t readSize = (i == 0) ? _inputSize : _valueSize;
+		size_t bytes = (readSize + _valueSize) * _blockSumsSizes[i] + _valueSize * ((_blockSumsSizes[i] + _workgroupSize - 1) / _workgroupSize);
+		clStatus = enqueueKernel(_kernels_Scan[i], 1, &_globalWorkSizes[i], &localWorkSize, _stageNames[2*i].c_str(), bytes);
 		checkCLStatus(clStatus);
-
-		clValues = _clBuffer_BlockSums[i];
-    }
+	}
 
 	//---- Uniform addition
 	for(int i = _pass - 2; i >= 0; i--)
 	{
-		size_t globalWorkSize = {toMultipleOf(_blockSumsSizes[i] / 2, _workgroupSize / 2)};
-		size_t localWorkSize = {_workgroupSize / 2};
-
-        cl_mem dest = (i > 0) ? _clBuffer_BlockSums[i-1] : _clBuffer_values;
-
-		clStatus = clSetKernelArg(_kernel_UniformAdd, 0, sizeof(cl_mem), &dest);
-		checkCLStatus(clStatus);
-		clStatus = clSetKernelArg(_kernel_UniformAdd, 1, sizeof(cl_mem), &_clBuffer_BlockSums[i]);
-		checkCLStatus(clStatus);
-		clStatus = clSetKernelArg(_kernel_UniformAdd, 2, sizeof(int), &_blockSumsSizes[i]);
+		size_t bytes = _valueSize * (2 * _blockSumsSizes[i] + (_blockSumsSizes[i] + _workgroupSize - 1) / _workgroupSize);
+		clStatus = enqueueKernel(_kernels_UniformAdd[i], 1, &_globalWorkSizes[i], &localWorkSize, _stageNames[2*i+1].c_str(), bytes);
 		checkCLStatus(clStatus);
+	}
+}
 
-		clStatus = clEnqueueNDRangeKernel(_context->clQueue, _kernel_UniformAdd, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
-		checkCLStatus(clStatus);
-    }
+// Bind the arguments of the levels : only when the data set size or the buffers have changed.
+void clppScan_Default::bindLevels()
+{
+	cl_int clStatus = CL_SUCCESS;
+
+	// The first level reads the values and writes the output, the block sums are scanned in place (Always exclusive)
+	// With a transform, the first level reads the inputs instead of the values
+	cl_mem clInput = _transform.isEnabled() ? _clBuffer_values : 0;
+	cl_mem clValues = clInput ? 0 : _clBuffer_values;
+	cl_mem clOutput = getOutputBuffer();
+	unsigned int inclusive = _inclusive ? 1 : 0;
+	cl_mem clNoTotal = 0;
+	for(unsigned int i = 0; i < _pass; i++)
+	{
+		// Each work-item handles 2 values
+		_globalWorkSizes[i] = toMultipleOf((_blockSumsSizes[i] + 1) / 2, _workgroupSize / 2);
+
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 0, sizeof(cl_mem), &clValues);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 1, sizeof(cl_mem), &clOutput);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 2, _workgroupSize * _valueSize, 0);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 3, sizeof(cl_mem), &_clBuffer_BlockSums[i]);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 4, sizeof(int), &_blockSumsSizes[i]);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 5, sizeof(int), &inclusive);
+
+		// The last level has a single block : its sum is the grand total
+		bool isLast = (i == _pass - 1);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 6, sizeof(cl_mem), isLast ? &_clBuffer_total : &clNoTotal);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 7, sizeof(int), &_totalIndex);
+		clStatus |= clSetKernelArg(_kernels_Scan[i], 8, sizeof(cl_mem), &clInput);
+
+		// The block sums of the level 'i' are added to the results of the level 'i'
+		clStatus |= clSetKernelArg(_kernels_UniformAdd[i], 0, sizeof(cl_mem), &clOutput);
+		clStatus |= clSetKernelArg(_kernels_UniformAdd[i], 1, sizeof(cl_mem), &_clBuffer_BlockSums[i]);
+		clStatus |= clSetKernelArg(_kernels_UniformAdd[i], 2, sizeof(int), &_blockSumsSizes[i]);
+
+		clValues = clOutput = _clBuffer_BlockSums[i];
+		clInput = 0;
+		inclusive = 0;
+	}
+	checkCLStatus(clStatus);
+
+	_isBound = true;
 }
 
 #pragma endregion
@@ -107,82 +192,47 @@ void clppScan_Default::pushDatas(void* values, size_t datasetSize)
 {
 	cl_int clStatus;
 
-	//---- Store some values
-	_values = values;
-	bool reallocate = datasetSize > _datasetSize || !_is_clBuffersOwner;
-	bool recompute =  datasetSize != _datasetSize;
-	_datasetSize = datasetSize;
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
 
-	//---- Compute the size of the different block we can use for '_datasetSize' (can be < maxElements)
-	// Compute the number of levels requested to do the scan
-	if (recompute)
-	{
-		_pass = 0;
-		unsigned int n = _datasetSize;
-		do
-		{
-			n = (n + _workgroupSize - 1) / _workgroupSize; // round up
-			_pass++;
-		}
-		while(n > 1);
-
-		// Compute the block-sum sizes
-		n = _datasetSize;
-		for(unsigned int i = 0; i < _pass; i++)
-		{
-			_blockSumsSizes[i] = n;
-			n = (n + _workgroupSize - 1) / _workgroupSize; // round up
-		}
-		_blockSumsSizes[_pass] = n;
-	}
+	//---- Use our own buffer (Allocated by the plan)
+	_values = values;
+	setDataset(_clBuffer_ownedValues, datasetSize);
+	_is_clBuffersOwner = true;
 
 	//---- Copy on the device
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_values)
-			clReleaseMemObject(_clBuffer_values);
-
-		_clBuffer_values  = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _valueSize * _datasetSize, _values, &clStatus);
-		_is_clBuffersOwner = true;
-		checkCLStatus(clStatus);
-	}
-	else
-		// Just resend
-		clEnqueueWriteBuffer(_context->clQueue, _clBuffer_values, CL_FALSE, 0, _valueSize * _datasetSize, _values, 0, 0, 0);
+	clStatus = enqueueWriteBuffer(_clBuffer_values, _inputSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
 }
 
 void clppScan_Default::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
 {
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
 	_values = 0;
-	_clBuffer_values = clBuffer_values;
-	bool recompute =  datasetSize != _datasetSize;
-	_datasetSize = datasetSize;
+	setDataset(clBuffer_values, datasetSize);
+	_is_clBuffersOwner = false;
+}
 
+void clppScan_Default::setDataset(cl_mem clBuffer_values, size_t datasetSize)
+{
 	//---- Compute the size of the different block we can use for '_datasetSize' (can be < maxElements)
-	// Compute the number of levels requested to do the scan
-	if (recompute)
+	if (datasetSize != _datasetSize)
 	{
-		_pass = 0;
-		unsigned int n = _datasetSize;
-		do
-		{
-			n = (n + _workgroupSize - 1) / _workgroupSize; // round up
-			_pass++;
-		}
-		while(n > 1);
-
-		// Compute the block-sum sizes
-		n = _datasetSize;
-		for(unsigned int i = 0; i < _pass; i++)
-		{
-			_blockSumsSizes[i] = n;
-			n = (n + _workgroupSize - 1) / _workgroupSize; // round up
-		}
-		_blockSumsSizes[_pass] = n;
+		_pass = computeLevels(datasetSize, _blockSumsSizes);
+		_isBound = false;
 	}
 
-	_is_clBuffersOwner = false;
+	if (clBuffer_values != _clBuffer_values)
+		_isBound = false;
+
+	_clBuffer_values = clBuffer_values;
+	_datasetSize = datasetSize;
+
+	//---- The temporary storage is sized for the data set
+	if (_datasetSize > _blockSumsElements)
+		allocateBlockSums(_datasetSize);
 }
 
 #pragma endregion
@@ -191,67 +241,121 @@ void clppScan_Default::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
 
 void clppScan_Default::popDatas()
 {
-	cl_int clStatus = clEnqueueReadBuffer(_context->clQueue, _clBuffer_values, CL_TRUE, 0, _valueSize * _datasetSize, _values, 0, NULL, NULL);
+	if (!checkPopToInputs())
+		return;
+
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, _values);
 	checkCLStatus(clStatus);
 }
 
 void clppScan_Default::popDatas(void* dataSet)
 {
-	cl_int clStatus = clEnqueueReadBuffer(_context->clQueue, _clBuffer_values, CL_TRUE, 0, _valueSize * _datasetSize, dataSet, 0, NULL, NULL);
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, dataSet);
 	checkCLStatus(clStatus);
 }
 
 #pragma endregion
 
+#pragma region Inclusive, out-of-place and total
+
+void clppScan_Default::setInclusive(bool inclusive)
+{
+	clppScan::setInclusive(inclusive);
+	_isBound = false;
+}
+
+void clppScan_Default::setOutput(cl_mem clBuffer_output)
+{
+	clppScan::setOutput(clBuffer_output);
+	_isBound = false;
+}
+
+void clppScan_Default::setTotal(bool enable, cl_mem clBuffer_total, unsigned int index)
+{
+	clppScan::setTotal(enable, clBuffer_total, index);
+	_isBound = false;
+}
+
+#pragma endregion
+
 #pragma region allocateBlockSums
 
-void clppScan_Default::allocateBlockSums(unsigned int maxElements)
+unsigned int clppScan_Default::computeLevels(unsigned int datasetSize, unsigned int* blockSumsSizes)
 {
-	// Compute the number of buffers we need for the scan
-	cl_int clStatus;
-	_pass = 0;
-	unsigned int n = maxElements;
+	// Compute the number of levels requested to do the scan, and the block-sum sizes
+	unsigned int pass = 0;
+	unsigned int n = datasetSize;
 	do
 	{
+		if (blockSumsSizes)
+			blockSumsSizes[pass] = n;
 		n = (n + _workgroupSize - 1) / _workgroupSize; // round up
-		_pass++;
+		pass++;
 	}
 	while(n > 1);
 
-	// Allocate the arrays
-	_clBuffer_BlockSums = new cl_mem[_pass];
-	_blockSumsSizes = new unsigned int[_pass + 1];
+	if (blockSumsSizes)
+		blockSumsSizes[pass] = n;
 
-	// Create the cl-buffers
-	n = maxElements;
-	for(unsigned int i = 0; i < _pass; i++)
-	{
-		_blockSumsSizes[i] = n;
+	return pass;
+}
 
-		_clBuffer_BlockSums[i] = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, sizeof(int) * n, NULL, &clStatus);
-		checkCLStatus(clStatus);
+void clppScan_Default::allocateBlockSums(unsigned int datasetSize)
+{
+	freeBlockSums();
 
-		n = (n + _workgroupSize - 1) / _workgroupSize; // round up
-	}
-	_blockSumsSizes[_pass] = n;
+	// The level 'i' stores its block sums in the buffer 'i'
+	vector<unsigned int> sizes(computeLevels(datasetSize, 0) + 1);
+	_blockSumsCount = computeLevels(datasetSize, &sizes[0]);
 
-	checkCLStatus(clStatus);
+	// Create the cl-buffers
+	size_t scratchOffset = 0;
+	for(unsigned int i = 0; i < _blockSumsCount; i++)
+		_clBuffer_BlockSums[i] = allocateScratch(_valueSize * sizes[i + 1], scratchOffset);
+
+	_blockSumsElements = datasetSize;
+	_isBound = false;
 }
 
 void clppScan_Default::freeBlockSums()
 {
-	if (!_clBuffer_BlockSums)
-		return;
+	for(unsigned int i = 0; i < _blockSumsCount; i++)
+		releaseScratch(_clBuffer_BlockSums[i]);
 
-    cl_int clStatus;
-    
-	for(unsigned int i = 0; i < _pass; i++)
-		clStatus = clReleaseMemObject(_clBuffer_BlockSums[i]);
+	_blockSumsCount = 0;
+	_blockSumsElements = 0;
+}
 
-	delete [] _clBuffer_BlockSums;
-	delete [] _blockSumsSizes;
-	_clBuffer_BlockSums = 0;
-	_blockSumsSizes = 0;
+#pragma endregion
+
+#pragma region Temporary storage
+
+size_t clppScan_Default::getTempStorageBytes(size_t datasetSize)
+{
+	vector<unsigned int> sizes(computeLevels(datasetSize, 0) + 1);
+	unsigned int pass = computeLevels(datasetSize, &sizes[0]);
+
+	size_t bytes = 0;
+	for(unsigned int i = 0; i < pass; i++)
+		bytes += getScratchBytes(_valueSize * sizes[i + 1]);
+
+	return bytes;
+}
+
+void clppScan_Default::setTempStorage(cl_mem tempStorage, size_t offset)
+{
+	clppScan::setTempStorage(tempStorage, offset);
+
+	// Without temporary storage, the internal buffers are sized for maxElements
+	if (_tempStorage)
+	{
+		if (_datasetSize > 0)
+			allocateBlockSums(_datasetSize);
+		else
+			freeBlockSums();
+	}
+	else
+		allocateBlockSums(_maxElements);
 }
 
 #pragma endregion
\ No newline at end of file
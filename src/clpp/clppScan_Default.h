@@ -7,6 +7,9 @@ class clppScan_Default : public clppScan
 {
 public:
 	clppScan_Default(clppContext* context, size_t valueSize, unsigned int maxElements);
+	clppScan_Default(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppScan_Default(clppContext* context, const clppOperator& op, unsigned int maxElements);
+	clppScan_Default(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements);
 	~clppScan_Default();
 
 	string getName() { return "Prefix sum (exclusive)"; }
@@ -19,20 +22,44 @@ public:
 	void popDatas();
 	void popDatas(void* dataSet);
 
+	void setInclusive(bool inclusive);
+	void setOutput(cl_mem clBuffer_output);
+	void setTotal(bool enable, cl_mem clBuffer_total = 0, unsigned int index = 0);
+
+	size_t getTempStorageBytes(size_t datasetSize);
+	void setTempStorage(cl_mem tempStorage, size_t offset = 0);
+
+	// Asynchronous versions (Defined by clppScan)
+	using clppScan::scan;
+	using clppScan::pushDatas;
+	using clppScan::pushCLDatas;
+	using clppScan::popDatas;
+
 private:
-	cl_kernel _kernel_Scan;
-	cl_kernel _kernel_ScanSmall;
-	cl_kernel _kernel_UniformAdd;
+	cl_kernel* _kernels_Scan;			// One kernel per level, with its arguments bound
+	cl_kernel* _kernels_UniformAdd;
+	size_t* _globalWorkSizes;			// The launch geometry of each level
+	vector<string> _stageNames;			// The profiler stages : "Scan level i" and "Uniform add i"
+	bool _isBound;						// The levels' arguments are up to date
 
-	cl_mem _clBuffer_Temp;
+	cl_mem _clBuffer_ownedValues;		// Used by pushDatas
 
-	unsigned int* _temp;
+	unsigned int _maxElements;
+	unsigned int _maxPass;				// The number of levels for maxElements
 
-	int _pass;
-	cl_mem* _clBuffer_BlockSums;
+	int _pass;							// The number of levels for the current data set
 	unsigned int* _blockSumsSizes;
 
-	void allocateBlockSums(unsigned int maxElements);
+	cl_mem* _clBuffer_BlockSums;
+	unsigned int _blockSumsCount;		// The allocated block-sum buffers
+	unsigned int _blockSumsElements;	// The number of elements they can scan
+
+	void createPlan(unsigned int maxElements);
+	void setDataset(cl_mem clBuffer_values, size_t datasetSize);
+	void bindLevels();
+
+	unsigned int computeLevels(unsigned int datasetSize, unsigned int* blockSumsSizes);
+	void allocateBlockSums(unsigned int datasetSize);
 	void freeBlockSums();
 };
 
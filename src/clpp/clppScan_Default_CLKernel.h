@@ -1,7 +1,10 @@
 
 char clCode_clppScan_Default[]=
 "#pragma OPENCL EXTENSION cl_amd_printf : enable\n"
-"#define T int\n"
+"#ifndef TRANSFORM\n"
+"#define INPUT_T T\n"
+"#define TRANSFORM(X) (X)\n"
+"#endif\n"
 "__kernel \n"
 "void kernel__ExclusivePrefixScanSmall(\n"
 "	__global T* input,\n"
@@ -23,12 +26,12 @@ char clCode_clppScan_Default[]=
 "			int ai = offset*(2*tid + 1) - 1;\n"
 "			int bi = offset*(2*tid + 2) - 1;\n"
 "			\n"
-"			block[bi] += block[ai];\n"
+"			block[bi] = OPERATOR_APPLY(block[ai], block[bi]);\n"
 "		}\n"
 "		offset *= 2;\n"
 "	}\n"
 "	if(tid == 0)\n"
-"		block[length - 1] = 0;\n"
+"		block[length - 1] = OPERATOR_IDENTITY;\n"
 "	for(int d = 1; d < length ; d *= 2)\n"
 "	{\n"
 "		offset >>=1;\n"
@@ -39,9 +42,9 @@ char clCode_clppScan_Default[]=
 "			int ai = offset*(2*tid + 1) - 1;\n"
 "			int bi = offset*(2*tid + 2) - 1;\n"
 "			\n"
-"			float t = block[ai];\n"
+"			T t = block[ai];\n"
 "			block[ai] = block[bi];\n"
-"			block[bi] += t;\n"
+"			block[bi] = OPERATOR_APPLY(block[bi], t);\n"
 "		}\n"
 "	}\n"
 "	\n"
@@ -59,11 +62,16 @@ char clCode_clppScan_Default[]=
 "__kernel\n"
 "void kernel__ExclusivePrefixScan(\n"
 "	__global T* dataSet,\n"
+"	__global T* output,\n"
 "	\n"
 "	__local T* localBuffer,\n"
 "	\n"
 "	__global T* blockSums,\n"
-"	const uint blockSumsSize\n"
+"	const uint blockSumsSize,\n"
+"	const uint inclusive,\n"
+"	__global T* total,\n"
+"	const uint totalIndex,\n"
+"	__global const INPUT_T* input\n"
 "	)\n"
 "{\n"
 "	const uint gid = get_global_id(0);\n"
@@ -88,11 +96,39 @@ char clCode_clppScan_Default[]=
 "	uint gbi = gid + lwz;\n"
 "	uint bankOffsetA = CONFLICT_FREE_OFFSET(ai); \n"
 "	uint bankOffsetB = CONFLICT_FREE_OFFSET(bi);\n"
-"	localBuffer[ai + bankOffsetA] = (gai < blockSumsSize) ? dataSet[gai] : 0; \n"
-"	localBuffer[bi + bankOffsetB] = (gbi < blockSumsSize) ? dataSet[gbi] : 0;\n"
+"	// The values are kept for the inclusive scan\n"
+"	T value0 = (gai < blockSumsSize) ? (input ? TRANSFORM(input[gai]) : dataSet[gai]) : OPERATOR_IDENTITY;\n"
+"	T value1 = (gbi < blockSumsSize) ? (input ? TRANSFORM(input[gbi]) : dataSet[gbi]) : OPERATOR_IDENTITY;\n"
+"	localBuffer[ai + bankOffsetA] = value0; \n"
+"	localBuffer[bi + bankOffsetB] = value1;\n"
+"#else\n"
+"	// The values are kept for the inclusive scan\n"
+"	T value0 = OPERATOR_IDENTITY;\n"
+"	T value1 = OPERATOR_IDENTITY;\n"
+"	if (input)\n"
+"	{\n"
+"		// Transform-scan : the inputs are transformed as they are loaded\n"
+"		if (gid2_0 < blockSumsSize)\n"
+"			value0 = TRANSFORM(input[gid2_0]);\n"
+"		if (gid2_1 < blockSumsSize)\n"
+"			value1 = TRANSFORM(input[gid2_1]);\n"
+"	}\n"
+"	else if (gid2_1 < blockSumsSize)\n"
+"	{\n"
+"#ifdef SUPPORT_VECTOR_LOADS\n"
+"		// The 2 values of the work-item are loaded at once\n"
+"		T2 values = vload2(gid, dataSet);\n"
+"		value0 = values.x;\n"
+"		value1 = values.y;\n"
 "#else\n"
-"	localBuffer[tid2_0] = (gid2_0 < blockSumsSize) ? dataSet[gid2_0] : 0;\n"
-"	localBuffer[tid2_1] = (gid2_1 < blockSumsSize) ? dataSet[gid2_1] : 0;\n"
+"		value0 = dataSet[gid2_0];\n"
+"		value1 = dataSet[gid2_1];\n"
+"#endif\n"
+"	}\n"
+"	else if (gid2_0 < blockSumsSize)\n"
+"		value0 = dataSet[gid2_0];\n"
+"	localBuffer[tid2_0] = value0;\n"
+"	localBuffer[tid2_1] = value1;\n"
 "#endif\n"
 "	\n"
 "for(uint d = lwz; d > 0; d >>= 1)\n"
@@ -112,7 +148,7 @@ char clCode_clppScan_Default[]=
 "const uint ai = mad24(offset, (tid2_1+0), -1);	// offset*(tid2_0+1)-1 = offset*(tid2_1+0)-1\n"
 "const uint bi = mad24(offset, (tid2_1+1), -1);	// offset*(tid2_1+1)-1;\n"
 "#endif\n"
-"localBuffer[bi] += localBuffer[ai];\n"
+"localBuffer[bi] = OPERATOR_APPLY(localBuffer[ai], localBuffer[bi]);\n"
 "}\n"
 "offset <<= 1;\n"
 "}\n"
@@ -134,13 +170,17 @@ char clCode_clppScan_Default[]=
 "		uint index = localBufferSize-1;\n"
 "		index += CONFLICT_FREE_OFFSET(index);\n"
 "		blockSums[bid] = localBuffer[index];\n"
-"		localBuffer[index] = 0;\n"
+"		if (total)\n"
+"			total[totalIndex] = localBuffer[index];\n"
+"		localBuffer[index] = OPERATOR_IDENTITY;\n"
 "#else\n"
 "		// We store the biggest value (the last) to the sum-block for later use.\n"
 "blockSums[bid] = localBuffer[localBufferSize-1];		\n"
+"		if (total)\n"
+"			total[totalIndex] = localBuffer[localBufferSize-1];\n"
 "		//barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);		\n"
 "		// Clear the last element\n"
-"localBuffer[localBufferSize - 1] = 0;\n"
+"localBuffer[localBufferSize - 1] = OPERATOR_IDENTITY;\n"
 "#endif\n"
 "}\n"
 "for(uint d = 1; d < localBufferSize; d <<= 1)\n"
@@ -163,19 +203,40 @@ char clCode_clppScan_Default[]=
 "#endif\n"
 "T tmp = localBuffer[ai];\n"
 "localBuffer[ai] = localBuffer[bi];\n"
-"localBuffer[bi] += tmp;\n"
+"localBuffer[bi] = OPERATOR_APPLY(localBuffer[bi], tmp);\n"
 "}\n"
 "}\n"
 "barrier(CLK_LOCAL_MEM_FENCE);\n"
 "	\n"
 "#ifdef SUPPORT_AVOID_BANK_CONFLICT\n"
-"	dataSet[gai] = (gai < blockSumsSize) * localBuffer[ai + bankOffsetA];		\n"
-"	dataSet[gbi] = (gbi < blockSumsSize) * localBuffer[bi + bankOffsetB];		\n"
+"	T result0 = localBuffer[ai + bankOffsetA];\n"
+"	T result1 = localBuffer[bi + bankOffsetB];\n"
+"#else\n"
+"	T result0 = localBuffer[tid2_0];\n"
+"	T result1 = localBuffer[tid2_1];\n"
+"#endif\n"
+"	if (inclusive)\n"
+"	{\n"
+"		result0 = OPERATOR_APPLY(result0, value0);\n"
+"		result1 = OPERATOR_APPLY(result1, value1);\n"
+"	}\n"
+"#ifdef SUPPORT_AVOID_BANK_CONFLICT\n"
+"	if (gai < blockSumsSize)\n"
+"		output[gai] = result0;\n"
+"	if (gbi < blockSumsSize)\n"
+"		output[gbi] = result1;\n"
 "#else\n"
-"	if (gid2_0 < blockSumsSize)\n"
-"		dataSet[gid2_0] = localBuffer[tid2_0];\n"
 "	if (gid2_1 < blockSumsSize)\n"
-"		dataSet[gid2_1] = localBuffer[tid2_1];\n"
+"	{\n"
+"#ifdef SUPPORT_VECTOR_LOADS\n"
+"		vstore2((T2)(result0, result1), gid, output);\n"
+"#else\n"
+"		output[gid2_0] = result0;\n"
+"		output[gid2_1] = result1;\n"
+"#endif\n"
+"	}\n"
+"	else if (gid2_0 < blockSumsSize)\n"
+"		output[gid2_0] = result0;\n"
 "#endif\n"
 "}\n"
 "__kernel\n"
@@ -206,14 +267,25 @@ char clCode_clppScan_Default[]=
 "#ifdef SUPPORT_AVOID_BANK_CONFLICT\n"
 "	unsigned int address = blockId * get_local_size(0) * 2 + get_local_id(0); \n"
 "	\n"
-"	output[address] += localBuffer[0];\n"
-"output[address + get_local_size(0)] += (get_local_id(0) + get_local_size(0) < outputSize) * localBuffer[0];\n"
+"	output[address] = OPERATOR_APPLY(localBuffer[0], output[address]);\n"
+"	if (get_local_id(0) + get_local_size(0) < outputSize)\n"
+"		output[address + get_local_size(0)] = OPERATOR_APPLY(localBuffer[0], output[address + get_local_size(0)]);\n"
+"#else\n"
+"	if (gid + 1 < outputSize)\n"
+"	{\n"
+"		// The block sum is the left operand : it combines the values before the block\n"
+"#ifdef SUPPORT_VECTOR_LOADS\n"
+"		T2 values = vload2(get_global_id(0), output);\n"
+"		values.x = OPERATOR_APPLY(localBuffer[0], values.x);\n"
+"		values.y = OPERATOR_APPLY(localBuffer[0], values.y);\n"
+"		vstore2(values, get_global_id(0), output);\n"
 "#else\n"
-"	if (gid < outputSize)\n"
-"		output[gid] += localBuffer[0];\n"
-"	gid++;\n"
-"	if (gid < outputSize)\n"
-"		output[gid] += localBuffer[0];\n"
+"		output[gid] = OPERATOR_APPLY(localBuffer[0], output[gid]);\n"
+"		output[gid + 1] = OPERATOR_APPLY(localBuffer[0], output[gid + 1]);\n"
+"#endif\n"
+"	}\n"
+"	else if (gid < outputSize)\n"
+"		output[gid] = OPERATOR_APPLY(localBuffer[0], output[gid]);\n"
 "#endif\n"
 "}\n"
 ;
@@ -35,83 +35,107 @@
 
 #pragma OPENCL EXTENSION cl_amd_printf : enable
 
-#define T uint
-#define OPERATOR_INDEXOF(I) I
-#define OPERATOR_APPLY(A,B) A+B
-#define OPERATOR_IDENTITY 0
+// The type of the values T, OPERATOR_APPLY and OPERATOR_IDENTITY are defined by the clppOperator of the scan
 
-//#define VOLATILE volatile
-#define VOLATILE
+// The transform of the inputs (INPUT_T and TRANSFORM) is defined by the clppTransform of the scan, the identity without one
+#ifndef TRANSFORM
+#define INPUT_T T
+#define TRANSFORM(X) (X)
+#endif
 
 //------------------------------------------------------------
-// kernel__scanInter
+// scan_workgroup_exclusive
 //
-// Purpose : do a scan on a chunck of data.
+// Purpose : Exclusive scan of one value per work-item, called by all the work-items of the work-group.
+// Uses the built-in collectives of the operator when the device has them (Work-group, else sub-group functions),
+// else a scan in local memory synchronized by barriers only : the work-items are never assumed to run in lockstep.
 //------------------------------------------------------------
 
-inline T scan_simt_exclusive(__local VOLATILE T* input, size_t idx, const uint lane)
+inline T scan_workgroup_exclusive(__local T* localBuf, const uint idx, const uint TC, T value)
 {
-	if (lane > 0 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 1)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 1 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 2)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 3 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 4)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 7 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 8)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 15) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 16)], input[OPERATOR_INDEXOF(idx)]);
-		
-	return (lane > 0) ? input[idx-1] : OPERATOR_IDENTITY;
-}
-
-inline T scan_simt_inclusive(__local VOLATILE T* input, size_t idx, const uint lane)
-{	
-	if (lane > 0 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 1)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 1 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 2)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 3 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 4)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 7 ) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 8)] , input[OPERATOR_INDEXOF(idx)]);
-	if (lane > 15) input[idx] = OPERATOR_APPLY(input[OPERATOR_INDEXOF(idx - 16)], input[OPERATOR_INDEXOF(idx)]);
-		
-	return input[idx];
-}
-
-inline T scan_workgroup_exclusive(__local T* localBuf, const uint idx, const uint lane, const uint simt_bid)
-{
-	// Step 1: Intra-warp scan in each warp
-	T val = scan_simt_exclusive(localBuf, idx, lane);
+#if defined(SUPPORT_WORK_GROUP_COLLECTIVES) && defined(OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE)
+	return OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE(value);
+#elif defined(SUPPORT_SUB_GROUPS) && defined(OPERATOR_SUB_GROUP_SCAN_EXCLUSIVE)
+	const uint sg = get_sub_group_id();
+	const uint lane = get_sub_group_local_id();
+	const uint sgSize = get_sub_group_size();
+	const uint sgCount = get_num_sub_groups();
+	
+	// Step 1: Scan in each sub-group
+	T val = OPERATOR_SUB_GROUP_SCAN_EXCLUSIVE(value);
+	
+	// Step 2: Collect the sub-group totals
+	if (lane == sgSize - 1)
+		localBuf[sg] = OPERATOR_APPLY(val, value);
 	barrier(CLK_LOCAL_MEM_FENCE);
 	
-	// Step 2: Collect per-warp partial results (the sum)
-	if (lane > 30) localBuf[simt_bid] = localBuf[idx];
+	// Step 3: The 1st sub-group scans the totals, by chunks of its size
+	if (sg == 0)
+	{
+		T carry = OPERATOR_IDENTITY;
+		for(uint base = 0; base < sgCount; base += sgSize)
+		{
+			const uint i = base + lane;
+			T sgTotal = (i < sgCount) ? localBuf[i] : OPERATOR_IDENTITY;
+			T prefix = OPERATOR_SUB_GROUP_SCAN_EXCLUSIVE(sgTotal);
+			if (i < sgCount)
+				localBuf[i] = OPERATOR_APPLY(carry, prefix);
+			carry = OPERATOR_APPLY(carry, sub_group_broadcast(OPERATOR_APPLY(prefix, sgTotal), sgSize - 1));
+		}
+	}
 	barrier(CLK_LOCAL_MEM_FENCE);
 	
-	// Step 3: Use 1st warp to scan per-warp results
-	if (simt_bid < 1) scan_simt_inclusive(localBuf, idx, lane);
+	// Step 4: Accumulate the totals of the previous sub-groups
+	val = OPERATOR_APPLY(localBuf[sg], val);
 	barrier(CLK_LOCAL_MEM_FENCE);
 	
-	// Step 4: Accumulate results from Steps 1 and 3
-	if (simt_bid > 0) val = OPERATOR_APPLY(localBuf[simt_bid-1], val);
+	return val;
+#else
+	// Inclusive scan in place (Hillis-Steele), a barrier between the reads and the writes of each step
+	localBuf[idx] = value;
 	barrier(CLK_LOCAL_MEM_FENCE);
 	
-	// Step 5: Write and return the final result
-	localBuf[idx] = val;
+	for(uint offset = 1; offset < TC; offset <<= 1)
+	{
+		T left = (idx >= offset) ? localBuf[idx - offset] : OPERATOR_IDENTITY;
+		barrier(CLK_LOCAL_MEM_FENCE);
+		
+		localBuf[idx] = OPERATOR_APPLY(left, localBuf[idx]);
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+	
+	T val = (idx > 0) ? localBuf[idx - 1] : OPERATOR_IDENTITY;
 	barrier(CLK_LOCAL_MEM_FENCE);
 	
 	return val;
+#endif
 }
 
+//------------------------------------------------------------
+// kernel__scan_block_anylength
+//
+// Purpose : do a scan on a chunck of data, exclusive or inclusive, to 'output'.
+// The scanned values are TRANSFORM(dataSet) : the data set itself without a transform.
+// 'total' (Can be null) receives the grand total, by the work-item of the last value.
+//------------------------------------------------------------
+
 __kernel
 void kernel__scan_block_anylength(
 	__local T* localBuf,
-	__global T* dataSet,
+	__global INPUT_T* dataSet,
+	__global T* output,
 	const uint B,
 	uint size,
-	const uint passesCount
+	const uint passesCount,
+	const uint inclusive,
+	__global T* total,
+	const uint totalIndex
 )
 {	
 	size_t idx = get_local_id(0);
 	const uint bidx = get_group_id(0);
 	const uint TC = get_local_size(0);
 	
-	const uint lane = idx & 31;
-	const uint simt_bid = idx >> 5;
-	
 	T reduceValue = OPERATOR_IDENTITY;
 	
 	//#pragma unroll 4
@@ -120,60 +144,31 @@ void kernel__scan_block_anylength(
 		const uint offset = i * TC + (bidx * B);
 		const uint offsetIdx = offset + idx;
 		
-#ifdef OCL_PLATFORM_AMD
-		if (offsetIdx > size-1)
-		{
-			// To avoid to lock !
-			barrier(CLK_LOCAL_MEM_FENCE);
-			barrier(CLK_LOCAL_MEM_FENCE);
-			barrier(CLK_LOCAL_MEM_FENCE);
-			
-			barrier(CLK_LOCAL_MEM_FENCE);
-			barrier(CLK_LOCAL_MEM_FENCE);
-			barrier(CLK_LOCAL_MEM_FENCE);
-			barrier(CLK_LOCAL_MEM_FENCE);
-			barrier(CLK_LOCAL_MEM_FENCE);
-			continue;
-		}
-#else
-		if (offsetIdx > size-1) return;
-#endif
-
-		// Step 1: Read TC elements from global (off-chip) memory to local memory (on-chip)
-		T input = localBuf[idx] = dataSet[offsetIdx];		
-		
-		/*
-		// This version try to avoid bank conflicts and improve memory access serializations !
-		if (lane < 1)
-		{
-			__global T* currentOffset = inputDatas + offsetIdx;
-			vstore16(vload16(0, currentOffset),  0, localBuf);
-			vstore16(vload16(0, currentOffset + 16), 16, localBuf);
-		}
-		barrier(CLK_LOCAL_MEM_FENCE);
-		T input = localBuf[idx];
-		*/
+		// All the work-items take part to the scan (Barriers and collectives) : the ones after the data set with the identity
+		const bool isValid = offsetIdx < size;
 		
-		barrier(CLK_LOCAL_MEM_FENCE);
+		// Step 1: Read TC elements from global (off-chip) memory
+		T input = isValid ? TRANSFORM(dataSet[offsetIdx]) : OPERATOR_IDENTITY;
 		
 		// Step 2: Perform scan on TC elements
-		T val = scan_workgroup_exclusive(localBuf, idx, lane, simt_bid);
+		T val = scan_workgroup_exclusive(localBuf, idx, TC, input);
 		
 		// Step 3: Propagate reduced result from previous block of TC elements
-		val = OPERATOR_APPLY(val, reduceValue);
+		val = OPERATOR_APPLY(reduceValue, val);
+		
+		// Step 4: Write out data to global memory (The output can be the data set)
+		if (isValid)
+			output[offsetIdx] = inclusive ? OPERATOR_APPLY(val, input) : val;
 		
-		// Step 4: Write out data to global memory
-		dataSet[offsetIdx] = val;
+		if (total && offsetIdx == size-1)
+			total[totalIndex] = OPERATOR_APPLY(val, input);
 		
 		// Step 5: Choose reduced value for next iteration
 		if (idx == (TC-1))
-		{
-			//localBuf[idx] = (Kind == exclusive) ? OPERATOR_APPLY(input, val) : val;
-			localBuf[idx] = OPERATOR_APPLY(input, val);
-		}
+			localBuf[idx] = OPERATOR_APPLY(val, input);
 		barrier(CLK_LOCAL_MEM_FENCE);
 		
 		reduceValue = localBuf[TC-1];
 		barrier(CLK_LOCAL_MEM_FENCE);
 	}
-}
\ No newline at end of file
+}
@@ -7,37 +7,62 @@
 // 1 - Allow templating
 // 2 - 
 
-#define SIMT_SIZE 32
-
 #pragma region Constructor
 
 clppScan_GPU::clppScan_GPU(clppContext* context, size_t valueSize, unsigned int maxElements) :
 	clppScan(context, valueSize, maxElements) 
 {
-	cl_int clStatus;
+	createPlan(maxElements);
+}
+
+clppScan_GPU::clppScan_GPU(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppScan(context, valueType, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppScan_GPU::clppScan_GPU(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	clppScan(context, op, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppScan_GPU::clppScan_GPU(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements) :
+	clppScan(context, op, transform, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+void clppScan_GPU::createPlan(unsigned int maxElements)
+{
 	_clBuffer_values = 0;
+	_clBuffer_ownedValues = 0;
+	_maxElements = maxElements;
+	_isBound = false;
 
 	//---- Compilation
-	if (!compile(context, clCode_clppScan_GPU))
+	if (!checkValueType())
 		return;
 
-	//---- Prepare all the kernels
-	kernel__scan = clCreateKernel(_clProgram, "kernel__scan_block_anylength", &clStatus);
-	checkCLStatus(clStatus);
+	if (!compile(_context, clCode_clppScan_GPU))
+		return;
+
+	//---- Prepare all the kernels (Owned : the arguments are bound once by 'bind')
+	kernel__scan = createKernel("kernel__scan_block_anylength");
 
 	//---- Get the workgroup size
-	// ATI : Actually the wavefront size is only 64 for the highend cards(48XX, 58XX, 57XX), but 32 for the middleend cards and 16 for the lowend cards.
-	// NVidia : 32
+	// Any size : the scan doesn't depend on the warp (or wavefront) width
 	clGetKernelWorkGroupInfo(kernel__scan, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
 	//clGetKernelWorkGroupInfo(kernel__scan, _context->clDevice, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &_workgroupSize, 0);
 
+	//---- The plan : allocate the buffer for maxElements
+	_clBuffer_ownedValues = allocateBuffer(_inputSize * maxElements);
 	_is_clBuffersOwner = false;
 }
 
 clppScan_GPU::~clppScan_GPU()
 {
-	if (_is_clBuffersOwner && _clBuffer_values)
-		clReleaseMemObject(_clBuffer_values);
+	releaseBuffer(_clBuffer_ownedValues);
 }
 
 #pragma endregion
@@ -46,22 +71,7 @@ clppScan_GPU::~clppScan_GPU()
 
 string clppScan_GPU::compilePreprocess(string kernel)
 {
-	//ostringstream lines;
-
-	//if (SIMT_SIZE == 32)
-	//{
-	//	lines << "#define SIMT_SIZE 32" << std::endl;
-	//	lines << "#define WORKGROUP_SIZE " <<  _workgroupSize << std::endl;
-	//}
-	//else
-	//{
-	//	lines << "#define SIMT_SIZE 64" << std::endl;
-	//	lines << "#define WORKGROUP_SIZE " <<  _workgroupSize << std::endl;		
-	//}
-
-	//lines << kernel << std::endl;
-	//return lines.str();
-
+	// No SIMT width : the kernel relies on the barriers or on the collectives, never on the lockstep execution
 	return clppScan::compilePreprocess(kernel);
 }
 
@@ -73,20 +83,49 @@ void clppScan_GPU::scan()
 {
 	cl_int clStatus;
 
+	//---- Nothing to scan (And no empty launch)
+	if (_datasetSize == 0)
+		return;
+
+	// The inputs of a transform-scan are kept
+	if (!checkTransformOutput())
+		return;
+
+	if (!_isBound)
+		bind();
+
+	size_t localWorkSize = {_workgroupSize};
+
+	// Each value (Or input) is read and written once
+	clStatus = enqueueKernel(kernel__scan, 1, &_globalWorkSize, &localWorkSize, "Scan", (_inputSize + _valueSize) * _datasetSize);
+	checkCLStatus(clStatus);
+}
+
+// Bind the arguments : only when the data set size or the buffer have changed.
+void clppScan_GPU::bind()
+{
+	cl_int clStatus;
+
 	int blockSize = _datasetSize / _workgroupSize;
 	int B = blockSize * _workgroupSize;
 	if ((_datasetSize % _workgroupSize) > 0) { blockSize++; };
-	size_t localWorkSize = {_workgroupSize};
-	size_t globalWorkSize = {toMultipleOf(_datasetSize / blockSize, _workgroupSize)};
+	_globalWorkSize = toMultipleOf(_datasetSize / blockSize, _workgroupSize);
+
+	cl_mem clOutput = getOutputBuffer();
+	unsigned int inclusive = _inclusive ? 1 : 0;
 
 	clStatus  = clSetKernelArg(kernel__scan, 0, _workgroupSize * _valueSize, 0);
 	clStatus |= clSetKernelArg(kernel__scan, 1, sizeof(cl_mem), &_clBuffer_values);
-	clStatus |= clSetKernelArg(kernel__scan, 2, sizeof(int), &B);
-	clStatus |= clSetKernelArg(kernel__scan, 3, sizeof(int), &_datasetSize);
-	clStatus |= clSetKernelArg(kernel__scan, 4, sizeof(int), &blockSize);
-
-	clStatus |= clEnqueueNDRangeKernel(_context->clQueue, kernel__scan, 1, NULL, &globalWorkSize, &localWorkSize, 0, NULL, NULL);
+	clStatus |= clSetKernelArg(kernel__scan, 2, sizeof(cl_mem), &clOutput);
+	clStatus |= clSetKernelArg(kernel__scan, 3, sizeof(int), &B);
+	clStatus |= clSetKernelArg(kernel__scan, 4, sizeof(int), &_datasetSize);
+	clStatus |= clSetKernelArg(kernel__scan, 5, sizeof(int), &blockSize);
+	clStatus |= clSetKernelArg(kernel__scan, 6, sizeof(int), &inclusive);
+	clStatus |= clSetKernelArg(kernel__scan, 7, sizeof(cl_mem), &_clBuffer_total);
+	clStatus |= clSetKernelArg(kernel__scan, 8, sizeof(int), &_totalIndex);
 	checkCLStatus(clStatus);
+
+	_isBound = true;
 }
 
 
@@ -126,35 +165,33 @@ void clppScan_GPU::pushDatas(void* values, size_t datasetSize)
 {
 	cl_int clStatus;
 
-	//---- Store some values
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	//---- Use our own buffer (Allocated by the plan)
 	_values = values;
-	bool reallocate = datasetSize > _datasetSize || !_is_clBuffersOwner;
-	_datasetSize = datasetSize;
+	setDataset(_clBuffer_ownedValues, datasetSize);
+	_is_clBuffersOwner = true;
 
 	//---- Copy on the device
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_values)
-			clReleaseMemObject(_clBuffer_values);
-
-		//---- Allocate & copy on the device
-		_clBuffer_values = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _valueSize * _datasetSize, _values, &clStatus);
-		_is_clBuffersOwner = true;
-		checkCLStatus(clStatus);
-
-		_is_clBuffersOwner = true;
-	}
-	else
-		// Just resend
-		clEnqueueWriteBuffer(_context->clQueue, _clBuffer_values, CL_FALSE, 0, _valueSize * _datasetSize, _values, 0, 0, 0);
+	clStatus = enqueueWriteBuffer(_clBuffer_values, _inputSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
 }
 
 void clppScan_GPU::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
 {
-	_values = 0;
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
 
+	_values = 0;
+	setDataset(clBuffer_values, datasetSize);
 	_is_clBuffersOwner = false;
+}
+
+void clppScan_GPU::setDataset(cl_mem clBuffer_values, size_t datasetSize)
+{
+	if (clBuffer_values != _clBuffer_values || datasetSize != _datasetSize)
+		_isBound = false;
 
 	_clBuffer_values = clBuffer_values;
 	_datasetSize = datasetSize;
@@ -166,14 +203,39 @@ void clppScan_GPU::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
 
 void clppScan_GPU::popDatas()
 {
-	cl_int clStatus = clEnqueueReadBuffer(_context->clQueue, _clBuffer_values, CL_TRUE, 0, _valueSize * _datasetSize, _values, 0, NULL, NULL);
+	if (!checkPopToInputs())
+		return;
+
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, _values);
 	checkCLStatus(clStatus);
 }
 
 void clppScan_GPU::popDatas(void* dataSet)
 {
-	cl_int clStatus = clEnqueueReadBuffer(_context->clQueue, _clBuffer_values, CL_TRUE, 0, _valueSize * _datasetSize, dataSet, 0, NULL, NULL);
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, dataSet);
 	checkCLStatus(clStatus);
 }
 
+#pragma endregion
+
+#pragma region Inclusive, out-of-place and total
+
+void clppScan_GPU::setInclusive(bool inclusive)
+{
+	clppScan::setInclusive(inclusive);
+	_isBound = false;
+}
+
+void clppScan_GPU::setOutput(cl_mem clBuffer_output)
+{
+	clppScan::setOutput(clBuffer_output);
+	_isBound = false;
+}
+
+void clppScan_GPU::setTotal(bool enable, cl_mem clBuffer_total, unsigned int index)
+{
+	clppScan::setTotal(enable, clBuffer_total, index);
+	_isBound = false;
+}
+
 #pragma endregion
\ No newline at end of file
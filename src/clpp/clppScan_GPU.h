@@ -7,6 +7,9 @@ class clppScan_GPU : public clppScan
 {
 public:
 	clppScan_GPU(clppContext* context, size_t valueSize, unsigned int maxElements);
+	clppScan_GPU(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppScan_GPU(clppContext* context, const clppOperator& op, unsigned int maxElements);
+	clppScan_GPU(clppContext* context, const clppOperator& op, const clppTransform& transform, unsigned int maxElements);
 	~clppScan_GPU();
 
 	string getName() { return "Prefix sum (exclusive) for the GPU"; }
@@ -19,10 +22,29 @@ public:
 	void popDatas();
 	void popDatas(void* dataSet);
 
+	void setInclusive(bool inclusive);
+	void setOutput(cl_mem clBuffer_output);
+	void setTotal(bool enable, cl_mem clBuffer_total = 0, unsigned int index = 0);
+
+	// Asynchronous versions (Defined by clppScan)
+	using clppScan::scan;
+	using clppScan::pushDatas;
+	using clppScan::pushCLDatas;
+	using clppScan::popDatas;
+
 	string compilePreprocess(string kernel);
 
 private:
 	cl_kernel kernel__scan;
+	size_t _globalWorkSize;
+	bool _isBound;						// The kernel arguments are up to date
+
+	unsigned int _maxElements;
+	cl_mem _clBuffer_ownedValues;		// Used by pushDatas
+
+	void createPlan(unsigned int maxElements);
+	void setDataset(cl_mem clBuffer_values, size_t datasetSize);
+	void bind();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,177 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// Single-pass prefix scan : each element is read and written once (About 2N of traffic, instead of 4N for the multi-level scan).
+//
+// Algorithm :
+// -----------
+// Chained scan with decoupled look-back. The data set is cut in tiles, one per work-group.
+// The tiles are numbered in the order the work-groups start (An atomic counter), so a tile only waits for tiles that are running.
+//
+// Each tile scans its values in local memory and publishes its aggregate, then it looks back at the previous tiles,
+// publishes its own inclusive prefix and applies its exclusive prefix to its values (See clppTiledScan.cl).
+//
+// References :
+// ------------
+// Duane Merrill, Michael Garland. Single-pass Parallel Prefix Scan with Decoupled Look-back. NVIDIA Technical Report NVR-2016-002.
+// https://research.nvidia.com/publication/single-pass-parallel-prefix-scan-decoupled-look-back
+//------------------------------------------------------------
+
+// The type of the values T, OPERATOR_APPLY and OPERATOR_IDENTITY are defined by the clppOperator of the scan.
+// LOOKBACK_ITEMS, the number of values per work-item, and the tiles functions are inserted by clppTiledScan::compilePreprocess.
+
+//------------------------------------------------------------
+// scan_workgroup_exclusive
+//
+// Purpose : Exclusive scan of one value per work-item (The local size is a power of 2), returns the total.
+// Uses the work-group collectives of the operator when the device has them.
+//------------------------------------------------------------
+
+inline T scan_workgroup_exclusive(__local T* buffer, const uint tid, const uint lwz, T* total)
+{
+#if defined(SUPPORT_WORK_GROUP_COLLECTIVES) && defined(OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE)
+	T value = buffer[tid];
+	*total = OPERATOR_WORK_GROUP_REDUCE(value);
+	return OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE(value);
+#else
+	uint offset = 1;
+
+	// bottom-up
+	for(uint d = lwz >> 1; d > 0; d >>= 1)
+	{
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		if (tid < d)
+		{
+			const uint ai = offset * (2 * tid + 1) - 1;
+			const uint bi = offset * (2 * tid + 2) - 1;
+			buffer[bi] = OPERATOR_APPLY(buffer[ai], buffer[bi]);
+		}
+		offset <<= 1;
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+	*total = buffer[lwz - 1];
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if (tid == 0)
+		buffer[lwz - 1] = OPERATOR_IDENTITY;
+
+	// top-down
+	for(uint d = 1; d < lwz; d <<= 1)
+	{
+		offset >>= 1;
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		if (tid < d)
+		{
+			const uint ai = offset * (2 * tid + 1) - 1;
+			const uint bi = offset * (2 * tid + 2) - 1;
+			T tmp = buffer[ai];
+			buffer[ai] = buffer[bi];
+			buffer[bi] = OPERATOR_APPLY(buffer[bi], tmp);
+		}
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	return buffer[tid];
+#endif
+}
+
+//------------------------------------------------------------
+// kernel__LookBackScan
+//
+// Purpose : Scan one tile of LOOKBACK_ITEMS * local size values, exclusive or inclusive, to 'output' (Can be the data set).
+// 'total' (Can be null) receives the grand total, from the last tile.
+//------------------------------------------------------------
+
+__kernel
+void kernel__LookBackScan(
+	__global T* dataSet,
+	__global T* output,
+	__local T* localBuffer,				// LOOKBACK_ITEMS * local size values, then local size values
+	volatile __global uint* tileStatus,
+	volatile __global T* tileAggregates,
+	volatile __global T* tilePrefixes,
+	volatile __global uint* tileCounter,
+	const uint size,
+	const uint inclusive,
+	__global T* total,
+	const uint totalIndex)
+{
+	const uint tid = get_local_id(0);
+	const uint lwz = get_local_size(0);
+	const uint tileSize = lwz * LOOKBACK_ITEMS;
+	__local T* threadBuffer = localBuffer + tileSize;
+
+	__local uint localTile;
+	__local T localPrefix;
+
+	//---- The tile : in the order the work-groups start
+	if (tid == 0)
+		localTile = atomic_inc(tileCounter);
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	const uint tile = localTile;
+	const uint tileOffset = tile * tileSize;
+
+	//---- Coalesced load, then each work-item takes LOOKBACK_ITEMS consecutive values
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		const uint i = k * lwz + tid;
+		localBuffer[i] = (tileOffset + i < size) ? dataSet[tileOffset + i] : OPERATOR_IDENTITY;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	T values[LOOKBACK_ITEMS];
+	T threadTotal = OPERATOR_IDENTITY;
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		values[k] = localBuffer[tid * LOOKBACK_ITEMS + k];
+		threadTotal = OPERATOR_APPLY(threadTotal, values[k]);
+	}
+
+	//---- Scan of the work-items totals
+	threadBuffer[tid] = threadTotal;
+	T tileAggregate;
+	T threadPrefix = scan_workgroup_exclusive(threadBuffer, tid, lwz, &tileAggregate);
+
+	//---- Publish the status of the tile and look back at the previous tiles
+	if (tid == 0)
+	{
+		T exclusivePrefix = OPERATOR_IDENTITY;
+
+		if (tile == 0)
+			tile_publish(tileStatus, tilePrefixes, 0, tileAggregate, TILE_PREFIX);
+		else
+		{
+			tile_publish(tileStatus, tileAggregates, tile, tileAggregate, TILE_AGGREGATE);
+			exclusivePrefix = tile_look_back(tileStatus, tileAggregates, tilePrefixes, tile);
+			tile_publish(tileStatus, tilePrefixes, tile, OPERATOR_APPLY(exclusivePrefix, tileAggregate), TILE_PREFIX);
+		}
+
+		if (total && tileOffset + tileSize >= size)
+			total[totalIndex] = OPERATOR_APPLY(exclusivePrefix, tileAggregate);
+
+		localPrefix = exclusivePrefix;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	//---- Apply the prefix to the values, then coalesced store
+	T prefix = OPERATOR_APPLY(localPrefix, threadPrefix);
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		T inclusivePrefix = OPERATOR_APPLY(prefix, values[k]);
+		localBuffer[tid * LOOKBACK_ITEMS + k] = inclusive ? inclusivePrefix : prefix;
+		prefix = inclusivePrefix;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		const uint i = k * lwz + tid;
+		if (tileOffset + i < size)
+			output[tileOffset + i] = localBuffer[i];
+	}
+}
@@ -0,0 +1,159 @@
+#include "clpp/clppScan_LookBack.h"
+#include "clpp/clppScan_LookBack_CLKernel.h"
+
+#pragma region Constructor
+
+clppScan_LookBack::clppScan_LookBack(clppContext* context, size_t valueSize, unsigned int maxElements) :
+	clppTiledScan(context, valueSize, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppScan_LookBack::clppScan_LookBack(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppTiledScan(context, valueType, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppScan_LookBack::clppScan_LookBack(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	clppTiledScan(context, op, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+void clppScan_LookBack::createPlan(unsigned int maxElements)
+{
+	_clBuffer_values = 0;
+	_clBuffer_ownedValues = 0;
+	_kernel_Scan = 0;
+
+	if (!checkValueType())
+		return;
+
+	if (!compile(_context, clCode_clppScan_LookBack))
+		return;
+
+	//---- Owned kernels : the arguments are bound once by 'bind'
+	_kernel_Scan = createKernel("kernel__LookBackScan");
+
+	//---- The tiles and their status, for maxElements
+	createTiles(_kernel_Scan, _valueSize);
+
+	_clBuffer_ownedValues = allocateBuffer(_valueSize * maxElements);
+}
+
+clppScan_LookBack::~clppScan_LookBack()
+{
+	releaseBuffer(_clBuffer_ownedValues);
+}
+
+#pragma endregion
+
+#pragma region scan
+
+void clppScan_LookBack::scan()
+{
+	cl_int clStatus;
+
+	if (_tiles == 0)
+		return;
+
+	if (!_isBound)
+		bind();
+
+	//---- Reset the status of the tiles
+	enqueueInit();
+
+	//---- Single pass : each value is read and written once, plus the status of the tiles
+	size_t localWorkSize = {_workgroupSize};
+	size_t globalWorkSize = {_tiles * _workgroupSize};
+	size_t bytes = 2 * _valueSize * _datasetSize + (sizeof(int) + 2 * _valueSize) * _tiles;
+	clStatus = enqueueKernel(_kernel_Scan, 1, &globalWorkSize, &localWorkSize, "Look-back scan", bytes);
+	checkCLStatus(clStatus);
+}
+
+// Bind the arguments : only when the data set size or the buffers have changed.
+void clppScan_LookBack::bind()
+{
+	cl_int clStatus;
+
+	cl_mem clOutput = getOutputBuffer();
+	unsigned int inclusive = _inclusive ? 1 : 0;
+	unsigned int size = (unsigned int)_datasetSize;
+
+	clStatus  = bindInit();
+
+	clStatus |= clSetKernelArg(_kernel_Scan, 0, sizeof(cl_mem), &_clBuffer_values);
+	clStatus |= clSetKernelArg(_kernel_Scan, 1, sizeof(cl_mem), &clOutput);
+	clStatus |= clSetKernelArg(_kernel_Scan, 2, (_tileSize + _workgroupSize) * _valueSize, 0);
+	clStatus |= clSetKernelArg(_kernel_Scan, 3, sizeof(cl_mem), &_clBuffer_TileStatus);
+	clStatus |= clSetKernelArg(_kernel_Scan, 4, sizeof(cl_mem), &_clBuffer_TileAggregates);
+	clStatus |= clSetKernelArg(_kernel_Scan, 5, sizeof(cl_mem), &_clBuffer_TilePrefixes);
+	clStatus |= clSetKernelArg(_kernel_Scan, 6, sizeof(cl_mem), &_clBuffer_TileCounter);
+	clStatus |= clSetKernelArg(_kernel_Scan, 7, sizeof(int), &size);
+	clStatus |= clSetKernelArg(_kernel_Scan, 8, sizeof(int), &inclusive);
+	clStatus |= clSetKernelArg(_kernel_Scan, 9, sizeof(cl_mem), &_clBuffer_total);
+	clStatus |= clSetKernelArg(_kernel_Scan, 10, sizeof(int), &_totalIndex);
+	checkCLStatus(clStatus);
+
+	_isBound = true;
+}
+
+#pragma endregion
+
+#pragma region pushDatas
+
+void clppScan_LookBack::pushDatas(void* values, size_t datasetSize)
+{
+	cl_int clStatus;
+
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	//---- Use our own buffer (Allocated by the plan)
+	_values = values;
+	setDataset(_clBuffer_ownedValues, datasetSize);
+	_is_clBuffersOwner = true;
+
+	//---- Copy on the device
+	clStatus = enqueueWriteBuffer(_clBuffer_values, _valueSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
+}
+
+void clppScan_LookBack::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
+{
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	_values = 0;
+	setDataset(clBuffer_values, datasetSize);
+	_is_clBuffersOwner = false;
+}
+
+void clppScan_LookBack::setDataset(cl_mem clBuffer_values, size_t datasetSize)
+{
+	if (clBuffer_values != _clBuffer_values || datasetSize != _datasetSize)
+		_isBound = false;
+
+	_clBuffer_values = clBuffer_values;
+	_datasetSize = datasetSize;
+	setTiles(datasetSize);
+}
+
+#pragma endregion
+
+#pragma region popDatas
+
+void clppScan_LookBack::popDatas()
+{
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
+}
+
+void clppScan_LookBack::popDatas(void* dataSet)
+{
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), _valueSize * _datasetSize, dataSet);
+	checkCLStatus(clStatus);
+}
+
+#pragma endregion
@@ -0,0 +1,40 @@
+#ifndef __CLPP_SCAN_LOOKBACK_H__
+#define __CLPP_SCAN_LOOKBACK_H__
+
+#include "clpp/clppTiledScan.h"
+
+// Single-pass scan (Chained scan with decoupled look-back) : each value is read and written once.
+class clppScan_LookBack : public clppTiledScan
+{
+public:
+	clppScan_LookBack(clppContext* context, size_t valueSize, unsigned int maxElements);
+	clppScan_LookBack(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppScan_LookBack(clppContext* context, const clppOperator& op, unsigned int maxElements);
+	~clppScan_LookBack();
+
+	string getName() { return "Prefix sum (exclusive) with decoupled look-back"; }
+
+	void scan();
+
+	void pushDatas(void* values, size_t datasetSize);
+	void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize);
+
+	void popDatas();
+	void popDatas(void* dataSet);
+
+	// Asynchronous versions (Defined by clppScan)
+	using clppScan::scan;
+	using clppScan::pushDatas;
+	using clppScan::pushCLDatas;
+	using clppScan::popDatas;
+
+private:
+	cl_kernel _kernel_Scan;
+	cl_mem _clBuffer_ownedValues;		// Used by pushDatas
+
+	void createPlan(unsigned int maxElements);
+	void setDataset(cl_mem clBuffer_values, size_t datasetSize);
+	void bind();
+};
+
+#endif
@@ -0,0 +1,123 @@
+
+char clCode_clppScan_LookBack[]=
+"inline T scan_workgroup_exclusive(__local T* buffer, const uint tid, const uint lwz, T* total)\n"
+"{\n"
+"#if defined(SUPPORT_WORK_GROUP_COLLECTIVES) && defined(OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE)\n"
+"	T value = buffer[tid];\n"
+"	*total = OPERATOR_WORK_GROUP_REDUCE(value);\n"
+"	return OPERATOR_WORK_GROUP_SCAN_EXCLUSIVE(value);\n"
+"#else\n"
+"	uint offset = 1;\n"
+"	// bottom-up\n"
+"	for(uint d = lwz >> 1; d > 0; d >>= 1)\n"
+"	{\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		if (tid < d)\n"
+"		{\n"
+"			const uint ai = offset * (2 * tid + 1) - 1;\n"
+"			const uint bi = offset * (2 * tid + 2) - 1;\n"
+"			buffer[bi] = OPERATOR_APPLY(buffer[ai], buffer[bi]);\n"
+"		}\n"
+"		offset <<= 1;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	*total = buffer[lwz - 1];\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	if (tid == 0)\n"
+"		buffer[lwz - 1] = OPERATOR_IDENTITY;\n"
+"	// top-down\n"
+"	for(uint d = 1; d < lwz; d <<= 1)\n"
+"	{\n"
+"		offset >>= 1;\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		if (tid < d)\n"
+"		{\n"
+"			const uint ai = offset * (2 * tid + 1) - 1;\n"
+"			const uint bi = offset * (2 * tid + 2) - 1;\n"
+"			T tmp = buffer[ai];\n"
+"			buffer[ai] = buffer[bi];\n"
+"			buffer[bi] = OPERATOR_APPLY(buffer[bi], tmp);\n"
+"		}\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	return buffer[tid];\n"
+"#endif\n"
+"}\n"
+"__kernel\n"
+"void kernel__LookBackScan(\n"
+"	__global T* dataSet,\n"
+"	__global T* output,\n"
+"	__local T* localBuffer,				// LOOKBACK_ITEMS * local size values, then local size values\n"
+"	volatile __global uint* tileStatus,\n"
+"	volatile __global T* tileAggregates,\n"
+"	volatile __global T* tilePrefixes,\n"
+"	volatile __global uint* tileCounter,\n"
+"	const uint size,\n"
+"	const uint inclusive,\n"
+"	__global T* total,\n"
+"	const uint totalIndex)\n"
+"{\n"
+"	const uint tid = get_local_id(0);\n"
+"	const uint lwz = get_local_size(0);\n"
+"	const uint tileSize = lwz * LOOKBACK_ITEMS;\n"
+"	__local T* threadBuffer = localBuffer + tileSize;\n"
+"	__local uint localTile;\n"
+"	__local T localPrefix;\n"
+"	//---- The tile : in the order the work-groups start\n"
+"	if (tid == 0)\n"
+"		localTile = atomic_inc(tileCounter);\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	const uint tile = localTile;\n"
+"	const uint tileOffset = tile * tileSize;\n"
+"	//---- Coalesced load, then each work-item takes LOOKBACK_ITEMS consecutive values\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		const uint i = k * lwz + tid;\n"
+"		localBuffer[i] = (tileOffset + i < size) ? dataSet[tileOffset + i] : OPERATOR_IDENTITY;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	T values[LOOKBACK_ITEMS];\n"
+"	T threadTotal = OPERATOR_IDENTITY;\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		values[k] = localBuffer[tid * LOOKBACK_ITEMS + k];\n"
+"		threadTotal = OPERATOR_APPLY(threadTotal, values[k]);\n"
+"	}\n"
+"	//---- Scan of the work-items totals\n"
+"	threadBuffer[tid] = threadTotal;\n"
+"	T tileAggregate;\n"
+"	T threadPrefix = scan_workgroup_exclusive(threadBuffer, tid, lwz, &tileAggregate);\n"
+"	//---- Publish the status of the tile and look back at the previous tiles\n"
+"	if (tid == 0)\n"
+"	{\n"
+"		T exclusivePrefix = OPERATOR_IDENTITY;\n"
+"		if (tile == 0)\n"
+"			tile_publish(tileStatus, tilePrefixes, 0, tileAggregate, TILE_PREFIX);\n"
+"		else\n"
+"		{\n"
+"			tile_publish(tileStatus, tileAggregates, tile, tileAggregate, TILE_AGGREGATE);\n"
+"			exclusivePrefix = tile_look_back(tileStatus, tileAggregates, tilePrefixes, tile);\n"
+"			tile_publish(tileStatus, tilePrefixes, tile, OPERATOR_APPLY(exclusivePrefix, tileAggregate), TILE_PREFIX);\n"
+"		}\n"
+"		if (total && tileOffset + tileSize >= size)\n"
+"			total[totalIndex] = OPERATOR_APPLY(exclusivePrefix, tileAggregate);\n"
+"		localPrefix = exclusivePrefix;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	//---- Apply the prefix to the values, then coalesced store\n"
+"	T prefix = OPERATOR_APPLY(localPrefix, threadPrefix);\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		T inclusivePrefix = OPERATOR_APPLY(prefix, values[k]);\n"
+"		localBuffer[tid * LOOKBACK_ITEMS + k] = inclusive ? inclusivePrefix : prefix;\n"
+"		prefix = inclusivePrefix;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		const uint i = k * lwz + tid;\n"
+"		if (tileOffset + i < size)\n"
+"			output[tileOffset + i] = localBuffer[i];\n"
+"	}\n"
+"}\n"
+;
@@ -0,0 +1,225 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// Segmented prefix scan : many independent scans packed in one data set, in a single device-wide pass.
+// A segment starts at each non-zero head flag, or when the key changes for the scan-by-key (The first value always starts a segment).
+// The values (And the keys) can be strided : Ex, the values of the interleaved key-value pairs (uint2) of the sorts.
+//
+// Algorithm :
+// -----------
+// The scan of the pairs (flag, value) with the segmented operator, which is associative :
+//   (fa, a) + (fb, b) = (fa | fb, fb ? b : a + b)
+//
+// It uses the tiles of the single-pass scan with decoupled look-back (See clppTiledScan.cl).
+// A tile which contains a head doesn't depend on the previous tiles : it publishes its inclusive prefix at once,
+// so with many small segments the look-back is very short.
+//
+// References :
+// ------------
+// Duane Merrill, Michael Garland. Single-pass Parallel Prefix Scan with Decoupled Look-back. NVIDIA Technical Report NVR-2016-002.
+// Shubhabrata Sengupta, Mark Harris, Yao Zhang, John D. Owens. Scan Primitives for GPU Computing. Graphics Hardware 2007.
+//------------------------------------------------------------
+
+// The type of the values T, OPERATOR_APPLY and OPERATOR_IDENTITY are defined by the clppOperator of the scan.
+// LOOKBACK_ITEMS, the number of values per work-item, and the tiles functions are inserted by clppTiledScan::compilePreprocess.
+
+// Must match clppSegmentedScan
+#define SEGMENT_FLAGS 0
+#define SEGMENT_KEYS 1
+
+//------------------------------------------------------------
+// kernel__ClearFlags / kernel__ScatterFlags
+//
+// Purpose : Build the head flags from the offsets of the segments.
+//------------------------------------------------------------
+
+__kernel
+void kernel__ClearFlags(__global uint* flags, const uint size)
+{
+	const uint i = get_global_id(0);
+
+	if (i < size)
+		flags[i] = 0;
+}
+
+__kernel
+void kernel__ScatterFlags(__global uint* flags, __global const uint* offsets, const uint segments, const uint size)
+{
+	const uint i = get_global_id(0);
+
+	if (i < segments && offsets[i] < size)
+		flags[offsets[i]] = 1;
+}
+
+//------------------------------------------------------------
+// segment_head
+//
+// Purpose : Returns 1 when the value 'i' starts a segment : its head flag, or its key differs from the previous key.
+//------------------------------------------------------------
+
+inline uint segment_head(__global const uint* segments, const uint segmentMode, const uint keyStride, const uint i)
+{
+	if (segmentMode == SEGMENT_FLAGS)
+		return segments[i] != 0;
+
+	return i == 0 || segments[i * keyStride] != segments[(i - 1) * keyStride];
+}
+
+//------------------------------------------------------------
+// scan_workgroup_segmented
+//
+// Purpose : Inclusive segmented scan of one pair per work-item (Hillis-Steele : the pairs keep their original flags).
+//------------------------------------------------------------
+
+inline void scan_workgroup_segmented(__local T* values, __local uint* flags, const uint tid, const uint lwz)
+{
+	for(uint offset = 1; offset < lwz; offset <<= 1)
+	{
+		T value;
+		uint flag;
+
+		barrier(CLK_LOCAL_MEM_FENCE);
+		if (tid >= offset)
+		{
+			value = values[tid - offset];
+			flag = flags[tid - offset];
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		if (tid >= offset && !flags[tid])
+		{
+			values[tid] = OPERATOR_APPLY(value, values[tid]);
+			flags[tid] = flag;
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+//------------------------------------------------------------
+// kernel__SegmentedScan
+//
+// Purpose : Scan one tile of LOOKBACK_ITEMS * local size values, exclusive or inclusive, to 'output' (Can be the data set).
+// The value 'i' is at dataSet[valueOffset + i * valueStride], its result at output[outputOffset + i * outputStride].
+// 'segments' are the head flags or the keys, see segment_head.
+// 'total' (Can be null) receives the total of the last segment.
+//------------------------------------------------------------
+
+__kernel
+void kernel__SegmentedScan(
+	__global T* dataSet,
+	const uint valueOffset,
+	const uint valueStride,
+	__global const uint* segments,
+	const uint segmentMode,
+	const uint keyStride,
+	__global T* output,
+	const uint outputOffset,
+	const uint outputStride,
+	__local T* localBuffer,				// LOOKBACK_ITEMS * local size values, then local size values
+	__local uint* localFlags,			// LOOKBACK_ITEMS * local size flags, then local size flags
+	volatile __global uint* tileStatus,
+	volatile __global T* tileAggregates,
+	volatile __global T* tilePrefixes,
+	volatile __global uint* tileCounter,
+	const uint size,
+	const uint inclusive,
+	__global T* total,
+	const uint totalIndex)
+{
+	const uint tid = get_local_id(0);
+	const uint lwz = get_local_size(0);
+	const uint tileSize = lwz * LOOKBACK_ITEMS;
+	__local T* threadValues = localBuffer + tileSize;
+	__local uint* threadFlags = localFlags + tileSize;
+
+	__local uint localTile;
+	__local T localPrefix;
+
+	//---- The tile : in the order the work-groups start
+	if (tid == 0)
+		localTile = atomic_inc(tileCounter);
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	const uint tile = localTile;
+	const uint tileOffset = tile * tileSize;
+
+	//---- Coalesced load, then each work-item takes LOOKBACK_ITEMS consecutive pairs
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		const uint i = k * lwz + tid;
+		const bool valid = tileOffset + i < size;
+		localBuffer[i] = valid ? dataSet[valueOffset + (tileOffset + i) * valueStride] : OPERATOR_IDENTITY;
+		localFlags[i] = valid ? segment_head(segments, segmentMode, keyStride, tileOffset + i) : 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	T values[LOOKBACK_ITEMS];
+	uint flags[LOOKBACK_ITEMS];
+	T threadTotal = OPERATOR_IDENTITY;
+	uint threadFlag = 0;
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		values[k] = localBuffer[tid * LOOKBACK_ITEMS + k];
+		flags[k] = localFlags[tid * LOOKBACK_ITEMS + k];
+		threadTotal = flags[k] ? values[k] : OPERATOR_APPLY(threadTotal, values[k]);
+		threadFlag |= flags[k];
+	}
+
+	//---- Scan of the work-items pairs
+	threadValues[tid] = threadTotal;
+	threadFlags[tid] = threadFlag;
+	scan_workgroup_segmented(threadValues, threadFlags, tid, lwz);
+
+	const T tileAggregate = threadValues[lwz - 1];
+	const uint tileFlag = threadFlags[lwz - 1];
+
+	// The exclusive pair of the work-item
+	T threadPrefix = (tid > 0) ? threadValues[tid - 1] : OPERATOR_IDENTITY;
+	const uint threadPrefixFlag = (tid > 0) ? threadFlags[tid - 1] : 0;
+
+	//---- Publish the status of the tile and look back at the previous tiles
+	if (tid == 0)
+	{
+		T exclusivePrefix = OPERATOR_IDENTITY;
+
+		// With a head, the inclusive prefix of the tile is its aggregate : it is published at once
+		if (tile == 0 || tileFlag)
+			tile_publish(tileStatus, tilePrefixes, tile, tileAggregate, TILE_PREFIX);
+		else
+			tile_publish(tileStatus, tileAggregates, tile, tileAggregate, TILE_AGGREGATE);
+
+		// The values before the first head of the tile need the previous tiles.
+		// The tiles with an aggregate status have no head, the look-back stops at the first inclusive prefix.
+		if (tile > 0 && !localFlags[0])
+			exclusivePrefix = tile_look_back(tileStatus, tileAggregates, tilePrefixes, tile);
+
+		if (tile > 0 && !tileFlag)
+			tile_publish(tileStatus, tilePrefixes, tile, OPERATOR_APPLY(exclusivePrefix, tileAggregate), TILE_PREFIX);
+
+		if (total && tileOffset + tileSize >= size)
+			total[totalIndex] = tileFlag ? tileAggregate : OPERATOR_APPLY(exclusivePrefix, tileAggregate);
+
+		localPrefix = exclusivePrefix;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	//---- Apply the prefix to the values (Restarted at each head), then coalesced store
+	T prefix = threadPrefixFlag ? threadPrefix : OPERATOR_APPLY(localPrefix, threadPrefix);
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		if (flags[k])
+			prefix = OPERATOR_IDENTITY;
+
+		T inclusivePrefix = OPERATOR_APPLY(prefix, values[k]);
+		localBuffer[tid * LOOKBACK_ITEMS + k] = inclusive ? inclusivePrefix : prefix;
+		prefix = inclusivePrefix;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(uint k = 0; k < LOOKBACK_ITEMS; k++)
+	{
+		const uint i = k * lwz + tid;
+		if (tileOffset + i < size)
+			output[outputOffset + (tileOffset + i) * outputStride] = localBuffer[i];
+	}
+}
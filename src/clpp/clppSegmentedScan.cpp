@@ -0,0 +1,295 @@
+#include "clpp/clppSegmentedScan.h"
+#include "clpp/clppSegmentedScan_CLKernel.h"
+
+// The segments (Must match clppSegmentedScan.cl)
+#define SEGMENT_FLAGS 0
+#define SEGMENT_KEYS 1
+
+#pragma region Constructor
+
+clppSegmentedScan::clppSegmentedScan(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppTiledScan(context, valueType, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+clppSegmentedScan::clppSegmentedScan(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	clppTiledScan(context, op, maxElements) 
+{
+	createPlan(maxElements);
+}
+
+void clppSegmentedScan::createPlan(unsigned int maxElements)
+{
+	_clBuffer_values = 0;
+	_clBuffer_ownedValues = 0;
+	_clBuffer_flags = 0;
+	_clBuffer_ownedFlags = 0;
+	_clBuffer_offsets = 0;
+	_segments = 0;
+	_segmentMode = SEGMENT_FLAGS;
+	_clBuffer_keys = 0;
+	_keyStride = 1;
+	_isPairs = false;
+	_kernel_Scan = 0;
+	_kernel_ClearFlags = 0;
+	_kernel_ScatterFlags = 0;
+
+	if (!checkValueType())
+		return;
+
+	if (!compile(_context, clCode_clppSegmentedScan))
+		return;
+
+	//---- Owned kernels : the arguments are bound once by 'bind'
+	_kernel_Scan = createKernel("kernel__SegmentedScan");
+	_kernel_ClearFlags = createKernel("kernel__ClearFlags");
+	_kernel_ScatterFlags = createKernel("kernel__ScatterFlags");
+
+	//---- The tiles and their status, for maxElements : the values and the flags are in local memory
+	createTiles(_kernel_Scan, _valueSize + sizeof(int));
+
+	_clBuffer_ownedValues = allocateBuffer(_valueSize * maxElements);
+}
+
+clppSegmentedScan::~clppSegmentedScan()
+{
+	releaseBuffer(_clBuffer_ownedValues);
+	releaseBuffer(_clBuffer_ownedFlags);
+}
+
+#pragma endregion
+
+#pragma region scan
+
+void clppSegmentedScan::scan()
+{
+	cl_int clStatus;
+
+	if (_tiles == 0)
+		return;
+
+	assert(_segmentMode == SEGMENT_KEYS ? _clBuffer_keys != 0 : _clBuffer_flags != 0);
+
+	if (!_isBound)
+		bind();
+
+	size_t localWorkSize = {_workgroupSize};
+	size_t globalWorkSize;
+
+	//---- The head flags from the offsets of the segments
+	if (_clBuffer_offsets)
+	{
+		globalWorkSize = toMultipleOf(_datasetSize, _workgroupSize);
+		clStatus = enqueueKernel(_kernel_ClearFlags, 1, &globalWorkSize, &localWorkSize, "Segment flags", sizeof(int) * _datasetSize);
+		checkCLStatus(clStatus);
+
+		globalWorkSize = toMultipleOf(_segments, _workgroupSize);
+		clStatus = enqueueKernel(_kernel_ScatterFlags, 1, &globalWorkSize, &localWorkSize, "Segment flags", 2 * sizeof(int) * _segments);
+		checkCLStatus(clStatus);
+	}
+
+	//---- Reset the status of the tiles
+	enqueueInit();
+
+	//---- Single pass : each value and flag (or key) is read once, each value written once, plus the status of the tiles
+	globalWorkSize = _tiles * _workgroupSize;
+	size_t bytes = (2 * _valueSize + sizeof(int)) * _datasetSize + (sizeof(int) + 2 * _valueSize) * _tiles;
+	clStatus = enqueueKernel(_kernel_Scan, 1, &globalWorkSize, &localWorkSize, "Segmented scan", bytes);
+	checkCLStatus(clStatus);
+}
+
+// Bind the arguments : only when the data set size or the buffers have changed.
+void clppSegmentedScan::bind()
+{
+	cl_int clStatus;
+
+	cl_mem clOutput = getOutputBuffer();
+	unsigned int inclusive = _inclusive ? 1 : 0;
+	unsigned int size = (unsigned int)_datasetSize;
+	cl_mem clSegments = (_segmentMode == SEGMENT_KEYS) ? _clBuffer_keys : _clBuffer_flags;
+
+	// The pairs : the values are the 2nd uints, the results too when the scan is in place
+	unsigned int valueOffset = _isPairs ? 1 : 0;
+	unsigned int valueStride = _isPairs ? 2 : 1;
+	unsigned int outputOffset = (_isPairs && !_clBuffer_output) ? 1 : 0;
+	unsigned int outputStride = (_isPairs && !_clBuffer_output) ? 2 : 1;
+
+	clStatus  = bindInit();
+
+	clStatus |= clSetKernelArg(_kernel_Scan, 0, sizeof(cl_mem), &_clBuffer_values);
+	clStatus |= clSetKernelArg(_kernel_Scan, 1, sizeof(int), &valueOffset);
+	clStatus |= clSetKernelArg(_kernel_Scan, 2, sizeof(int), &valueStride);
+	clStatus |= clSetKernelArg(_kernel_Scan, 3, sizeof(cl_mem), &clSegments);
+	clStatus |= clSetKernelArg(_kernel_Scan, 4, sizeof(int), &_segmentMode);
+	clStatus |= clSetKernelArg(_kernel_Scan, 5, sizeof(int), &_keyStride);
+	clStatus |= clSetKernelArg(_kernel_Scan, 6, sizeof(cl_mem), &clOutput);
+	clStatus |= clSetKernelArg(_kernel_Scan, 7, sizeof(int), &outputOffset);
+	clStatus |= clSetKernelArg(_kernel_Scan, 8, sizeof(int), &outputStride);
+	clStatus |= clSetKernelArg(_kernel_Scan, 9, (_tileSize + _workgroupSize) * _valueSize, 0);
+	clStatus |= clSetKernelArg(_kernel_Scan, 10, (_tileSize + _workgroupSize) * sizeof(int), 0);
+	clStatus |= clSetKernelArg(_kernel_Scan, 11, sizeof(cl_mem), &_clBuffer_TileStatus);
+	clStatus |= clSetKernelArg(_kernel_Scan, 12, sizeof(cl_mem), &_clBuffer_TileAggregates);
+	clStatus |= clSetKernelArg(_kernel_Scan, 13, sizeof(cl_mem), &_clBuffer_TilePrefixes);
+	clStatus |= clSetKernelArg(_kernel_Scan, 14, sizeof(cl_mem), &_clBuffer_TileCounter);
+	clStatus |= clSetKernelArg(_kernel_Scan, 15, sizeof(int), &size);
+	clStatus |= clSetKernelArg(_kernel_Scan, 16, sizeof(int), &inclusive);
+	clStatus |= clSetKernelArg(_kernel_Scan, 17, sizeof(cl_mem), &_clBuffer_total);
+	clStatus |= clSetKernelArg(_kernel_Scan, 18, sizeof(int), &_totalIndex);
+
+	if (_clBuffer_offsets)
+	{
+		clStatus |= clSetKernelArg(_kernel_ClearFlags, 0, sizeof(cl_mem), &_clBuffer_flags);
+		clStatus |= clSetKernelArg(_kernel_ClearFlags, 1, sizeof(int), &size);
+
+		clStatus |= clSetKernelArg(_kernel_ScatterFlags, 0, sizeof(cl_mem), &_clBuffer_flags);
+		clStatus |= clSetKernelArg(_kernel_ScatterFlags, 1, sizeof(cl_mem), &_clBuffer_offsets);
+		clStatus |= clSetKernelArg(_kernel_ScatterFlags, 2, sizeof(int), &_segments);
+		clStatus |= clSetKernelArg(_kernel_ScatterFlags, 3, sizeof(int), &size);
+	}
+	checkCLStatus(clStatus);
+
+	_isBound = true;
+}
+
+#pragma endregion
+
+#pragma region pushDatas
+
+void clppSegmentedScan::pushDatas(void* values, size_t datasetSize)
+{
+	cl_int clStatus;
+
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	//---- Use our own buffer (Allocated by the plan)
+	_values = values;
+	setDataset(_clBuffer_ownedValues, datasetSize);
+	_is_clBuffersOwner = true;
+
+	//---- Copy on the device
+	clStatus = enqueueWriteBuffer(_clBuffer_values, _valueSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
+}
+
+void clppSegmentedScan::pushCLDatas(cl_mem clBuffer_values, size_t datasetSize)
+{
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	_values = 0;
+	setDataset(clBuffer_values, datasetSize);
+	_is_clBuffersOwner = false;
+}
+
+void clppSegmentedScan::pushCLPairs(cl_mem clBuffer_pairs, size_t datasetSize)
+{
+	assert(_valueSize == sizeof(int));
+
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	pushCLDatas(clBuffer_pairs, datasetSize);
+	_isPairs = true;
+
+	// The keys are the 1st uints of the pairs
+	_segmentMode = SEGMENT_KEYS;
+	_clBuffer_keys = clBuffer_pairs;
+	_keyStride = 2;
+	_isBound = false;
+}
+
+void clppSegmentedScan::setDataset(cl_mem clBuffer_values, size_t datasetSize)
+{
+	// The keys were in the pairs : the segments of the new values must be pushed again
+	if (_isPairs)
+	{
+		_isPairs = false;
+		_segmentMode = SEGMENT_FLAGS;
+		_clBuffer_flags = 0;
+		_clBuffer_offsets = 0;
+		_segments = 0;
+		_clBuffer_keys = 0;
+		_keyStride = 1;
+		_isBound = false;
+	}
+
+	if (clBuffer_values != _clBuffer_values || datasetSize != _datasetSize)
+		_isBound = false;
+
+	_clBuffer_values = clBuffer_values;
+	_datasetSize = datasetSize;
+	setTiles(datasetSize);
+}
+
+#pragma endregion
+
+#pragma region pushFlags
+
+void clppSegmentedScan::pushFlags(void* flags)
+{
+	cl_int clStatus;
+
+	if (!_clBuffer_ownedFlags)
+		_clBuffer_ownedFlags = allocateBuffer(sizeof(int) * _maxElements);
+
+	pushCLFlags(_clBuffer_ownedFlags);
+
+	clStatus = enqueueWriteBuffer(_clBuffer_flags, sizeof(int) * _datasetSize, flags);
+	checkCLStatus(clStatus);
+}
+
+void clppSegmentedScan::pushCLFlags(cl_mem clBuffer_flags)
+{
+	_segmentMode = SEGMENT_FLAGS;
+	_clBuffer_flags = clBuffer_flags;
+	_clBuffer_offsets = 0;
+	_segments = 0;
+	_isBound = false;
+}
+
+void clppSegmentedScan::pushCLSegmentOffsets(cl_mem clBuffer_offsets, unsigned int segments)
+{
+	// The head flags are built by the scan, in our own buffer
+	if (!_clBuffer_ownedFlags)
+		_clBuffer_ownedFlags = allocateBuffer(sizeof(int) * _maxElements);
+
+	_segmentMode = SEGMENT_FLAGS;
+	_clBuffer_flags = _clBuffer_ownedFlags;
+	_clBuffer_offsets = clBuffer_offsets;
+	_segments = segments;
+	_isBound = false;
+}
+
+void clppSegmentedScan::pushCLKeys(cl_mem clBuffer_keys)
+{
+	_segmentMode = SEGMENT_KEYS;
+	_clBuffer_keys = clBuffer_keys;
+	_keyStride = 1;
+	_clBuffer_offsets = 0;
+	_segments = 0;
+	_isBound = false;
+}
+
+#pragma endregion
+
+#pragma region popDatas
+
+void clppSegmentedScan::popDatas()
+{
+	// In place pairs : the keys are read too
+	size_t stride = (_isPairs && !_clBuffer_output) ? 2 : 1;
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), stride * _valueSize * _datasetSize, _values);
+	checkCLStatus(clStatus);
+}
+
+void clppSegmentedScan::popDatas(void* dataSet)
+{
+	// In place pairs : the keys are read too
+	size_t stride = (_isPairs && !_clBuffer_output) ? 2 : 1;
+	cl_int clStatus = enqueueReadBuffer(getOutputBuffer(), stride * _valueSize * _datasetSize, dataSet);
+	checkCLStatus(clStatus);
+}
+
+#pragma endregion
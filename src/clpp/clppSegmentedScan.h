@@ -0,0 +1,69 @@
+#ifndef __CLPP_SEGMENTED_SCAN_H__
+#define __CLPP_SEGMENTED_SCAN_H__
+
+#include "clpp/clppTiledScan.h"
+
+// Segmented scan : independent scans of the segments of a data set, in a single device-wide pass.
+// The segments are given by head flags (A non-zero uint starts a segment), by the offsets of their first value,
+// or by keys (Scan-by-key : a segment starts when the key changes, Ex: after a sort).
+// The total (See setTotal) is the total of the last segment.
+class clppSegmentedScan : public clppTiledScan
+{
+public:
+	clppSegmentedScan(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppSegmentedScan(clppContext* context, const clppOperator& op, unsigned int maxElements);
+	~clppSegmentedScan();
+
+	string getName() { return "Segmented prefix sum (exclusive)"; }
+
+	void scan();
+
+	void pushDatas(void* values, size_t datasetSize);
+	void pushCLDatas(cl_mem clBuffer_values, size_t datasetSize);
+
+	// The segments : head flags, one uint per value (Host or device), or the sorted offsets of the segments.
+	// They are used by the next scans, push them after the values.
+	void pushFlags(void* flags);
+	void pushCLFlags(cl_mem clBuffer_flags);
+	void pushCLSegmentOffsets(cl_mem clBuffer_offsets, unsigned int segments);
+
+	// Scan-by-key : one uint key per value. Push them after the values.
+	void pushCLKeys(cl_mem clBuffer_keys);
+
+	// Scan-by-key of the interleaved key-value pairs (uint2) of the key-value sorts, the values are uints (Or ints).
+	// The values are scanned in place (The keys are kept), or to the output buffer (One value per pair).
+	// popDatas reads the pairs when the scan is in place. The next values pushed need their own segments.
+	void pushCLPairs(cl_mem clBuffer_pairs, size_t datasetSize);
+
+	void popDatas();
+	void popDatas(void* dataSet);
+
+	// Asynchronous versions (Defined by clppScan)
+	using clppScan::scan;
+	using clppScan::pushDatas;
+	using clppScan::pushCLDatas;
+	using clppScan::popDatas;
+
+private:
+	cl_kernel _kernel_Scan;
+	cl_kernel _kernel_ClearFlags;
+	cl_kernel _kernel_ScatterFlags;
+
+	cl_mem _clBuffer_ownedValues;		// Used by pushDatas
+
+	cl_mem _clBuffer_flags;
+	cl_mem _clBuffer_ownedFlags;		// Used by pushFlags and pushCLSegmentOffsets
+	cl_mem _clBuffer_offsets;			// The offsets to convert to head flags (0 if none)
+	unsigned int _segments;
+
+	unsigned int _segmentMode;			// Head flags or keys
+	cl_mem _clBuffer_keys;
+	unsigned int _keyStride;			// In uints
+	bool _isPairs;						// The values are the second uints of the pairs
+
+	void createPlan(unsigned int maxElements);
+	void setDataset(cl_mem clBuffer_values, size_t datasetSize);
+	void bind();
+};
+
+#endif
@@ -0,0 +1,148 @@
+
+char clCode_clppSegmentedScan[]=
+"#define SEGMENT_FLAGS 0\n"
+"#define SEGMENT_KEYS 1\n"
+"__kernel\n"
+"void kernel__ClearFlags(__global uint* flags, const uint size)\n"
+"{\n"
+"	const uint i = get_global_id(0);\n"
+"	if (i < size)\n"
+"		flags[i] = 0;\n"
+"}\n"
+"__kernel\n"
+"void kernel__ScatterFlags(__global uint* flags, __global const uint* offsets, const uint segments, const uint size)\n"
+"{\n"
+"	const uint i = get_global_id(0);\n"
+"	if (i < segments && offsets[i] < size)\n"
+"		flags[offsets[i]] = 1;\n"
+"}\n"
+"inline uint segment_head(__global const uint* segments, const uint segmentMode, const uint keyStride, const uint i)\n"
+"{\n"
+"	if (segmentMode == SEGMENT_FLAGS)\n"
+"		return segments[i] != 0;\n"
+"	return i == 0 || segments[i * keyStride] != segments[(i - 1) * keyStride];\n"
+"}\n"
+"inline void scan_workgroup_segmented(__local T* values, __local uint* flags, const uint tid, const uint lwz)\n"
+"{\n"
+"	for(uint offset = 1; offset < lwz; offset <<= 1)\n"
+"	{\n"
+"		T value;\n"
+"		uint flag;\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		if (tid >= offset)\n"
+"		{\n"
+"			value = values[tid - offset];\n"
+"			flag = flags[tid - offset];\n"
+"		}\n"
+"		barrier(CLK_LOCAL_MEM_FENCE);\n"
+"		if (tid >= offset && !flags[tid])\n"
+"		{\n"
+"			values[tid] = OPERATOR_APPLY(value, values[tid]);\n"
+"			flags[tid] = flag;\n"
+"		}\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"}\n"
+"__kernel\n"
+"void kernel__SegmentedScan(\n"
+"	__global T* dataSet,\n"
+"	const uint valueOffset,\n"
+"	const uint valueStride,\n"
+"	__global const uint* segments,\n"
+"	const uint segmentMode,\n"
+"	const uint keyStride,\n"
+"	__global T* output,\n"
+"	const uint outputOffset,\n"
+"	const uint outputStride,\n"
+"	__local T* localBuffer,				// LOOKBACK_ITEMS * local size values, then local size values\n"
+"	__local uint* localFlags,			// LOOKBACK_ITEMS * local size flags, then local size flags\n"
+"	volatile __global uint* tileStatus,\n"
+"	volatile __global T* tileAggregates,\n"
+"	volatile __global T* tilePrefixes,\n"
+"	volatile __global uint* tileCounter,\n"
+"	const uint size,\n"
+"	const uint inclusive,\n"
+"	__global T* total,\n"
+"	const uint totalIndex)\n"
+"{\n"
+"	const uint tid = get_local_id(0);\n"
+"	const uint lwz = get_local_size(0);\n"
+"	const uint tileSize = lwz * LOOKBACK_ITEMS;\n"
+"	__local T* threadValues = localBuffer + tileSize;\n"
+"	__local uint* threadFlags = localFlags + tileSize;\n"
+"	__local uint localTile;\n"
+"	__local T localPrefix;\n"
+"	//---- The tile : in the order the work-groups start\n"
+"	if (tid == 0)\n"
+"		localTile = atomic_inc(tileCounter);\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	const uint tile = localTile;\n"
+"	const uint tileOffset = tile * tileSize;\n"
+"	//---- Coalesced load, then each work-item takes LOOKBACK_ITEMS consecutive pairs\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		const uint i = k * lwz + tid;\n"
+"		const bool valid = tileOffset + i < size;\n"
+"		localBuffer[i] = valid ? dataSet[valueOffset + (tileOffset + i) * valueStride] : OPERATOR_IDENTITY;\n"
+"		localFlags[i] = valid ? segment_head(segments, segmentMode, keyStride, tileOffset + i) : 0;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	T values[LOOKBACK_ITEMS];\n"
+"	uint flags[LOOKBACK_ITEMS];\n"
+"	T threadTotal = OPERATOR_IDENTITY;\n"
+"	uint threadFlag = 0;\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		values[k] = localBuffer[tid * LOOKBACK_ITEMS + k];\n"
+"		flags[k] = localFlags[tid * LOOKBACK_ITEMS + k];\n"
+"		threadTotal = flags[k] ? values[k] : OPERATOR_APPLY(threadTotal, values[k]);\n"
+"		threadFlag |= flags[k];\n"
+"	}\n"
+"	//---- Scan of the work-items pairs\n"
+"	threadValues[tid] = threadTotal;\n"
+"	threadFlags[tid] = threadFlag;\n"
+"	scan_workgroup_segmented(threadValues, threadFlags, tid, lwz);\n"
+"	const T tileAggregate = threadValues[lwz - 1];\n"
+"	const uint tileFlag = threadFlags[lwz - 1];\n"
+"	// The exclusive pair of the work-item\n"
+"	T threadPrefix = (tid > 0) ? threadValues[tid - 1] : OPERATOR_IDENTITY;\n"
+"	const uint threadPrefixFlag = (tid > 0) ? threadFlags[tid - 1] : 0;\n"
+"	//---- Publish the status of the tile and look back at the previous tiles\n"
+"	if (tid == 0)\n"
+"	{\n"
+"		T exclusivePrefix = OPERATOR_IDENTITY;\n"
+"		// With a head, the inclusive prefix of the tile is its aggregate : it is published at once\n"
+"		if (tile == 0 || tileFlag)\n"
+"			tile_publish(tileStatus, tilePrefixes, tile, tileAggregate, TILE_PREFIX);\n"
+"		else\n"
+"			tile_publish(tileStatus, tileAggregates, tile, tileAggregate, TILE_AGGREGATE);\n"
+"		// The values before the first head of the tile need the previous tiles.\n"
+"		// The tiles with an aggregate status have no head, the look-back stops at the first inclusive prefix.\n"
+"		if (tile > 0 && !localFlags[0])\n"
+"			exclusivePrefix = tile_look_back(tileStatus, tileAggregates, tilePrefixes, tile);\n"
+"		if (tile > 0 && !tileFlag)\n"
+"			tile_publish(tileStatus, tilePrefixes, tile, OPERATOR_APPLY(exclusivePrefix, tileAggregate), TILE_PREFIX);\n"
+"		if (total && tileOffset + tileSize >= size)\n"
+"			total[totalIndex] = tileFlag ? tileAggregate : OPERATOR_APPLY(exclusivePrefix, tileAggregate);\n"
+"		localPrefix = exclusivePrefix;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	//---- Apply the prefix to the values (Restarted at each head), then coalesced store\n"
+"	T prefix = threadPrefixFlag ? threadPrefix : OPERATOR_APPLY(localPrefix, threadPrefix);\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		if (flags[k])\n"
+"			prefix = OPERATOR_IDENTITY;\n"
+"		T inclusivePrefix = OPERATOR_APPLY(prefix, values[k]);\n"
+"		localBuffer[tid * LOOKBACK_ITEMS + k] = inclusive ? inclusivePrefix : prefix;\n"
+"		prefix = inclusivePrefix;\n"
+"	}\n"
+"	barrier(CLK_LOCAL_MEM_FENCE);\n"
+"	for(uint k = 0; k < LOOKBACK_ITEMS; k++)\n"
+"	{\n"
+"		const uint i = k * lwz + tid;\n"
+"		if (tileOffset + i < size)\n"
+"			output[outputOffset + (tileOffset + i) * outputStride] = localBuffer[i];\n"
+"	}\n"
+"}\n"
+;
@@ -6,9 +6,53 @@ void clppSort::pushDatas(void* dataSet, size_t datasetSize)
 	_dataSet = dataSet;
 	_datasetSize = datasetSize;
 
-	cl_int clStatus;
-	_clBuffer_dataSet = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, _keySize * datasetSize, NULL, &clStatus);
-	checkCLStatus(clStatus);
+	_clBuffer_dataSet = allocateBuffer(_keySize * datasetSize);
 
 	pushCLDatas(_clBuffer_dataSet, datasetSize);
-}
\ No newline at end of file
+}
+
+#pragma region Temporary storage
+
+size_t clppSort::getTempStorageBytes(size_t datasetSize)
+{
+	return 0;
+}
+
+void clppSort::setTempStorage(cl_mem tempStorage, size_t offset)
+{
+	_tempStorage = tempStorage;
+	_tempStorageOffset = offset;
+}
+
+#pragma endregion
+
+#pragma region Asynchronous API
+
+void clppSort::sort(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	sort();
+	endAsync(event);
+}
+
+void clppSort::pushDatas(void* dataSet, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	pushDatas(dataSet, datasetSize);
+	endAsync(event);
+}
+
+void clppSort::pushCLDatas(cl_mem clBuffer_dataSet, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents)
+{
+	setWaitList(numWaitEvents, waitEvents);
+	pushCLDatas(clBuffer_dataSet, datasetSize);
+}
+
+void clppSort::popDatas(void* dataSet, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event)
+{
+	beginAsync(numWaitEvents, waitEvents, event);
+	popDatas(dataSet);
+	endAsync(event);
+}
+
+#pragma endregion
\ No newline at end of file
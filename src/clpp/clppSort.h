@@ -34,6 +34,31 @@ public:
 	virtual void popDatas() = 0;
 	virtual void popDatas(void* dataSet) = 0;
 
+	/// Returns the device buffer of the sorted data set, after 'sort' (The data set buffer for the in-place sorts).
+	virtual cl_mem getSortedBuffer() { return _clBuffer_dataSet; }
+
+	/// Returns the exact scratch (in bytes) needed to sort up to 'datasetSize' elements.
+	virtual size_t getTempStorageBytes(size_t datasetSize);
+
+	/// Use a caller-owned buffer for the scratch, so one arena can back many primitives.
+	///
+	/// \param tempStorage		Buffer of at least getTempStorageBytes(datasetSize) bytes after 'offset'. 0 to use the internal buffers.
+	/// \param offset			Offset of the scratch in 'tempStorage', aligned on CL_DEVICE_MEM_BASE_ADDR_ALIGN.
+	virtual void setTempStorage(cl_mem tempStorage, size_t offset = 0);
+
+	/// Asynchronous versions of the operations
+	///
+	/// \param numWaitEvents		Number of events in 'waitEvents'.
+	/// \param waitEvents			Events to wait for before starting the operation.
+	/// \param event				Receives the completion event, to be released by the caller. Can be null.
+	///							When requested, popDatas doesn't block : wait for the event before reading the datas.
+	void sort(cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void pushDatas(void* dataSet, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+	void popDatas(void* dataSet, cl_uint numWaitEvents, const cl_event* waitEvents, cl_event* event);
+
+	/// Push the data on the device, the wait-list is applied to the next enqueued command (Usually the sort).
+	void pushCLDatas(cl_mem clBuffer_dataSet, size_t datasetSize, cl_uint numWaitEvents, const cl_event* waitEvents);
+
 protected:
 	
 	void* _dataSet;				// The associated data set to sort
@@ -43,8 +68,6 @@ protected:
 	unsigned int _keySize;
 	unsigned int _valueSize;
 
-	size_t _datasetSize;	// The number of items to sort
-
 	unsigned int _keyBits;	// The bits used by the key
 };
 
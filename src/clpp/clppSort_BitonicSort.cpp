@@ -1,9 +1,6 @@
-//#define BENCHMARK
 #include "clpp/clppSort_BitonicSort.h"
 #include "clpp/clpp.h"
 
-#include "clpp/StopWatch.h"
-
 #include "clpp/clppScan_Default.h"
 
 #include "clpp/clppSort_BitonicSort_CLKernel.h"
@@ -21,6 +18,9 @@ clppSort_BitonicSort::clppSort_BitonicSort(clppContext* context, unsigned int ma
 	_keySize = 4;
 	_clBuffer_dataSet = 0;
 	_clBuffer_dataSetOut = 0;
+	_clBuffer_ownedDataSet = 0;
+	_maxElements = maxElements;
+	_isBound = false;
 
 	if (!compile(context, clCode_clppSort_BitonicSort))
 		return;
@@ -28,28 +28,22 @@ clppSort_BitonicSort::clppSort_BitonicSort(clppContext* context, unsigned int ma
 	//if (!compile(context, string("clppSort_BitonicSort.cl")))
 	//	return;
 
-	//---- Prepare all the kernels
-	cl_int clStatus;
-
-	_kernel__BitonicSort = clCreateKernel(_clProgram, "kernel__BitonicSort", &clStatus);
-	checkCLStatus(clStatus);
+	//---- Prepare all the kernels (Owned : the data set is bound once by 'bind')
+	_kernel__BitonicSort = createKernel("kernel__BitonicSort");
 
 	clGetKernelWorkGroupInfo(_kernel__BitonicSort, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
 
+	//---- The plan : allocate the buffer for maxElements (The sort is done in place)
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+	_clBuffer_ownedDataSet = allocateBuffer(elementSize * maxElements);
+
 	_datasetSize = 0;
 	_is_clBuffersOwner = false;
 }
 
 clppSort_BitonicSort::~clppSort_BitonicSort()
 {
-	if (_is_clBuffersOwner)
-	{
-		if (_clBuffer_dataSet)
-			clReleaseMemObject(_clBuffer_dataSet);
-	}
-
-	if (_clBuffer_dataSetOut)
-		clReleaseMemObject(_clBuffer_dataSetOut);
+	releaseBuffer(_clBuffer_ownedDataSet);
 }
 
 #pragma endregion
@@ -86,34 +80,51 @@ inline int roundUpDiv(int A, int B) { return (A + B - 1) / (B); }
 
 void clppSort_BitonicSort::sort()
 {
-	const size_t global[1] = { _datasetSize / 2 };
-	size_t local[1] = { _workgroupSize };
-	while(local[0] > _datasetSize*0.25f) local[0] *= 0.5f;
-	
-    cl_int clStatus;
-    clStatus  = clSetKernelArg(_kernel__BitonicSort, 0, sizeof(cl_mem), (const void*)&_clBuffer_dataSet);
-    //clStatus |= clSetKernelArg(_kernel__BitonicSort, 1, sizeof(cl_mem), (const void*)dataOut);
-	
-	cl_uint numStages = 0;
-	for(unsigned int temp = _datasetSize; temp > 1; temp >>= 1)
-		++numStages;
-	
-	for(cl_uint stage = 0; stage < numStages; ++stage)
+	//---- Nothing to sort (And no empty launch)
+	if (_datasetSize == 0)
+		return;
+
+	if (!_isBound)
+		bind();
+
+	const size_t global[1] = { _globalWorkSize };
+	size_t local[1] = { _localWorkSize };
+
+	// Each pass reads and writes the whole data set
+	size_t passBytes = 2 * (_keysOnly ? _keySize : (_valueSize+_keySize)) * _datasetSize;
+
+    cl_int clStatus = CL_SUCCESS;
+	for(cl_uint stage = 0; stage < _numStages; ++stage)
 	{
-		clStatus = clSetKernelArg(_kernel__BitonicSort, 1, sizeof(int), (const void*)&stage);
+		clStatus |= clSetKernelArg(_kernel__BitonicSort, 1, sizeof(int), (const void*)&stage);
 
 		for(cl_uint passOfStage = 0; passOfStage < stage + 1; ++passOfStage)
 		{
-			clStatus = clSetKernelArg(_kernel__BitonicSort, 2, sizeof(int), (const void*)&passOfStage);
-
-			clEnqueueNDRangeKernel(_context->clQueue, _kernel__BitonicSort, 1, NULL, global, local, 0, NULL, NULL);
-			
-#ifdef BENCHMARK
-    clStatus |= clFinish(_context->clQueue);
-    checkCLStatus(clStatus);
-#endif
+			clStatus |= clSetKernelArg(_kernel__BitonicSort, 2, sizeof(int), (const void*)&passOfStage);
+
+			clStatus |= enqueueKernel(_kernel__BitonicSort, 1, global, local, "Bitonic pass", passBytes);
 		}
 	}
+	checkCLStatus(clStatus);
+}
+
+// Bind the data set and compute the geometry : only when the data set size or the buffer have changed.
+void clppSort_BitonicSort::bind()
+{
+	_globalWorkSize = _datasetSize / 2;
+	_localWorkSize = _workgroupSize;
+	while(_localWorkSize > _datasetSize*0.25f) _localWorkSize *= 0.5f;
+
+	_numStages = 0;
+	for(unsigned int temp = _datasetSize; temp > 1; temp >>= 1)
+		++_numStages;
+
+    cl_int clStatus;
+    clStatus  = clSetKernelArg(_kernel__BitonicSort, 0, sizeof(cl_mem), (const void*)&_clBuffer_dataSet);
+    //clStatus |= clSetKernelArg(_kernel__BitonicSort, 1, sizeof(cl_mem), (const void*)dataOut);
+	checkCLStatus(clStatus);
+
+	_isBound = true;
 }
 
 #pragma endregion
@@ -124,88 +135,37 @@ void clppSort_BitonicSort::pushDatas(void* dataSet, size_t datasetSize)
 {
 	cl_int clStatus;
 
-	//---- Store some values
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	//---- Use our own buffer (Allocated by the plan)
 	_dataSet = dataSet;
 	_dataSetOut = dataSet;
-	bool reallocate = datasetSize > _datasetSize || !_is_clBuffersOwner;
-	_datasetSize = datasetSize;
+	setDataset(_clBuffer_ownedDataSet, datasetSize);
+	_is_clBuffersOwner = true;
 
-	//---- Prepare some buffers
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_dataSet)
-		{
-			clReleaseMemObject(_clBuffer_dataSet);
-			clReleaseMemObject(_clBuffer_dataSetOut);
-		}
-
-		//---- Copy on the device
-		if (_keysOnly)
-		{
-			_clBuffer_dataSet = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _keySize * _datasetSize, _dataSet, &clStatus);
-			checkCLStatus(clStatus);
-
-			_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, _keySize * _datasetSize, NULL, &clStatus);
-			checkCLStatus(clStatus);
-		}
-		else
-		{
-			_clBuffer_dataSet = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, (_valueSize+_keySize) * _datasetSize, _dataSet, &clStatus);
-			checkCLStatus(clStatus);
-
-			_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, (_valueSize+_keySize) * _datasetSize, NULL, &clStatus);
-			checkCLStatus(clStatus);
-		}
-
-		_is_clBuffersOwner = true;
-	}
-	else
-	{
-		// Just resend
-		if (_keysOnly)
-			clEnqueueWriteBuffer(_context->clQueue, _clBuffer_dataSet, CL_FALSE, 0, (_keySize) * _datasetSize, _dataSet, 0, 0, 0);
-		else
-			clEnqueueWriteBuffer(_context->clQueue, _clBuffer_dataSet, CL_FALSE, 0, (_valueSize+_keySize) * _datasetSize, _dataSet, 0, 0, 0);
-	}
+	//---- Copy on the device
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+	clStatus = enqueueWriteBuffer(_clBuffer_dataSet, elementSize * _datasetSize, _dataSet);
+	checkCLStatus(clStatus);
 }
 
 void clppSort_BitonicSort::pushCLDatas(cl_mem clBuffer_dataSet, size_t datasetSize)
 {
-	cl_int clStatus;
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
 
+	setDataset(clBuffer_dataSet, datasetSize);
 	_is_clBuffersOwner = false;
+}
 
-	//---- Store some values
-	bool reallocate = datasetSize > _datasetSize;
-	_datasetSize = datasetSize;
-
-	//---- Prepare some buffers
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_dataSet)
-		{
-			clReleaseMemObject(_clBuffer_dataSet);
-			clReleaseMemObject(_clBuffer_dataSetOut);
-		}
-
-		//---- Allocate
-		unsigned int numBlocks = roundUpDiv(_datasetSize, _workgroupSize * 4);
-	}
-
-	// ISSUE : We need 2 different buffers, but
-	// a) when using 32 bits sort(by example) the result buffer is _clBuffer_dataSet
-	// b) when using 28 bits sort(by example) the result buffer is _clBuffer_dataSetOut
-	// Without copy, how can we do to put the result in _clBuffer_dataSet when using 28 bits ?
+void clppSort_BitonicSort::setDataset(cl_mem clBuffer_dataSet, size_t datasetSize)
+{
+	if (clBuffer_dataSet != _clBuffer_dataSet || datasetSize != _datasetSize)
+		_isBound = false;
 
 	_clBuffer_dataSet = clBuffer_dataSet;
-	
-	if (_keysOnly)
-		_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, _keySize * _datasetSize, NULL, &clStatus);
-	else
-		_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, (_valueSize+_keySize) * _datasetSize, NULL, &clStatus);
-	checkCLStatus(clStatus);
+	_datasetSize = datasetSize;
 }
 
 #pragma endregion
@@ -224,11 +184,11 @@ void clppSort_BitonicSort::popDatas(void* dataSet)
 
 	if (_keysOnly)
 	{
-		clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSet, CL_TRUE, 0, _keySize * _datasetSize, dataSet, 0, NULL, NULL);
+		enqueueReadBuffer(_clBuffer_dataSet, _keySize * _datasetSize, dataSet);
 	}
 	else
 	{
-			clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSet, CL_TRUE, 0, (_valueSize + _keySize) * _datasetSize, dataSet, 0, NULL, NULL);
+			enqueueReadBuffer(_clBuffer_dataSet, (_valueSize + _keySize) * _datasetSize, dataSet);
 	}
 }
 
@@ -19,18 +19,35 @@ public:
 	void popDatas();
 	void popDatas(void* dataSet);
 
+	// Asynchronous versions (Defined by clppSort)
+	using clppSort::sort;
+	using clppSort::pushDatas;
+	using clppSort::pushCLDatas;
+	using clppSort::popDatas;
+
 	string compilePreprocess(string kernel);
 
 private:
 	bool _keysOnly;			// Key-Values or Keys-only
-	size_t _datasetSize;	// The number of keys to sort
 
 	void* _dataSetOut;
 	cl_mem _clBuffer_dataSetOut;
 
+	cl_mem _clBuffer_ownedDataSet;		// Used by pushDatas
+
 	cl_kernel _kernel__BitonicSort;
+	bool _isBound;						// The data set argument is up to date
 
 	size_t _workgroupSize;
+	unsigned int _maxElements;
+
+	// The geometry, computed by 'bind'
+	size_t _globalWorkSize;
+	size_t _localWorkSize;
+	cl_uint _numStages;
+
+	void setDataset(cl_mem clBuffer_dataSet, size_t datasetSize);
+	void bind();
 
 	bool _is_clBuffersOwner;
 };
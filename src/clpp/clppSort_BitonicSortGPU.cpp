@@ -3,12 +3,9 @@
 // Copyright (c) Eric Bainville - June 2011
 // http://www.bealto.com/gpu-sorting_intro.html
 
-//#define BENCHMARK
 #include "clpp/clppSort_BitonicSortGPU.h"
 #include "clpp/clpp.h"
 
-#include "clpp/StopWatch.h"
-
 #include "clpp/clppScan_Default.h"
 
 #include <list>
@@ -44,6 +41,9 @@ clppSort_BitonicSortGPU::clppSort_BitonicSortGPU(clppContext* context, unsigned
 	_keySize = 4;
 	_clBuffer_dataSet = 0;
 	_clBuffer_dataSetOut = 0;
+	_clBuffer_ownedDataSet = 0;
+	_maxElements = maxElements;
+	_isBound = false;
 
 	if (!compile(context, clCode_clppSort_BitonicSortGPU))
 		return;
@@ -51,29 +51,27 @@ clppSort_BitonicSortGPU::clppSort_BitonicSortGPU(clppContext* context, unsigned
 	//if (!compile(context, string("clppSort_BitonicSortGPU.cl")))
 	//	return;
 
-	//---- Prepare all the kernels
-	cl_int clStatus;
-
+	//---- Prepare all the kernels (Owned : the data set and the size are bound once by 'bind')
 	for(int i = 0; i < NB_KERNELS; i++)
 	{
-		_kernels.push_back( clCreateKernel(_clProgram, KernelNames[i], &clStatus) );
-		checkCLStatus(clStatus);
+		_kernels.push_back( createKernel(KernelNames[i]) );
+
+		size_t wg;
+		clGetKernelWorkGroupInfo(_kernels[i], _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &wg, 0);
+		_kernelsWorkgroupSize.push_back( min(wg, (size_t)256) );
 	}
 
+	//---- The plan : allocate the buffer for maxElements (The sort is done in place)
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+	_clBuffer_ownedDataSet = allocateBuffer(elementSize * maxElements);
+
 	_datasetSize = 0;
 	_is_clBuffersOwner = false;
 }
 
 clppSort_BitonicSortGPU::~clppSort_BitonicSortGPU()
 {
-	if (_is_clBuffersOwner)
-	{
-		if (_clBuffer_dataSet)
-			clReleaseMemObject(_clBuffer_dataSet);
-	}
-
-	//if (_clBuffer_dataSetOut)
-	//	clReleaseMemObject(_clBuffer_dataSetOut);
+	releaseBuffer(_clBuffer_ownedDataSet);
 }
 
 #pragma endregion
@@ -112,9 +110,42 @@ inline int roundUpDiv(int A, int B) { return (A + B - 1) / (B); }
 #define ALLOWB (2+4+8)
 
 void clppSort_BitonicSortGPU::sort()
+{
+	//---- Nothing to sort (And no empty launch)
+	if (_datasetSize == 0)
+		return;
+
+	if (!_isBound)
+		bind();
+
+	// Each launch reads and writes the whole data set
+	size_t passBytes = 2 * (_keysOnly ? _keySize : (_valueSize+_keySize)) * _datasetSize;
+
+	//---- Only the INC and DIR arguments change between the launches
+	cl_int clStatus = 0;
+	for(size_t i = 0; i < _launches.size(); i++)
+	{
+		const Launch& launch = _launches[i];
+
+		clStatus |= clSetKernelArg(_kernels[launch.kid], 1, sizeof(int), &launch.inc);		// INC passed to kernel
+		clStatus |= clSetKernelArg(_kernels[launch.kid], 2, sizeof(int), &launch.dir);		// DIR passed to kernel
+
+		size_t global[1] = {launch.global};
+		size_t local[1] = {_kernelsLocalSize[launch.kid]};
+		// The queue is in-order : no barrier is needed between the passes
+		clStatus |= enqueueKernel(_kernels[launch.kid], 1, global, local, KernelNames[launch.kid], passBytes);
+	}
+	checkCLStatus(clStatus);
+}
+
+// Compute the launches and bind the constant arguments : only when the data set size or the buffer have changed.
+void clppSort_BitonicSortGPU::bind()
 {
 	int keyValueSize = _keysOnly ? _keySize : (_valueSize+_keySize);
 
+	_launches.clear();
+	_kernelsLocalSize.assign(NB_KERNELS, 0);
+
 	for(int length = 1; length < _datasetSize; length <<= 1)
     {
 		int inc = length;
@@ -147,7 +178,6 @@ void clppSort_BitonicSortGPU::sort()
 		{
 			int ninc = 0;
 			int kid = -1;
-			int doLocal = 0;
 			int nThreads = 0;
 			int d = strategy.front(); strategy.pop_front();
 
@@ -156,7 +186,6 @@ void clppSort_BitonicSortGPU::sort()
 			case -1:
 				kid = PARALLEL_BITONIC_C4_KERNEL;
 				ninc = -1; // reduce all bits
-				doLocal = 4;
 				nThreads = _datasetSize >> 2;
 				break;
 			case 4:
@@ -184,40 +213,38 @@ void clppSort_BitonicSortGPU::sort()
 				break;
 			}
 
-			//---- Execute the kernel
-			size_t wg;
-			clGetKernelWorkGroupInfo(_kernels[kid], _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &wg, 0);
-			wg = min(wg, 256);
-			wg = min(wg, nThreads);
-
-			cl_int clStatus = 0;
-			unsigned int pId = 0;
-			clStatus |= clSetKernelArg(_kernels[kid], pId++, sizeof(cl_mem), (const void*)&_clBuffer_dataSet);
-			clStatus |= clSetKernelArg(_kernels[kid], pId++, sizeof(int), &inc);		// INC passed to kernel
-			int lenght2 = length << 1;
-			clStatus |= clSetKernelArg(_kernels[kid], pId++, sizeof(int), &lenght2);	// DIR passed to kernel
-			if (doLocal>0)
-				clStatus |= clSetKernelArg(_kernels[kid], pId++, doLocal * wg * keyValueSize, 0);
-			clStatus |= clSetKernelArg(_kernels[kid], pId++, sizeof(unsigned int), (const void*)&_datasetSize);
-
-			size_t global[1] = {nThreads};
-			size_t local[1] = {wg};
-			clStatus |= clEnqueueNDRangeKernel(
-									_context->clQueue,
-									_kernels[kid],
-									1,						// work_dim
-									0,						// global_work_offset
-									global,					// global_work_size
-									local,					// local_work_size
-									0, NULL, NULL);
-
-			// Sync
-			clStatus |= clEnqueueBarrier(_context->clQueue);
+			// The number of threads only depends on the kernel : so does the workgroup size
+			_kernelsLocalSize[kid] = min(_kernelsWorkgroupSize[kid], (size_t)nThreads);
+
+			Launch launch;
+			launch.kid = kid;
+			launch.inc = inc;
+			launch.dir = length << 1;
+			launch.global = nThreads;
+			_launches.push_back(launch);
 
 			if (ninc < 0) break; // done
 			inc >>= ninc;
 		}
     }
+
+	//---- Bind the arguments shared by all the launches
+	cl_int clStatus = 0;
+	for(int kid = 0; kid < NB_KERNELS; kid++)
+	{
+		if (_kernelsLocalSize[kid] == 0)
+			continue; // Not used for this size
+
+		unsigned int pId = 0;
+		clStatus |= clSetKernelArg(_kernels[kid], pId++, sizeof(cl_mem), (const void*)&_clBuffer_dataSet);
+		pId += 2; // INC and DIR : set by each launch
+		if (kid == PARALLEL_BITONIC_C4_KERNEL)
+			clStatus |= clSetKernelArg(_kernels[kid], pId++, 4 * _kernelsLocalSize[kid] * keyValueSize, 0);
+		clStatus |= clSetKernelArg(_kernels[kid], pId++, sizeof(unsigned int), (const void*)&_datasetSize);
+	}
+	checkCLStatus(clStatus);
+
+	_isBound = true;
 }
 
 #pragma endregion
@@ -228,88 +255,37 @@ void clppSort_BitonicSortGPU::pushDatas(void* dataSet, size_t datasetSize)
 {
 	cl_int clStatus;
 
-	//---- Store some values
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	//---- Use our own buffer (Allocated by the plan)
 	_dataSet = dataSet;
 	_dataSetOut = dataSet;
-	bool reallocate = datasetSize > _datasetSize || !_is_clBuffersOwner;
-	_datasetSize = datasetSize;
-
-	//---- Prepare some buffers
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_dataSet)
-		{
-			clReleaseMemObject(_clBuffer_dataSet);
-			//clReleaseMemObject(_clBuffer_dataSetOut);
-		}
-
-		//---- Copy on the device
-		if (_keysOnly)
-		{
-			_clBuffer_dataSet = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _keySize * _datasetSize, _dataSet, &clStatus);
-			checkCLStatus(clStatus);
+	setDataset(_clBuffer_ownedDataSet, datasetSize);
+	_is_clBuffersOwner = true;
 
-			//_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, _keySize * _datasetSize, NULL, &clStatus);
-			//checkCLStatus(clStatus);
-		}
-		else
-		{
-			_clBuffer_dataSet = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, (_valueSize+_keySize) * _datasetSize, _dataSet, &clStatus);
-			checkCLStatus(clStatus);
-
-			//_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, (_valueSize+_keySize) * _datasetSize, NULL, &clStatus);
-			//checkCLStatus(clStatus);
-		}
-
-		_is_clBuffersOwner = true;
-	}
-	else
-	{
-		// Just resend
-		if (_keysOnly)
-			clEnqueueWriteBuffer(_context->clQueue, _clBuffer_dataSet, CL_FALSE, 0, (_keySize) * _datasetSize, _dataSet, 0, 0, 0);
-		else
-			clEnqueueWriteBuffer(_context->clQueue, _clBuffer_dataSet, CL_FALSE, 0, (_valueSize+_keySize) * _datasetSize, _dataSet, 0, 0, 0);
-	}
+	//---- Copy on the device
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+	clStatus = enqueueWriteBuffer(_clBuffer_dataSet, elementSize * _datasetSize, _dataSet);
+	checkCLStatus(clStatus);
 }
 
 void clppSort_BitonicSortGPU::pushCLDatas(cl_mem clBuffer_dataSet, size_t datasetSize)
 {
-	cl_int clStatus;
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
 
+	setDataset(clBuffer_dataSet, datasetSize);
 	_is_clBuffersOwner = false;
+}
 
-	//---- Store some values
-	bool reallocate = datasetSize > _datasetSize;
-	_datasetSize = datasetSize;
-
-	//---- Prepare some buffers
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_dataSet)
-		{
-			clReleaseMemObject(_clBuffer_dataSet);
-			//clReleaseMemObject(_clBuffer_dataSetOut);
-		}
-
-		//---- Allocate
-		unsigned int numBlocks = roundUpDiv(_datasetSize, _workgroupSize * 4);
-	}
-
-	// ISSUE : We need 2 different buffers, but
-	// a) when using 32 bits sort(by example) the result buffer is _clBuffer_dataSet
-	// b) when using 28 bits sort(by example) the result buffer is _clBuffer_dataSetOut
-	// Without copy, how can we do to put the result in _clBuffer_dataSet when using 28 bits ?
+void clppSort_BitonicSortGPU::setDataset(cl_mem clBuffer_dataSet, size_t datasetSize)
+{
+	if (clBuffer_dataSet != _clBuffer_dataSet || datasetSize != _datasetSize)
+		_isBound = false;
 
 	_clBuffer_dataSet = clBuffer_dataSet;
-	
-	//if (_keysOnly)
-	//	_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, _keySize * _datasetSize, NULL, &clStatus);
-	//else
-	//	_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, (_valueSize+_keySize) * _datasetSize, NULL, &clStatus);
-	//checkCLStatus(clStatus);
+	_datasetSize = datasetSize;
 }
 
 #pragma endregion
@@ -328,11 +304,11 @@ void clppSort_BitonicSortGPU::popDatas(void* dataSet)
 
 	if (_keysOnly)
 	{
-		clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSet, CL_TRUE, 0, _keySize * _datasetSize, dataSet, 0, NULL, NULL);
+		enqueueReadBuffer(_clBuffer_dataSet, _keySize * _datasetSize, dataSet);
 	}
 	else
 	{
-		clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSet, CL_TRUE, 0, (_valueSize + _keySize) * _datasetSize, dataSet, 0, NULL, NULL);
+		enqueueReadBuffer(_clBuffer_dataSet, (_valueSize + _keySize) * _datasetSize, dataSet);
 	}
 }
 
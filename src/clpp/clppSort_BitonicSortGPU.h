@@ -23,20 +23,45 @@ public:
 	void popDatas();
 	void popDatas(void* dataSet);
 
+	// Asynchronous versions (Defined by clppSort)
+	using clppSort::sort;
+	using clppSort::pushDatas;
+	using clppSort::pushCLDatas;
+	using clppSort::popDatas;
+
 	string compilePreprocess(string kernel);
 
 private:
 	bool _keysOnly;			// Key-Values or Keys-only
-	size_t _datasetSize;	// The number of keys to sort
 
 	void* _dataSetOut;
 	cl_mem _clBuffer_dataSetOut;
 
 	//cl_kernel _kernel__BitonicSort;
 
+	// Owned kernels : the data set and the size are bound by 'bind'
 	std::vector<cl_kernel> _kernels;
+	std::vector<size_t> _kernelsWorkgroupSize;	// The maximum workgroup size of each kernel
+	std::vector<size_t> _kernelsLocalSize;		// The workgroup size used for the current data set
+
+	// The sequence of kernels to launch for the current data set
+	struct Launch
+	{
+		int kid;
+		int inc;
+		int dir;
+		size_t global;
+	};
+	std::vector<Launch> _launches;
+	bool _isBound;
 
 	size_t _workgroupSize;
+	unsigned int _maxElements;
+
+	cl_mem _clBuffer_ownedDataSet;		// Used by pushDatas
+
+	void setDataset(cl_mem clBuffer_dataSet, size_t datasetSize);
+	void bind();
 
 	bool _is_clBuffersOwner;
 };
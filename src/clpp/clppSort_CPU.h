@@ -20,6 +20,12 @@ public:
 	void popDatas();
 	void popDatas(void* dataSet) {}
 
+	// Asynchronous versions (Defined by clppSort)
+	using clppSort::sort;
+	using clppSort::pushDatas;
+	using clppSort::pushCLDatas;
+	using clppSort::popDatas;
+
 	void waitCompletion() {}
 };
 
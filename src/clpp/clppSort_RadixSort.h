@@ -20,33 +20,61 @@ public:
 	void popDatas();
 	void popDatas(void* dataSet);
 
+	// The passes ping-pong between the data set and the output buffer
+	cl_mem getSortedBuffer() { return _passes % 2 == 0 ? _clBuffer_dataSet : _clBuffer_dataSetOut; }
+
+	// Asynchronous versions (Defined by clppSort)
+	using clppSort::sort;
+	using clppSort::pushDatas;
+	using clppSort::pushCLDatas;
+	using clppSort::popDatas;
+
+	size_t getTempStorageBytes(size_t datasetSize);
+	void setTempStorage(cl_mem tempStorage, size_t offset = 0);
+
 	string compilePreprocess(string kernel);
 
 private:
 	bool _keysOnly;			// Key-Values or Keys-only
-	size_t _datasetSize;	// The number of keys to sort
 
 	void* _dataSetOut;
 	cl_mem _clBuffer_dataSetOut;
+	cl_mem _clBuffer_ownedDataSet;		// Used by pushDatas
 
-	cl_kernel _kernel_RadixLocalSort;
-	cl_kernel _kernel_LocalHistogram;
-	cl_kernel _kernel_RadixPermute;	
+	// One kernel of each per pass (Owned : their arguments are bound by 'bindPasses')
+	cl_kernel* _kernels_RadixLocalSort;
+	cl_kernel* _kernels_LocalHistogram;
+	cl_kernel* _kernels_RadixPermute;
+	bool _isBound;						// The kernel arguments are up to date
 
 	size_t _workgroupSize;
 
 	unsigned int _bits;
+	unsigned int _passes;				// 4 bits per pass
+	unsigned int _maxElements;
+
+	// The geometry, computed by 'bindPasses'
+	unsigned int _numBlocks;
+	size_t _globalWorkSize;
+
+	void setDataset(cl_mem clBuffer_dataSet, size_t datasetSize);
+	void bindPasses();
+	void radixLocal(unsigned int pass);
+	void localHistogram(unsigned int pass);
+	void radixPermute(unsigned int pass);
+
+	// The traffic of a pass, for the profiler : the data set, and the 2 histograms (16 digits per block)
+	size_t getPassBytes() { return (_keysOnly ? _keySize : (_valueSize+_keySize)) * _datasetSize; }
+	size_t getHistogramsBytes() { return 2 * 16 * _numBlocks * sizeof(int); }
 
-	void radixLocal(const size_t* global, const size_t* local, cl_mem* data, int bitOffset);
-	void localHistogram(const size_t* global, const size_t* local, cl_mem* data, cl_mem* hist, cl_mem* blockHists, int bitOffset);
-	void radixPermute(const size_t* global, const size_t* local, cl_mem* dataIn, cl_mem* dataOut, cl_mem* histScan, cl_mem* blockHists, int bitOffset, unsigned int numBlocks);
+	void allocateRadixMems(unsigned int elements);
 	void freeUpRadixMems();
 
 	clppScan* _scan;
 
 	cl_mem _clBuffer_radixHist1;
 	cl_mem _clBuffer_radixHist2;
-	cl_mem radixDataB;
+	unsigned int _radixMemsElements;	// The radix buffers are sized for this number of elements
 
 	bool _is_clBuffersOwner;
 };
@@ -1,10 +1,7 @@
-//#define BENCHMARK
 //#define TEST_STEPS
 #include "clpp/clppSort_RadixSortGPU.h"
 #include "clpp/clpp.h"
 
-#include "clpp/StopWatch.h"
-
 #include "clpp/clppScan_Default.h"
 
 #include "clpp/clppSort_RadixSortGPU_CLKernel.h"
@@ -13,6 +10,8 @@
 // 1 - Allow templating
 // 2 - Allow to sort on specific bits only
 
+inline int roundUpDiv(int A, int B) { return (A + B - 1) / (B); }
+
 #pragma region Constructor
 
 clppSort_RadixSortGPU::clppSort_RadixSortGPU(clppContext* context, unsigned int maxElements, unsigned int bits, bool keysOnly)
@@ -22,8 +21,19 @@ clppSort_RadixSortGPU::clppSort_RadixSortGPU(clppContext* context, unsigned int
 	_keySize = 4;
 	_clBuffer_dataSet = 0;
 	_clBuffer_dataSetOut = 0;
+	_clBuffer_ownedDataSet = 0;
+	_clBuffer_radixHist1 = 0;
+	_clBuffer_radixHist2 = 0;
+	_kernels_RadixLocalSort = 0;
+	_kernels_LocalHistogram = 0;
+	_kernels_RadixPermute = 0;
+	_scan = 0;
+	_maxElements = maxElements;
+	_radixMemsElements = 0;
+	_isBound = false;
 
 	_bits = bits;
+	_passes = (_bits + 3) / 4;
 
 	//if (!compile(context, string("clppSort_RadixSortGPU.cl")))
 	//	return;
@@ -31,46 +41,42 @@ clppSort_RadixSortGPU::clppSort_RadixSortGPU(clppContext* context, unsigned int
 	if (!compile(context, clCode_clppSort_RadixSortGPU))
 		return;
 
-	//---- Prepare all the kernels
-	cl_int clStatus;
-
-	_kernel_RadixLocalSort = clCreateKernel(_clProgram, "kernel__radixLocalSort", &clStatus);
-	checkCLStatus(clStatus);
-
-	_kernel_LocalHistogram = clCreateKernel(_clProgram, "kernel__localHistogram", &clStatus);
-	checkCLStatus(clStatus);
-
-	_kernel_RadixPermute = clCreateKernel(_clProgram, "kernel__radixPermute", &clStatus);
-	checkCLStatus(clStatus);
+	//---- Prepare all the kernels : one set per pass, the arguments are bound once by 'bindPasses'
+	_kernels_RadixLocalSort = new cl_kernel[_passes];
+	_kernels_LocalHistogram = new cl_kernel[_passes];
+	_kernels_RadixPermute = new cl_kernel[_passes];
+	for(unsigned int pass = 0; pass < _passes; pass++)
+	{
+		_kernels_RadixLocalSort[pass] = createKernel("kernel__radixLocalSort");
+		_kernels_LocalHistogram[pass] = createKernel("kernel__localHistogram");
+		_kernels_RadixPermute[pass] = createKernel("kernel__radixPermute");
+	}
 
 	//---- Get the workgroup size
 	//clGetKernelWorkGroupInfo(_kernel_RadixLocalSort, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &_workgroupSize, 0);
 	_workgroupSize = 32;
 
-	_scan = clpp::createBestScan(context, sizeof(int), maxElements);
+	// The histograms : 16 values per block
+	_scan = clpp::createBestScan(context, sizeof(int), 16 * roundUpDiv(maxElements, _workgroupSize * 4));
+
+	//---- The plan : allocate the buffers for maxElements
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+	_clBuffer_ownedDataSet = allocateBuffer(elementSize * maxElements);
+	allocateRadixMems(maxElements);
 
-    _clBuffer_radixHist1 = NULL;
-    _clBuffer_radixHist2 = NULL;
 	_datasetSize = 0;
 	_is_clBuffersOwner = false;
 }
 
 clppSort_RadixSortGPU::~clppSort_RadixSortGPU()
 {
-	if (_is_clBuffersOwner)
-	{
-		if (_clBuffer_dataSet)
-			clReleaseMemObject(_clBuffer_dataSet);
-	}
+	releaseBuffer(_clBuffer_ownedDataSet);
 
-	if (_clBuffer_dataSetOut)
-		clReleaseMemObject(_clBuffer_dataSetOut);
+	freeUpRadixMems();
 
-	if (_clBuffer_radixHist1)
-		clReleaseMemObject(_clBuffer_radixHist1);
-
-	if (_clBuffer_radixHist2)
-		clReleaseMemObject(_clBuffer_radixHist2);
+	delete [] _kernels_RadixLocalSort;
+	delete [] _kernels_LocalHistogram;
+	delete [] _kernels_RadixPermute;
 
 	delete _scan;
 }
@@ -108,79 +114,37 @@ string clppSort_RadixSortGPU::compilePreprocess(string kernel)
 
 #pragma region sort
 
-inline int roundUpDiv(int A, int B) { return (A + B - 1) / (B); }
-
 void clppSort_RadixSortGPU::sort()
 {
 	// Satish et al. empirically set b = 4. The size of a work-group is in hundreds of
 	// work-items, depending on the concrete device and each work-item processes more than one
 	// stream element, usually 4, in order to hide latencies.
 
-	StopWatch sw;
+	//---- Nothing to sort (And no empty launch)
+	if (_datasetSize == 0)
+		return;
 
-	cl_int clStatus;
-    unsigned int numBlocks = roundUpDiv(_datasetSize, _workgroupSize * 4);
-	unsigned int Ndiv4 = roundUpDiv(_datasetSize, 4);
+	if (!_isBound)
+		bindPasses();
 
-	size_t global[1] = {toMultipleOf(Ndiv4, _workgroupSize)};
-    size_t local[1] = {_workgroupSize};
+	// The same histograms are scanned by every pass
+	_scan->pushCLDatas(_clBuffer_radixHist1, 16 * _numBlocks);
 
-	cl_mem dataA = _clBuffer_dataSet;
-    cl_mem dataB = _clBuffer_dataSetOut;
-    for(unsigned int bitOffset = 0; bitOffset < _bits; bitOffset += 4)
+    for(unsigned int pass = 0; pass < _passes; pass++)
 	{
 		// 1) Each workgroup sorts its tile by using local memory
 		// 2) Create an histogram of d=2^b digits entries
-#ifdef BENCHMARK
-		sw.StartTimer();
-#endif
-
-        radixLocal(global, local, dataA, _clBuffer_radixHist1, _clBuffer_radixHist2, bitOffset);
+        radixLocal(pass);
+        localHistogram(pass);
 
-#ifdef BENCHMARK
-		sw.StopTimer();
-		cout << "Local sort       " << sw.GetElapsedTime() << endl;
-
-		sw.StartTimer();
-#endif
-
-        localHistogram(global, local, dataA, _clBuffer_radixHist1, _clBuffer_radixHist2, bitOffset);
-
-#ifdef BENCHMARK
-		sw.StopTimer();
-		cout << "Local histogram  " << sw.GetElapsedTime() << endl;
-
-		//**********
-		//clEnqueueReadBuffer(_context->clQueue, dataA, CL_TRUE, 0, sizeof(int) * _datasetSize, _dataSetOut, 0, NULL, NULL);
-		//**********
-		
 		// 3) Scan the p*2^b = p*(16) entry histogram table. Stored in column-major order, computes global digit offsets.
-		sw.StartTimer();
-#endif
-
-		_scan->pushCLDatas(_clBuffer_radixHist1, 16 * numBlocks);
 		_scan->scan();
 
-#ifdef BENCHMARK
-		_scan->waitCompletion();
-		sw.StopTimer();
-		cout << "Global scan      " << sw.GetElapsedTime() << endl;
-        
 		// 4) Prefix sum results are used to scatter each work-group's elements to their correct position.
-		sw.StartTimer();
-#endif
-
-		radixPermute(global, local, dataA, dataB, _clBuffer_radixHist1, _clBuffer_radixHist2, bitOffset, numBlocks);
-
-#ifdef BENCHMARK
-		sw.StopTimer();
-		cout << "Global reorder   " << sw.GetElapsedTime() << endl;
-#endif
-
-        std::swap(dataA, dataB);
+		radixPermute(pass);
     }
 
-	//if ((_bits/4) % 2 == 0)
+	//if (_passes % 2 == 0)
 		//clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSet, CL_TRUE, 0, sizeof(int) * _datasetSize, _dataSet, 0, NULL, NULL);
 	//else
 		//clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSetOut, CL_TRUE, 0, sizeof(int) * _datasetSize, _dataSet, 0, NULL, NULL);
@@ -208,64 +172,84 @@ void clppSort_RadixSortGPU::sort()
 #endif
 }
 
-void clppSort_RadixSortGPU::radixLocal(const size_t* global, const size_t* local, cl_mem data, cl_mem hist, cl_mem blockHists, int bitOffset)
+// Bind the arguments of the passes : only when the data set size or the buffers have changed.
+// The passes ping-pong between the data set and the output buffer.
+void clppSort_RadixSortGPU::bindPasses()
 {
-    cl_int clStatus;
-    unsigned int a = 0;
+	cl_int clStatus = CL_SUCCESS;
 
-	int workgroupSize = 128;
+	//---- The geometry
+	_numBlocks = roundUpDiv(_datasetSize, _workgroupSize * 4);
+	unsigned int Ndiv4 = roundUpDiv(_datasetSize, 4); // Each work item handle 4 entries
+	_globalWorkSize = toMultipleOf(Ndiv4, _workgroupSize);
+	_globalWorkSize_128 = toMultipleOf(Ndiv4, 128);
 
-	unsigned int Ndiv = roundUpDiv(_datasetSize, 4); // Each work item handle 4 entries
-	size_t global_128[1] = {toMultipleOf(Ndiv, workgroupSize)};
-	size_t local_128[1] = {workgroupSize};
+	cl_mem dataA = _clBuffer_dataSet;
+	cl_mem dataB = _clBuffer_dataSetOut;
+	for(unsigned int pass = 0; pass < _passes; pass++)
+	{
+		int bitOffset = pass * 4;
 
-	/*if (_keysOnly)
-		clStatus  = clSetKernelArg(_kernel_RadixLocalSort, a++, _keySize * 2 * 4 * workgroupSize, (const void*)NULL);
-	else
-		clStatus  = clSetKernelArg(_kernel_RadixLocalSort, a++, (_valueSize+_keySize) * 2 * 4 * workgroupSize, (const void*)NULL);// 2 KV array of 128 items (2 for permutations)*/
-    clStatus = clSetKernelArg(_kernel_RadixLocalSort, a++, sizeof(cl_mem), (const void*)&data);
-    clStatus |= clSetKernelArg(_kernel_RadixLocalSort, a++, sizeof(int), (const void*)&bitOffset);
-    clStatus |= clSetKernelArg(_kernel_RadixLocalSort, a++, sizeof(unsigned int), (const void*)&_datasetSize);
-	clStatus |= clEnqueueNDRangeKernel(_context->clQueue, _kernel_RadixLocalSort, 1, NULL, global_128, local_128, 0, NULL, NULL);
-
-#ifdef BENCHMARK
-    clStatus |= clFinish(_context->clQueue);
-    checkCLStatus(clStatus);	
-#endif
+		/*if (_keysOnly)
+			clStatus  = clSetKernelArg(_kernel_RadixLocalSort, a++, _keySize * 2 * 4 * workgroupSize, (const void*)NULL);
+		else
+			clStatus  = clSetKernelArg(_kernel_RadixLocalSort, a++, (_valueSize+_keySize) * 2 * 4 * workgroupSize, (const void*)NULL);// 2 KV array of 128 items (2 for permutations)*/
+		clStatus |= clSetKernelArg(_kernels_RadixLocalSort[pass], 0, sizeof(cl_mem), (const void*)&dataA);
+		clStatus |= clSetKernelArg(_kernels_RadixLocalSort[pass], 1, sizeof(int), (const void*)&bitOffset);
+		clStatus |= clSetKernelArg(_kernels_RadixLocalSort[pass], 2, sizeof(unsigned int), (const void*)&_datasetSize);
+
+		clStatus |= clSetKernelArg(_kernels_LocalHistogram[pass], 0, sizeof(cl_mem), (const void*)&dataA);
+		clStatus |= clSetKernelArg(_kernels_LocalHistogram[pass], 1, sizeof(int), (const void*)&bitOffset);
+		clStatus |= clSetKernelArg(_kernels_LocalHistogram[pass], 2, sizeof(cl_mem), (const void*)&_clBuffer_radixHist1);
+		clStatus |= clSetKernelArg(_kernels_LocalHistogram[pass], 3, sizeof(cl_mem), (const void*)&_clBuffer_radixHist2);
+		clStatus |= clSetKernelArg(_kernels_LocalHistogram[pass], 4, sizeof(unsigned int), (const void*)&_datasetSize);
+
+		clStatus |= clSetKernelArg(_kernels_RadixPermute[pass], 0, sizeof(cl_mem), (const void*)&dataA);
+		clStatus |= clSetKernelArg(_kernels_RadixPermute[pass], 1, sizeof(cl_mem), (const void*)&dataB);
+		clStatus |= clSetKernelArg(_kernels_RadixPermute[pass], 2, sizeof(cl_mem), (const void*)&_clBuffer_radixHist1);
+		clStatus |= clSetKernelArg(_kernels_RadixPermute[pass], 3, sizeof(cl_mem), (const void*)&_clBuffer_radixHist2);
+		clStatus |= clSetKernelArg(_kernels_RadixPermute[pass], 4, sizeof(int), (const void*)&bitOffset);
+		clStatus |= clSetKernelArg(_kernels_RadixPermute[pass], 5, sizeof(unsigned int), (const void*)&_datasetSize);
+		clStatus |= clSetKernelArg(_kernels_RadixPermute[pass], 6, sizeof(unsigned int), (const void*)&_numBlocks);
+
+		std::swap(dataA, dataB);
+	}
+	checkCLStatus(clStatus);
+
+	_isBound = true;
 }
 
-void clppSort_RadixSortGPU::localHistogram(const size_t* global, const size_t* local, cl_mem data, cl_mem hist, cl_mem blockHists, int bitOffset)
+void clppSort_RadixSortGPU::radixLocal(unsigned int pass)
+{
+    cl_int clStatus;
+
+	size_t global_128[1] = {_globalWorkSize_128};
+	size_t local_128[1] = {128};
+
+	clStatus = enqueueKernel(_kernels_RadixLocalSort[pass], 1, global_128, local_128, "Local sort", 2 * getPassBytes());
+	checkCLStatus(clStatus);
+}
+
+void clppSort_RadixSortGPU::localHistogram(unsigned int pass)
 {
 	cl_int clStatus;
-	clStatus = clSetKernelArg(_kernel_LocalHistogram, 0, sizeof(cl_mem), (const void*)&data);
-	clStatus |= clSetKernelArg(_kernel_LocalHistogram, 1, sizeof(int), (const void*)&bitOffset);
-	clStatus |= clSetKernelArg(_kernel_LocalHistogram, 2, sizeof(cl_mem), (const void*)&hist);
-	clStatus |= clSetKernelArg(_kernel_LocalHistogram, 3, sizeof(cl_mem), (const void*)&blockHists);
-	clStatus |= clSetKernelArg(_kernel_LocalHistogram, 4, sizeof(unsigned int), (const void*)&_datasetSize);
-	clStatus |= clEnqueueNDRangeKernel(_context->clQueue, _kernel_LocalHistogram, 1, NULL, global, local, 0, NULL, NULL);	
-
-#ifdef BENCHMARK
-    clStatus |= clFinish(_context->clQueue);
-    checkCLStatus(clStatus);
-#endif
+
+	size_t global[1] = {_globalWorkSize};
+	size_t local[1] = {_workgroupSize};
+
+	clStatus = enqueueKernel(_kernels_LocalHistogram[pass], 1, global, local, "Local histogram", getPassBytes() + getHistogramsBytes());
+	checkCLStatus(clStatus);
 }
 
-void clppSort_RadixSortGPU::radixPermute(const size_t* global, const size_t* local, cl_mem dataIn, cl_mem dataOut, cl_mem histScan, cl_mem blockHists, int bitOffset, unsigned int numBlocks)
+void clppSort_RadixSortGPU::radixPermute(unsigned int pass)
 {
     cl_int clStatus;
-    clStatus  = clSetKernelArg(_kernel_RadixPermute, 0, sizeof(cl_mem), (const void*)&dataIn);
-    clStatus |= clSetKernelArg(_kernel_RadixPermute, 1, sizeof(cl_mem), (const void*)&dataOut);
-    clStatus |= clSetKernelArg(_kernel_RadixPermute, 2, sizeof(cl_mem), (const void*)&histScan);
-    clStatus |= clSetKernelArg(_kernel_RadixPermute, 3, sizeof(cl_mem), (const void*)&blockHists);
-    clStatus |= clSetKernelArg(_kernel_RadixPermute, 4, sizeof(int), (const void*)&bitOffset);
-    clStatus |= clSetKernelArg(_kernel_RadixPermute, 5, sizeof(unsigned int), (const void*)&_datasetSize);
-	clStatus |= clSetKernelArg(_kernel_RadixPermute, 6, sizeof(unsigned int), (const void*)&numBlocks);
-    clStatus |= clEnqueueNDRangeKernel(_context->clQueue, _kernel_RadixPermute, 1, NULL, global, local, 0, NULL, NULL);
-
-#ifdef BENCHMARK
-    clStatus |= clFinish(_context->clQueue);
-    checkCLStatus(clStatus);
-#endif
+
+	size_t global[1] = {_globalWorkSize};
+	size_t local[1] = {_workgroupSize};
+
+    clStatus = enqueueKernel(_kernels_RadixPermute[pass], 1, global, local, "Permute", 2 * getPassBytes() + 2 * getHistogramsBytes());
+	checkCLStatus(clStatus);
 }
 
 #pragma endregion
@@ -276,113 +260,110 @@ void clppSort_RadixSortGPU::pushDatas(void* dataSet, size_t datasetSize)
 {
 	cl_int clStatus;
 
-	//---- Store some values
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	//---- Use our own buffer (Allocated by the plan)
 	_dataSet = dataSet;
 	_dataSetOut = dataSet;
-	bool reallocate = datasetSize > _datasetSize || !_is_clBuffersOwner;
-	_datasetSize = datasetSize;
-
-	//---- Prepare some buffers
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_dataSet)
-		{
-			clReleaseMemObject(_clBuffer_dataSet);
-			clReleaseMemObject(_clBuffer_dataSetOut);
-			clReleaseMemObject(_clBuffer_radixHist1);
-			clReleaseMemObject(_clBuffer_radixHist2);
-		}
-
-		//---- Allocate
-		unsigned int numBlocks = roundUpDiv(_datasetSize, _workgroupSize * 4);
-	    
-		// histogram : 16 values per block
-		_clBuffer_radixHist1 = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, sizeof(int) * 16 * numBlocks, NULL, &clStatus);
-		checkCLStatus(clStatus);
-
-		// histogram : 16 values per block
-		_clBuffer_radixHist2 = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, sizeof(int) * 16 * numBlocks, NULL, &clStatus);
-		checkCLStatus(clStatus);
-
-		//---- Copy on the device
-		if (_keysOnly)
-		{
-			_clBuffer_dataSet = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _keySize * _datasetSize, _dataSet, &clStatus);
-			checkCLStatus(clStatus);
-
-			_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, _keySize * _datasetSize, NULL, &clStatus);
-			checkCLStatus(clStatus);
-		}
-		else
-		{
-			_clBuffer_dataSet = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, (_valueSize+_keySize) * _datasetSize, _dataSet, &clStatus);
-			checkCLStatus(clStatus);
+	setDataset(_clBuffer_ownedDataSet, datasetSize);
+	_is_clBuffersOwner = true;
 
-			_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, (_valueSize+_keySize) * _datasetSize, NULL, &clStatus);
-			checkCLStatus(clStatus);
-		}
-
-		_is_clBuffersOwner = true;
-	}
-	else
-	{
-		// Just resend
-		if (_keysOnly)
-			clEnqueueWriteBuffer(_context->clQueue, _clBuffer_dataSet, CL_FALSE, 0, _keySize * _datasetSize, _dataSet, 0, 0, 0);
-		else
-			clEnqueueWriteBuffer(_context->clQueue, _clBuffer_dataSet, CL_FALSE, 0, (_valueSize+_keySize) * _datasetSize, _dataSet, 0, 0, 0);
-	}
+	//---- Copy on the device
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+	clStatus = enqueueWriteBuffer(_clBuffer_dataSet, elementSize * _datasetSize, _dataSet);
+	checkCLStatus(clStatus);
 }
 
 void clppSort_RadixSortGPU::pushCLDatas(cl_mem clBuffer_dataSet, size_t datasetSize)
 {
-	cl_int clStatus;
-
-	_is_clBuffersOwner = false;
-
-	//---- Store some values
-	bool reallocate = datasetSize > _datasetSize;
-	_datasetSize = datasetSize;
-
-	//---- Prepare some buffers
-	if (reallocate)
-	{
-		//---- Release
-		if (_clBuffer_dataSet)
-		{
-			clReleaseMemObject(_clBuffer_dataSet);
-			clReleaseMemObject(_clBuffer_dataSetOut);
-			clReleaseMemObject(_clBuffer_radixHist1);
-			clReleaseMemObject(_clBuffer_radixHist2);
-		}
-
-		//---- Allocate
-		unsigned int numBlocks = roundUpDiv(_datasetSize, _workgroupSize * 4);
-	    
-		// column size = 2^b = 16
-
-		// histogram : 16 values per block
-		_clBuffer_radixHist1 = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, sizeof(int) * 16 * numBlocks, NULL, &clStatus);
-		checkCLStatus(clStatus);
-
-		// histogram : 16 values per block
-		_clBuffer_radixHist2 = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, sizeof(int) * 16 * numBlocks, NULL, &clStatus);
-		checkCLStatus(clStatus);
-	}
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
 
 	// ISSUE : We need 2 different buffers, but
 	// a) when using 32 bits sort(by example) the result buffer is _clBuffer_dataSet
 	// b) when using 28 bits sort(by example) the result buffer is _clBuffer_dataSetOut
 	// Without copy, how can we do to put the result in _clBuffer_dataSet when using 28 bits ?
 
+	setDataset(clBuffer_dataSet, datasetSize);
+	_is_clBuffersOwner = false;
+}
+
+void clppSort_RadixSortGPU::setDataset(cl_mem clBuffer_dataSet, size_t datasetSize)
+{
+	if (clBuffer_dataSet != _clBuffer_dataSet || datasetSize != _datasetSize)
+		_isBound = false;
+
 	_clBuffer_dataSet = clBuffer_dataSet;
-	
-	if (_keysOnly)
-		_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, _keySize * _datasetSize, NULL, &clStatus);
+	_datasetSize = datasetSize;
+
+	//---- The temporary storage is sized for the data set
+	if (_datasetSize > _radixMemsElements)
+		allocateRadixMems(_datasetSize);
+}
+
+// The output buffer and the histograms (16 values per block) : from the pool or the temporary storage
+void clppSort_RadixSortGPU::allocateRadixMems(unsigned int elements)
+{
+	freeUpRadixMems();
+
+	unsigned int numBlocks = roundUpDiv(elements, _workgroupSize * 4);
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+
+	size_t scratchOffset = 0;
+	_clBuffer_dataSetOut = allocateScratch(elementSize * elements, scratchOffset);
+	_clBuffer_radixHist1 = allocateScratch(sizeof(int) * 16 * numBlocks, scratchOffset);
+	_clBuffer_radixHist2 = allocateScratch(sizeof(int) * 16 * numBlocks, scratchOffset);
+
+	// The scan of the histograms uses the rest of the temporary storage
+	if (_tempStorage)
+		_scan->setTempStorage(_tempStorage, _tempStorageOffset + scratchOffset);
+
+	_radixMemsElements = elements;
+	_isBound = false;
+}
+
+void clppSort_RadixSortGPU::freeUpRadixMems()
+{
+	releaseScratch(_clBuffer_dataSetOut);
+	releaseScratch(_clBuffer_radixHist1);
+	releaseScratch(_clBuffer_radixHist2);
+
+	_radixMemsElements = 0;
+}
+
+#pragma endregion
+
+#pragma region Temporary storage
+
+size_t clppSort_RadixSortGPU::getTempStorageBytes(size_t datasetSize)
+{
+	unsigned int numBlocks = roundUpDiv(datasetSize, _workgroupSize * 4);
+	size_t elementSize = _keysOnly ? _keySize : (_valueSize+_keySize);
+
+	return
+		getScratchBytes(elementSize * datasetSize) +
+		getScratchBytes(sizeof(int) * 16 * numBlocks) * 2 +
+		_scan->getTempStorageBytes(16 * numBlocks);
+}
+
+void clppSort_RadixSortGPU::setTempStorage(cl_mem tempStorage, size_t offset)
+{
+	clppSort::setTempStorage(tempStorage, offset);
+
+	// Without temporary storage, the internal buffers are sized for maxElements
+	if (_tempStorage)
+	{
+		if (_datasetSize > 0)
+			allocateRadixMems(_datasetSize);
+		else
+			freeUpRadixMems();
+	}
 	else
-		_clBuffer_dataSetOut = clCreateBuffer(_context->clContext, CL_MEM_READ_WRITE, (_valueSize+_keySize) * _datasetSize, NULL, &clStatus);
-	checkCLStatus(clStatus);
+	{
+		_scan->setTempStorage(0);
+		allocateRadixMems(_maxElements);
+	}
 }
 
 #pragma endregion
@@ -398,17 +379,17 @@ void clppSort_RadixSortGPU::popDatas(void* dataSet)
 {
 	if (_keysOnly)
 	{
-		if ((_bits/4) % 2 == 0)
-			clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSet, CL_TRUE, 0, _keySize * _datasetSize, dataSet, 0, NULL, NULL);
+		if (_passes % 2 == 0)
+			enqueueReadBuffer(_clBuffer_dataSet, _keySize * _datasetSize, dataSet);
 		else
-			clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSetOut, CL_TRUE, 0, _keySize * _datasetSize, dataSet, 0, NULL, NULL);
+			enqueueReadBuffer(_clBuffer_dataSetOut, _keySize * _datasetSize, dataSet);
 	}
 	else
 	{
-		if ((_bits/4) % 2 == 0)
-			clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSet, CL_TRUE, 0, (_valueSize + _keySize) * _datasetSize, dataSet, 0, NULL, NULL);
+		if (_passes % 2 == 0)
+			enqueueReadBuffer(_clBuffer_dataSet, (_valueSize + _keySize) * _datasetSize, dataSet);
 		else
-			clEnqueueReadBuffer(_context->clQueue, _clBuffer_dataSetOut, CL_TRUE, 0, (_valueSize + _keySize) * _datasetSize, dataSet, 0, NULL, NULL);
+			enqueueReadBuffer(_clBuffer_dataSetOut, (_valueSize + _keySize) * _datasetSize, dataSet);
 	}
 }
 
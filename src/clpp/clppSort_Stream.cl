@@ -0,0 +1,74 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// Merge the sorted runs of the streaming sort on the device, before a single download.
+//
+// Algorithm :
+// -----------
+// Each pass merges the pairs of adjacent runs (A, B) into runs twice longer. Each work-item moves one element
+// to its rank in the merged run : its index in its own run, plus the number of elements of the other run that
+// go before it (A binary search). The merge is stable : on equal keys the elements of A go first.
+//
+// The keys are masked : only the sorted bits are compared.
+//------------------------------------------------------------
+
+// KV_TYPE, KEY(element) and KEY_MASK are defined by clppSort_Stream
+
+//------------------------------------------------------------
+// kernel__MergeRuns
+//
+// Purpose : Merge the pairs of adjacent sorted runs of 'runSize' elements. (The last run can be shorter)
+//------------------------------------------------------------
+
+__kernel
+void kernel__MergeRuns(
+	__global const KV_TYPE* input,
+	__global KV_TYPE* output,
+	const uint runSize,
+	const uint size)
+{
+	const uint i = get_global_id(0);
+	if (i >= size)
+		return;
+
+	// The pair of runs of the element
+	const uint run = i / runSize;
+	const uint aStart = (run & ~1u) * runSize;
+	const uint bStart = min(aStart + runSize, size);
+	const uint bEnd = min(bStart + runSize, size);
+
+	const KV_TYPE element = input[i];
+	const uint key = KEY(element) & KEY_MASK;
+
+	uint rank;
+	if (run & 1)
+	{
+		// In B : the elements of A with a key lower or equal go before (Upper bound)
+		uint lo = aStart, hi = bStart;
+		while (lo < hi)
+		{
+			uint mid = (lo + hi) / 2;
+			if ((KEY(input[mid]) & KEY_MASK) <= key)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		rank = (i - bStart) + (lo - aStart);
+	}
+	else
+	{
+		// In A : the elements of B with a lower key go before (Lower bound)
+		uint lo = bStart, hi = bEnd;
+		while (lo < hi)
+		{
+			uint mid = (lo + hi) / 2;
+			if ((KEY(input[mid]) & KEY_MASK) < key)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		rank = (i - aStart) + (lo - bStart);
+	}
+
+	output[aStart + rank] = element;
+}
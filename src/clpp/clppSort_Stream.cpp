@@ -0,0 +1,250 @@
+#include "clpp/clppSort_Stream.h"
+
+#include "clpp/clppSort_RadixSort.h"
+#include "clpp/clppSort_RadixSortGPU.h"
+
+#include "clpp/clppSort_Stream_CLKernel.h"
+
+#include <sstream>
+
+#pragma region Constructor
+
+clppSort_Stream::clppSort_Stream(clppContext* context, unsigned int maxElements, unsigned int bits, bool keysOnly, unsigned int lanes, unsigned int chunkElements)
+{
+	_context = context;
+	_keysOnly = keysOnly;
+	_valueSize = 4;
+	_keySize = 4;
+	_bits = bits;
+	_keyMask = bits >= 32 ? 0xFFFFFFFF : (1u << bits) - 1;
+	_maxElements = maxElements;
+	_datasetSize = 0;
+	_dataSet = 0;
+	_dataSetOut = 0;
+	_clBuffer_dataSet = 0;
+	_clBuffer_runs = 0;
+	_clBuffer_merged = 0;
+	_clBuffer_sorted = 0;
+	_kernel_MergeRuns = 0;
+	_chunksCount = 0;
+
+	_chunkElements = min((size_t)chunkElements, (size_t)maxElements);
+	if (_chunkElements < 1)
+		_chunkElements = 1;
+
+	_lanesCount = 0;
+	_lanes = 0;
+
+	if (!compile(context, clCode_clppSort_Stream))
+		return;
+
+	_kernel_MergeRuns = createKernel("kernel__MergeRuns");
+
+	//---- Create the lanes, each one has its own queue
+	cl_int clStatus;
+	cl_command_queue_properties properties = 0;
+	clGetCommandQueueInfo(context->clQueue, CL_QUEUE_PROPERTIES, sizeof(cl_command_queue_properties), &properties, 0);
+
+	_lanesCount = max(lanes, 1u);
+	_lanes = new Lane[_lanesCount];
+
+	size_t elementSize = _keysOnly ? _keySize : (_keySize + _valueSize);
+	for(unsigned int i = 0; i < _lanesCount; i++)
+	{
+		Lane& lane = _lanes[i];
+		cl_command_queue queue = clCreateCommandQueue(context->clContext, context->clDevice, properties, &clStatus);
+		checkCLStatus(clStatus);
+		lane.context = new clppContext(*context, queue);
+
+		if (context->isGPU)
+			lane.sort = new clppSort_RadixSortGPU(lane.context, _chunkElements, bits, keysOnly);
+		else
+			lane.sort = new clppSort_RadixSort(lane.context, _chunkElements, bits, keysOnly);
+
+		lane.clBuffer_chunk = allocateBuffer(elementSize * _chunkElements);
+		lane.chunkSize = 0;
+	}
+
+	//---- The sorted runs and their merge
+	_clBuffer_runs = allocateBuffer(elementSize * _maxElements);
+	_clBuffer_merged = allocateBuffer(elementSize * _maxElements);
+}
+
+clppSort_Stream::~clppSort_Stream()
+{
+	for(unsigned int i = 0; i < _lanesCount; i++)
+	{
+		delete _lanes[i].sort;
+		releaseBuffer(_lanes[i].clBuffer_chunk);
+		clReleaseCommandQueue(_lanes[i].context->clQueue);
+		delete _lanes[i].context;
+	}
+	delete [] _lanes;
+
+	releaseBuffer(_clBuffer_runs);
+	releaseBuffer(_clBuffer_merged);
+}
+
+#pragma endregion
+
+#pragma region compilePreprocess
+
+string clppSort_Stream::compilePreprocess(string kernel)
+{
+	ostringstream lines;
+	lines << "#define KV_TYPE " << (_keysOnly ? "uint" : "uint2") << endl;
+	lines << "#define KEY(E) " << (_keysOnly ? "(E)" : "((E).x)") << endl;
+	lines << "#define KEY_MASK " << _keyMask << "u" << endl;
+
+	return clppSort::compilePreprocess(lines.str() + kernel);
+}
+
+#pragma endregion
+
+#pragma region sort
+
+void clppSort_Stream::sort()
+{
+	cl_int clStatus;
+	size_t elementSize = _keysOnly ? _keySize : (_keySize + _valueSize);
+
+	vector<cl_event> chunkEvents;
+
+	_chunksCount = (_datasetSize + _chunkElements - 1) / _chunkElements;
+	for(size_t c = 0; c < _chunksCount; c++)
+	{
+		Lane& lane = _lanes[c % _lanesCount];
+		size_t offset = c * _chunkElements;
+		size_t chunkSize = min(_chunkElements, _datasetSize - offset);
+
+		//---- Upload : the first chunk of each lane waits for our wait-list
+		bool waits = c < _lanesCount && _waitList.size() > 0;
+		cl_event uploadEvent = 0;
+		clStatus = clEnqueueWriteBuffer(lane.context->clQueue, lane.clBuffer_chunk, CL_FALSE, 0, elementSize * chunkSize, (unsigned char*)_dataSet + elementSize * offset,
+			waits ? (cl_uint)_waitList.size() : 0, waits ? &_waitList[0] : NULL, isProfiling() ? &uploadEvent : NULL);
+		checkCLStatus(clStatus);
+
+		if (uploadEvent)
+		{
+			profileEvent("Write chunk", uploadEvent, elementSize * chunkSize);
+			clReleaseEvent(uploadEvent);
+		}
+
+		//---- Sort
+		if (lane.chunkSize != chunkSize)
+		{
+			lane.sort->pushCLDatas(lane.clBuffer_chunk, chunkSize);
+			lane.chunkSize = chunkSize;
+		}
+		lane.sort->sort();
+
+		//---- Copy the sorted run on the device, the merge waits for it
+		cl_event event;
+		clStatus = clEnqueueCopyBuffer(lane.context->clQueue, lane.sort->getSortedBuffer(), _clBuffer_runs, 0, elementSize * offset, elementSize * chunkSize, 0, NULL, &event);
+		checkCLStatus(clStatus);
+		chunkEvents.push_back(event);
+
+		// Start the lane now, the next chunks go to the other lanes
+		clFlush(lane.context->clQueue);
+	}
+	waitListConsumed();
+
+	//---- The next command of the main queue waits for all the runs
+	if (chunkEvents.size() > 0)
+	{
+		setWaitList((cl_uint)chunkEvents.size(), &chunkEvents[0]);
+		for(size_t i = 0; i < chunkEvents.size(); i++)
+			clReleaseEvent(chunkEvents[i]);
+	}
+
+	merge();
+}
+
+#pragma endregion
+
+#pragma region pushDatas
+
+void clppSort_Stream::pushDatas(void* dataSet, size_t datasetSize)
+{
+	if (!checkDatasetSize(datasetSize, _maxElements))
+		return;
+
+	_dataSet = dataSet;
+	_dataSetOut = dataSet;
+	_datasetSize = datasetSize;
+}
+
+void clppSort_Stream::pushCLDatas(cl_mem /*clBuffer_dataSet*/, size_t datasetSize)
+{
+	printf("Error: %s : the data set (%u elements) must be on the host side (pushDatas), use a device sort instead\n", getName().c_str(), (unsigned int)datasetSize);
+
+	//---- Nothing to sort
+	_dataSet = 0;
+	_dataSetOut = 0;
+	_datasetSize = 0;
+	_chunksCount = 0;
+}
+
+#pragma endregion
+
+#pragma region popDatas
+
+void clppSort_Stream::popDatas()
+{
+	popDatas(_dataSetOut);
+}
+
+void clppSort_Stream::popDatas(void* dataSet)
+{
+	if (_datasetSize == 0)
+		return;
+
+	size_t elementSize = _keysOnly ? _keySize : (_keySize + _valueSize);
+	cl_int clStatus = enqueueReadBuffer(_clBuffer_sorted, elementSize * _datasetSize, dataSet);
+	checkCLStatus(clStatus);
+}
+
+void clppSort_Stream::waitCompletion()
+{
+	cl_ulong hostStart = clppProfiler::getHostTime();
+	for(unsigned int i = 0; i < _lanesCount; i++)
+		clFinish(_lanes[i].context->clQueue);
+	clFinish(_context->clQueue);
+	profileHost("Wait", hostStart);
+}
+
+#pragma endregion
+
+#pragma region merge
+
+// Merge the sorted runs, pass after pass (Stable : on equal keys the first run wins)
+void clppSort_Stream::merge()
+{
+	cl_int clStatus;
+	size_t elementSize = _keysOnly ? _keySize : (_keySize + _valueSize);
+
+	cl_mem input = _clBuffer_runs;
+	cl_mem output = _clBuffer_merged;
+
+	unsigned int size = (unsigned int)_datasetSize;
+	for(size_t runSize = _chunkElements; runSize < _datasetSize; runSize *= 2)
+	{
+		unsigned int runSizeArg = (unsigned int)runSize;
+
+		clStatus  = clSetKernelArg(_kernel_MergeRuns, 0, sizeof(cl_mem), &input);
+		clStatus |= clSetKernelArg(_kernel_MergeRuns, 1, sizeof(cl_mem), &output);
+		clStatus |= clSetKernelArg(_kernel_MergeRuns, 2, sizeof(unsigned int), &runSizeArg);
+		clStatus |= clSetKernelArg(_kernel_MergeRuns, 3, sizeof(unsigned int), &size);
+		checkCLStatus(clStatus);
+
+		size_t globalWorkSize = _datasetSize;
+		clStatus = enqueueKernel(_kernel_MergeRuns, 1, &globalWorkSize, NULL, "Merge runs", 2 * elementSize * _datasetSize);
+		checkCLStatus(clStatus);
+
+		std::swap(input, output);
+	}
+
+	_clBuffer_sorted = input;
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef __CLPP_SORT_STREAM_H__
+#define __CLPP_SORT_STREAM_H__
+
+#include "clpp/clppSort.h"
+
+// Sort a host data set by streaming it to the device in chunks.
+// The chunks are distributed over several command queues ('lanes') : the upload of a chunk
+// overlaps the sort of the previous ones. The sorted runs are merged on the device, then downloaded at once.
+// The device holds the whole data set twice (The runs and their merge), plus one chunk per lane.
+class clppSort_Stream : public clppSort
+{
+public:
+	// lanes : the number of command queues (2 at least to overlap the transfers and the sorts)
+	// chunkElements : the number of elements sorted by one chunk
+	clppSort_Stream(clppContext* context, unsigned int maxElements, unsigned int bits, bool keysOnly, unsigned int lanes = 2, unsigned int chunkElements = 1 << 20);
+	~clppSort_Stream();
+
+	string getName() { return "Streaming radix sort"; }
+
+	string compilePreprocess(string kernel);
+
+	// Enqueue the upload and the sort of all the chunks, then the merge of the sorted runs.
+	void sort();
+
+	// Only store the data set, the uploads are done by the sort.
+	void pushDatas(void* dataSet, size_t datasetSize);
+
+	// Unsupported (Error) : the data set must be on the host side, use a device sort instead.
+	void pushCLDatas(cl_mem clBuffer_dataSet, size_t datasetSize);
+
+	// Download the merged data set.
+	void popDatas();
+	void popDatas(void* dataSet);
+
+	// Asynchronous versions (Defined by clppSort)
+	using clppSort::sort;
+	using clppSort::pushDatas;
+	using clppSort::pushCLDatas;
+	using clppSort::popDatas;
+
+	void waitCompletion();
+
+private:
+	struct Lane
+	{
+		clppContext* context;	// The main context, with its own command queue
+		clppSort* sort;
+		cl_mem clBuffer_chunk;
+		size_t chunkSize;		// The number of elements currently pushed to 'sort'
+	};
+
+	bool _keysOnly;
+	unsigned int _bits;
+	unsigned int _keyMask;		// The bits of the keys sorted by the chunks, the merge compares them only
+	unsigned int _maxElements;
+
+	unsigned int _lanesCount;
+	Lane* _lanes;
+
+	size_t _chunkElements;
+	size_t _chunksCount;
+
+	void* _dataSetOut;
+
+	// The sorted runs are merged pass after pass, between these 2 buffers
+	cl_mem _clBuffer_runs;
+	cl_mem _clBuffer_merged;
+	cl_mem _clBuffer_sorted;		// The one with the result
+	cl_kernel _kernel_MergeRuns;
+
+	void merge();
+};
+
+#endif
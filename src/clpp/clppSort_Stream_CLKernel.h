@@ -0,0 +1,51 @@
+
+char clCode_clppSort_Stream[]=
+"__kernel\n"
+"void kernel__MergeRuns(\n"
+"	__global const KV_TYPE* input,\n"
+"	__global KV_TYPE* output,\n"
+"	const uint runSize,\n"
+"	const uint size)\n"
+"{\n"
+"	const uint i = get_global_id(0);\n"
+"	if (i >= size)\n"
+"		return;\n"
+"	// The pair of runs of the element\n"
+"	const uint run = i / runSize;\n"
+"	const uint aStart = (run & ~1u) * runSize;\n"
+"	const uint bStart = min(aStart + runSize, size);\n"
+"	const uint bEnd = min(bStart + runSize, size);\n"
+"	const KV_TYPE element = input[i];\n"
+"	const uint key = KEY(element) & KEY_MASK;\n"
+"	uint rank;\n"
+"	if (run & 1)\n"
+"	{\n"
+"		// In B : the elements of A with a key lower or equal go before (Upper bound)\n"
+"		uint lo = aStart, hi = bStart;\n"
+"		while (lo < hi)\n"
+"		{\n"
+"			uint mid = (lo + hi) / 2;\n"
+"			if ((KEY(input[mid]) & KEY_MASK) <= key)\n"
+"				lo = mid + 1;\n"
+"			else\n"
+"				hi = mid;\n"
+"		}\n"
+"		rank = (i - bStart) + (lo - aStart);\n"
+"	}\n"
+"	else\n"
+"	{\n"
+"		// In A : the elements of B with a lower key go before (Lower bound)\n"
+"		uint lo = bStart, hi = bEnd;\n"
+"		while (lo < hi)\n"
+"		{\n"
+"			uint mid = (lo + hi) / 2;\n"
+"			if ((KEY(input[mid]) & KEY_MASK) < key)\n"
+"				lo = mid + 1;\n"
+"			else\n"
+"				hi = mid;\n"
+"		}\n"
+"		rank = (i - aStart) + (lo - bStart);\n"
+"	}\n"
+"	output[aStart + rank] = element;\n"
+"}\n"
+;
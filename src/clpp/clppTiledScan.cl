@@ -0,0 +1,85 @@
+//------------------------------------------------------------
+// Purpose :
+// ---------
+// The tiles of the single-pass scans (Chained scan with decoupled look-back), inserted before their kernels.
+//
+// The tiles are numbered in the order the work-groups start (An atomic counter), so a tile only waits for tiles that are running.
+// Each tile publishes its status :
+//   TILE_AGGREGATE : the total of the tile is known
+//   TILE_PREFIX    : the inclusive prefix (All the values up to the end of the tile) is known
+// Then it looks back at the previous tiles : it combines their aggregates until it finds an inclusive prefix.
+//
+// The status flags are reset by kernel__LookBackInit before each scan.
+//
+// References :
+// ------------
+// Duane Merrill, Michael Garland. Single-pass Parallel Prefix Scan with Decoupled Look-back. NVIDIA Technical Report NVR-2016-002.
+// https://research.nvidia.com/publication/single-pass-parallel-prefix-scan-decoupled-look-back
+//------------------------------------------------------------
+
+#define TILE_INVALID 0
+#define TILE_AGGREGATE 1
+#define TILE_PREFIX 2
+
+//------------------------------------------------------------
+// kernel__LookBackInit
+//
+// Purpose : Reset the tile counter and the status of the tiles.
+//------------------------------------------------------------
+
+__kernel
+void kernel__LookBackInit(__global uint* tileStatus, __global uint* tileCounter, const uint tiles)
+{
+	const uint i = get_global_id(0);
+
+	if (i < tiles)
+		tileStatus[i] = TILE_INVALID;
+
+	if (i == 0)
+		tileCounter[0] = 0;
+}
+
+//------------------------------------------------------------
+// tile_publish
+//
+// Purpose : Publish the aggregate (TILE_AGGREGATE) or the inclusive prefix (TILE_PREFIX) of a tile.
+//------------------------------------------------------------
+
+inline void tile_publish(volatile __global uint* tileStatus, volatile __global T* tileValues, const uint tile, const T value, const uint status)
+{
+	tileValues[tile] = value;
+	mem_fence(CLK_GLOBAL_MEM_FENCE);
+	atomic_xchg(&tileStatus[tile], status);
+}
+
+//------------------------------------------------------------
+// tile_look_back
+//
+// Purpose : Returns the exclusive prefix of a tile : the aggregates of the previous tiles, up to the first inclusive prefix.
+// The previous tiles have started : their status is waited for.
+//------------------------------------------------------------
+
+inline T tile_look_back(volatile __global uint* tileStatus, volatile __global T* tileAggregates, volatile __global T* tilePrefixes, const uint tile)
+{
+	T exclusivePrefix = OPERATOR_IDENTITY;
+
+	int previous = tile - 1;
+	while(previous >= 0)
+	{
+		uint status = atomic_or(&tileStatus[previous], 0);
+		if (status == TILE_INVALID)
+			continue;
+
+		mem_fence(CLK_GLOBAL_MEM_FENCE);
+		if (status == TILE_PREFIX)
+		{
+			exclusivePrefix = OPERATOR_APPLY(tilePrefixes[previous], exclusivePrefix);
+			break;
+		}
+
+		exclusivePrefix = OPERATOR_APPLY(tileAggregates[previous], exclusivePrefix);
+		previous--;
+	}
+
+	return exclusivePrefix;
+}
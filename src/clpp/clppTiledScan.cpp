@@ -0,0 +1,185 @@
+#include "clpp/clppTiledScan.h"
+#include "clpp/clppTiledScan_CLKernel.h"
+
+// The values per work-item
+#define LOOKBACK_ITEMS 4
+
+#pragma region Constructor
+
+clppTiledScan::clppTiledScan(clppContext* context, size_t valueSize, unsigned int maxElements) :
+	clppScan(context, valueSize, maxElements)
+{
+	setupTiles(maxElements);
+}
+
+clppTiledScan::clppTiledScan(clppContext* context, clppValueType valueType, unsigned int maxElements) :
+	clppScan(context, valueType, maxElements)
+{
+	setupTiles(maxElements);
+}
+
+clppTiledScan::clppTiledScan(clppContext* context, const clppOperator& op, unsigned int maxElements) :
+	clppScan(context, op, maxElements)
+{
+	setupTiles(maxElements);
+}
+
+void clppTiledScan::setupTiles(unsigned int maxElements)
+{
+	_maxElements = maxElements;
+	_isBound = false;
+	_kernel_Init = 0;
+	_tileSize = 0;
+	_tiles = 0;
+	_clBuffer_TileStatus = 0;
+	_clBuffer_TileAggregates = 0;
+	_clBuffer_TilePrefixes = 0;
+	_clBuffer_TileCounter = 0;
+	_tilesCapacity = 0;
+}
+
+clppTiledScan::~clppTiledScan()
+{
+	freeTiles();
+}
+
+void clppTiledScan::createTiles(cl_kernel kernel_Scan, size_t localValueBytes)
+{
+	_kernel_Init = createKernel("kernel__LookBackInit");
+
+	//---- The work-group scan needs a power of 2, and the tile has to fit in the local memory
+	size_t maxWorkgroupSize;
+	cl_ulong localMemSize;
+	clGetKernelWorkGroupInfo(kernel_Scan, _context->clDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkgroupSize, 0);
+	clGetDeviceInfo(_context->clDevice, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &localMemSize, 0);
+
+	for(_workgroupSize = 1; _workgroupSize * 2 <= maxWorkgroupSize; _workgroupSize *= 2);
+	while(_workgroupSize > 1 && (LOOKBACK_ITEMS + 1) * _workgroupSize * localValueBytes + 2 * _valueSize > localMemSize)
+		_workgroupSize /= 2;
+
+	_tileSize = LOOKBACK_ITEMS * _workgroupSize;
+
+	allocateTiles(computeTiles(_maxElements));
+}
+
+#pragma endregion
+
+#pragma region compilePreprocess
+
+string clppTiledScan::compilePreprocess(string kernel)
+{
+	ostringstream lines;
+	lines << "#define LOOKBACK_ITEMS " << LOOKBACK_ITEMS << endl;
+
+	return clppScan::compilePreprocess(lines.str() + clCode_clppTiledScan + kernel);
+}
+
+#pragma endregion
+
+#pragma region Tiles
+
+void clppTiledScan::setTiles(size_t datasetSize)
+{
+	_tiles = computeTiles(datasetSize);
+
+	//---- The temporary storage is sized for the data set
+	if (_tiles > _tilesCapacity)
+		allocateTiles(_tiles);
+}
+
+cl_int clppTiledScan::bindInit()
+{
+	cl_int clStatus;
+	clStatus  = clSetKernelArg(_kernel_Init, 0, sizeof(cl_mem), &_clBuffer_TileStatus);
+	clStatus |= clSetKernelArg(_kernel_Init, 1, sizeof(cl_mem), &_clBuffer_TileCounter);
+	clStatus |= clSetKernelArg(_kernel_Init, 2, sizeof(int), &_tiles);
+	return clStatus;
+}
+
+void clppTiledScan::enqueueInit()
+{
+	size_t localWorkSize = {_workgroupSize};
+	size_t globalWorkSize = {toMultipleOf(_tiles, _workgroupSize)};
+	cl_int clStatus = enqueueKernel(_kernel_Init, 1, &globalWorkSize, &localWorkSize, "Look-back init", sizeof(int) * (_tiles + 1));
+	checkCLStatus(clStatus);
+}
+
+void clppTiledScan::allocateTiles(unsigned int tiles)
+{
+	freeTiles();
+
+	if (tiles < 1)
+		tiles = 1;
+
+	size_t scratchOffset = 0;
+	_clBuffer_TileStatus = allocateScratch(sizeof(int) * tiles, scratchOffset);
+	_clBuffer_TileAggregates = allocateScratch(_valueSize * tiles, scratchOffset);
+	_clBuffer_TilePrefixes = allocateScratch(_valueSize * tiles, scratchOffset);
+	_clBuffer_TileCounter = allocateScratch(sizeof(int), scratchOffset);
+
+	_tilesCapacity = tiles;
+	_isBound = false;
+}
+
+void clppTiledScan::freeTiles()
+{
+	releaseScratch(_clBuffer_TileStatus);
+	releaseScratch(_clBuffer_TileAggregates);
+	releaseScratch(_clBuffer_TilePrefixes);
+	releaseScratch(_clBuffer_TileCounter);
+
+	_tilesCapacity = 0;
+}
+
+#pragma endregion
+
+#pragma region Inclusive, out-of-place and total
+
+void clppTiledScan::setInclusive(bool inclusive)
+{
+	clppScan::setInclusive(inclusive);
+	_isBound = false;
+}
+
+void clppTiledScan::setOutput(cl_mem clBuffer_output)
+{
+	clppScan::setOutput(clBuffer_output);
+	_isBound = false;
+}
+
+void clppTiledScan::setTotal(bool enable, cl_mem clBuffer_total, unsigned int index)
+{
+	clppScan::setTotal(enable, clBuffer_total, index);
+	_isBound = false;
+}
+
+#pragma endregion
+
+#pragma region Temporary storage
+
+size_t clppTiledScan::getTempStorageBytes(size_t datasetSize)
+{
+	unsigned int tiles = computeTiles(datasetSize);
+	if (tiles < 1)
+		tiles = 1;
+
+	return getScratchBytes(sizeof(int) * tiles) + 2 * getScratchBytes(_valueSize * tiles) + getScratchBytes(sizeof(int));
+}
+
+void clppTiledScan::setTempStorage(cl_mem tempStorage, size_t offset)
+{
+	clppScan::setTempStorage(tempStorage, offset);
+
+	// Without temporary storage, the internal buffers are sized for maxElements
+	if (_tempStorage)
+	{
+		if (_datasetSize > 0)
+			allocateTiles(_tiles);
+		else
+			freeTiles();
+	}
+	else
+		allocateTiles(computeTiles(_maxElements));
+}
+
+#pragma endregion
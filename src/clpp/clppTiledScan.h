@@ -0,0 +1,63 @@
+#ifndef __CLPP_TILED_SCAN_H__
+#define __CLPP_TILED_SCAN_H__
+
+#include "clpp/clppScan.h"
+
+// The base of the single-pass scans by tiles, chained with decoupled look-back (clppScan_LookBack, clppSegmentedScan) :
+// the status of the tiles, their temporary storage, the reset kernel and the look-back (clppTiledScan.cl).
+class clppTiledScan : public clppScan
+{
+public:
+	clppTiledScan(clppContext* context, size_t valueSize, unsigned int maxElements);
+	clppTiledScan(clppContext* context, clppValueType valueType, unsigned int maxElements);
+	clppTiledScan(clppContext* context, const clppOperator& op, unsigned int maxElements);
+	~clppTiledScan();
+
+	// Insert LOOKBACK_ITEMS and the tiles functions before the kernels
+	string compilePreprocess(string kernel);
+
+	void setInclusive(bool inclusive);
+	void setOutput(cl_mem clBuffer_output);
+	void setTotal(bool enable, cl_mem clBuffer_total = 0, unsigned int index = 0);
+
+	size_t getTempStorageBytes(size_t datasetSize);
+	void setTempStorage(cl_mem tempStorage, size_t offset = 0);
+
+protected:
+	cl_kernel _kernel_Init;
+	bool _isBound;						// The kernel arguments are up to date
+
+	unsigned int _maxElements;
+
+	size_t _tileSize;					// The values per work-group
+	unsigned int _tiles;				// The tiles of the current data set
+
+	// The status of the tiles, allocated for '_tilesCapacity' tiles
+	cl_mem _clBuffer_TileStatus;
+	cl_mem _clBuffer_TileAggregates;
+	cl_mem _clBuffer_TilePrefixes;
+	cl_mem _clBuffer_TileCounter;
+	unsigned int _tilesCapacity;
+
+	// Once compiled : the work-group size (A power of 2, the tile and one value per work-item must fit in the local memory,
+	// 'localValueBytes' per value) and the tiles for maxElements.
+	void createTiles(cl_kernel kernel_Scan, size_t localValueBytes);
+
+	// The tiles of a data set (Grown with the temporary storage)
+	void setTiles(size_t datasetSize);
+
+	// Bind the arguments of the reset kernel, returns the status
+	cl_int bindInit();
+
+	// Reset the status of the tiles, before each scan
+	void enqueueInit();
+
+	unsigned int computeTiles(size_t datasetSize) { return (unsigned int)((datasetSize + _tileSize - 1) / _tileSize); }
+	void allocateTiles(unsigned int tiles);
+	void freeTiles();
+
+private:
+	void setupTiles(unsigned int maxElements);
+};
+
+#endif
@@ -0,0 +1,41 @@
+
+char clCode_clppTiledScan[]=
+"#define TILE_INVALID 0\n"
+"#define TILE_AGGREGATE 1\n"
+"#define TILE_PREFIX 2\n"
+"__kernel\n"
+"void kernel__LookBackInit(__global uint* tileStatus, __global uint* tileCounter, const uint tiles)\n"
+"{\n"
+"	const uint i = get_global_id(0);\n"
+"	if (i < tiles)\n"
+"		tileStatus[i] = TILE_INVALID;\n"
+"	if (i == 0)\n"
+"		tileCounter[0] = 0;\n"
+"}\n"
+"inline void tile_publish(volatile __global uint* tileStatus, volatile __global T* tileValues, const uint tile, const T value, const uint status)\n"
+"{\n"
+"	tileValues[tile] = value;\n"
+"	mem_fence(CLK_GLOBAL_MEM_FENCE);\n"
+"	atomic_xchg(&tileStatus[tile], status);\n"
+"}\n"
+"inline T tile_look_back(volatile __global uint* tileStatus, volatile __global T* tileAggregates, volatile __global T* tilePrefixes, const uint tile)\n"
+"{\n"
+"	T exclusivePrefix = OPERATOR_IDENTITY;\n"
+"	int previous = tile - 1;\n"
+"	while(previous >= 0)\n"
+"	{\n"
+"		uint status = atomic_or(&tileStatus[previous], 0);\n"
+"		if (status == TILE_INVALID)\n"
+"			continue;\n"
+"		mem_fence(CLK_GLOBAL_MEM_FENCE);\n"
+"		if (status == TILE_PREFIX)\n"
+"		{\n"
+"			exclusivePrefix = OPERATOR_APPLY(tilePrefixes[previous], exclusivePrefix);\n"
+"			break;\n"
+"		}\n"
+"		exclusivePrefix = OPERATOR_APPLY(tileAggregates[previous], exclusivePrefix);\n"
+"		previous--;\n"
+"	}\n"
+"	return exclusivePrefix;\n"
+"}\n"
+;
@@ -0,0 +1,56 @@
+#include "clpp/clppTransform.h"
+
+#pragma region Constructor
+
+clppTransform::clppTransform()
+{
+	_inputType = Value_Custom;
+	_inputSize = 0;
+}
+
+clppTransform::clppTransform(clppValueType inputType, const string& source)
+{
+	_inputType = inputType;
+	_inputSize = clppProgram::getValueTypeSize(inputType);
+	_source = source;
+}
+
+clppTransform::clppTransform(size_t inputSize, const string& source)
+{
+	_inputType = Value_Custom;
+	_inputSize = inputSize;
+	_source = source;
+}
+
+#pragma endregion
+
+#pragma region Predefined transforms
+
+clppTransform clppTransform::predicate(clppValueType inputType, const string& condition)
+{
+	return clppTransform(inputType, "#define TRANSFORM(X) ((T)((" + condition + ") ? 1 : 0))\n");
+}
+
+#pragma endregion
+
+#pragma region getDefinitions
+
+string clppTransform::getDefinitions() const
+{
+	if (!isEnabled())
+		return "";
+
+	string source;
+	if (_inputType == Value_Double)
+	{
+		source += "#ifdef cl_khr_fp64\n#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n";
+		source += "#else\n#pragma OPENCL EXTENSION cl_amd_fp64 : enable\n#endif\n";
+	}
+
+	if (_inputType != Value_Custom)
+		source += string("#define INPUT_T ") + clppProgram::getValueTypeName(_inputType) + "\n";
+
+	return source + _source + "\n";
+}
+
+#pragma endregion
@@ -0,0 +1,43 @@
+#ifndef __CLPP_TRANSFORM_H__
+#define __CLPP_TRANSFORM_H__
+
+#include "clpp/clppProgram.h"
+
+// A per-element transform of the scans, applied when the values are loaded : the scan of f(x) without writing f(x).
+// An OpenCL snippet, injected by compilePreprocess, which defines :
+//   TRANSFORM(X) : the value of type T scanned for the input X, of type INPUT_T
+// The input isn't modified : the results are written to the output buffer of the scan (See clppScan::setOutput).
+//
+// Example, count the values over a threshold : clppTransform(Value_Float, "#define TRANSFORM(X) ((T)((X) > 0.5f))\n")
+// with a sum of Value_UInt, or clppTransform::predicate(Value_Float, "X > 0.5f").
+//
+// With a custom input type, the snippet defines INPUT_T too (Ex: a struct of 'inputSize' bytes, with the host layout).
+class clppTransform
+{
+public:
+	// No transform : the values are scanned
+	clppTransform();
+
+	// A transform of the inputs of a predefined type
+	clppTransform(clppValueType inputType, const string& source);
+
+	// A transform of the inputs of a custom type of 'inputSize' bytes, defined by 'source'
+	clppTransform(size_t inputSize, const string& source);
+
+	// 1 when 'condition' (An expression of X) is true, else 0
+	static clppTransform predicate(clppValueType inputType, const string& condition);
+
+	bool isEnabled() const { return !_source.empty(); }
+	clppValueType getInputType() const { return _inputType; }
+	size_t getInputSize() const { return _inputSize; }
+
+	// Returns the definitions to insert before the kernels : the type INPUT_T and the transform.
+	string getDefinitions() const;
+
+private:
+	clppValueType _inputType;
+	size_t _inputSize;
+	string _source;
+};
+
+#endif